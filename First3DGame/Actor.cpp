@@ -8,6 +8,7 @@ Actor::Actor(class Game* game)
 	,mPosition(Vector3::Zero)
 	,mRotation()
 	,mState(EActive)
+	,mIsStatic(false)
 {
 
 }
@@ -62,8 +62,14 @@ public:
 	float GetScale() const { return mScale; }
 	void SetScale(float scale) { mScale = scale; mRecomputeWorldTransform = true; }
 	void SetState(const State& state) { mState = state; }
+	bool IsStatic() const { return mIsStatic; }
+	//static actors' meshes are merged into a StaticBatch at their transform when the renderer
+	//next builds batches. Moving, scaling or rotating one afterwards takes its mesh out of the
+	//batch and draws it on its own from then on, and destroying one takes it out too
+	void SetStatic(bool isStatic) { mIsStatic = isStatic; }
 
 	Vector3 GetForward() const { return Vector3::Transform(Vector3::UnitX, mRotation); }
+	class Game* GetGame() const { return mGame; }
 
 	void RemoveComponent(class Component* component);
 protected:
@@ -79,5 +85,7 @@ protected:
 	//XP[]AWύXAmWorldTransformxvZ
 	bool mRecomputeWorldTransform;
 
+	bool mIsStatic;
+
 	std::vector<std::unique_ptr<class Component>> mComponents;
 };
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "AsyncTextureLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <glew.h>
+#include <SDL.h>
+#include "ThreadPool.h"
+#include "Texture.h"
+#include "TextureArray.h"
+#include "GpuDebug.h"
+
+namespace
+{
+	void ExpandToRGBA(TextureMip& mip)
+	{
+		size_t numTexels = static_cast<size_t>(mip.mWidth) * mip.mHeight;
+		std::vector<unsigned char> rgba(numTexels * 4);
+		for (size_t i = 0; i < numTexels; ++i)
+		{
+			memcpy(&rgba[i * 4], &mip.mData[i * 3], 3);
+			rgba[i * 4 + 3] = 0xff;
+		}
+		mip.mData.swap(rgba);
+	}
+}
+
+AsyncTextureLoader::AsyncTextureLoader(ThreadPool* pool)
+	:mPool(pool)
+	, mPixelBuffer(0)
+	, mUploadBudget(DefaultUploadBudget)
+{
+	glGenBuffers(1, &mPixelBuffer);
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+	Cancel();
+	glDeleteBuffers(1, &mPixelBuffer);
+}
+
+void AsyncTextureLoader::Request(Texture* texture, const std::string& fileName)
+{
+	Submit(texture, fileName, OwnTexture);
+}
+
+void AsyncTextureLoader::RequestLayer(Texture* texture, const std::string& fileName)
+{
+	Submit(texture, fileName, ArrayLayer);
+}
+
+void AsyncTextureLoader::RequestRegion(Texture* texture, const std::string& fileName)
+{
+	Submit(texture, fileName, AtlasRegion);
+}
+
+void AsyncTextureLoader::Submit(Texture* texture, const std::string& fileName, JobTarget target)
+{
+	auto job = std::make_shared<Job>();
+	job->mFileName = fileName;
+	job->mTexture = texture;
+	//atlas pages hold plain RGBA
+	job->mUseCooked = target != AtlasRegion && GLEW_EXT_texture_compression_s3tc;
+	job->mTarget = target;
+	mJobs.emplace_back(job);
+
+	//the worker only touches the job it shares, so Cancel can drop it at any time
+	mPool->Submit([job]()
+		{
+			bool loaded = TextureCooker::LoadPreferCooked(job->mFileName, job->mData, job->mUseCooked);
+			//array layers all carry the full chain so arrays can be shared by size and format alone
+			if (loaded && job->mTarget == ArrayLayer && job->mData.mMips.size() == 1)
+			{
+				TextureCooker::GenerateMips(job->mData);
+			}
+			if (loaded && job->mTarget == AtlasRegion && job->mData.mFormat == TextureFormat::RGB8)
+			{
+				ExpandToRGBA(job->mData.mMips[0]);
+				job->mData.mFormat = TextureFormat::RGBA8;
+			}
+			job->mState = loaded ? Decoded : Failed;
+		});
+}
+
+void AsyncTextureLoader::Update()
+{
+	size_t budget = mUploadBudget;
+	for (auto iter = mJobs.begin(); iter != mJobs.end();)
+	{
+		Job& job = **iter;
+		int state = job.mState;
+		if (state == Failed)
+		{
+			SDL_Log("Failed to load image : %s", job.mFileName.c_str());
+			iter = mJobs.erase(iter);
+			continue;
+		}
+		if (state == Decoding || budget == 0)
+		{
+			++iter;
+			continue;
+		}
+
+		size_t uploaded = 0;
+		if (job.mTarget == AtlasRegion)
+		{
+			//a sprite goes up in one piece; the atlas caps it at MaxEntrySize
+			const TextureMip& mip = job.mData.mMips[0];
+			if (mAtlasInserter && mAtlasInserter(job.mFileName, mip, job.mTexture))
+			{
+				budget -= std::min(budget, mip.mData.size());
+				iter = mJobs.erase(iter);
+				continue;
+			}
+			job.mTarget = OwnTexture;
+		}
+		if (job.mTarget == ArrayLayer)
+		{
+			uploaded = UploadLayerLevels(job, budget);
+		}
+		else
+		{
+			if (job.mTextureID == 0)
+			{
+				glGenTextures(1, &job.mTextureID);
+				glBindTexture(GL_TEXTURE_2D, job.mTextureID);
+				GpuDebug::SetLabel(GL_TEXTURE, job.mTextureID, job.mFileName.c_str());
+			}
+			glBindTexture(GL_TEXTURE_2D, job.mTextureID);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			uploaded = TextureCooker::IsCompressed(job.mData.mFormat) ? UploadLevels(job, budget) : UploadRows(job, budget);
+		}
+		//everything else passes client pointers to glTexImage2D
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		budget -= std::min(budget, uploaded);
+
+		if (job.mLevelsUploaded == job.mData.mMips.size())
+		{
+			int width = job.mData.mMips[0].mWidth;
+			int height = job.mData.mMips[0].mHeight;
+			if (job.mTarget == ArrayLayer)
+			{
+				job.mTexture->InitAsLayer(job.mArray, job.mLayer, width, height);
+			}
+			else
+			{
+				Texture::SetFiltering(static_cast<int>(job.mData.mMips.size()));
+				job.mTexture->Adopt(job.mTextureID, width, height);
+			}
+			iter = mJobs.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+size_t AsyncTextureLoader::UploadRows(Job& job, size_t budget)
+{
+	const TextureMip& mip = job.mData.mMips[0];
+	unsigned int format = TextureCooker::GetGLInternalFormat(job.mData.mFormat);
+	if (job.mRowsUploaded == 0)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, format, mip.mWidth, mip.mHeight, 0, format, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	size_t rowBytes = mip.mData.size() / mip.mHeight;
+	int rows = static_cast<int>(std::max<size_t>(1, budget / rowBytes));
+	rows = std::min(rows, mip.mHeight - job.mRowsUploaded);
+	size_t bytes = rows * rowBytes;
+
+	FillPixelBuffer(mip.mData.data() + job.mRowsUploaded * rowBytes, bytes);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.mRowsUploaded, mip.mWidth, rows, format, GL_UNSIGNED_BYTE, nullptr);
+
+	job.mRowsUploaded += rows;
+	if (job.mRowsUploaded == mip.mHeight)
+	{
+		job.mLevelsUploaded = 1;
+	}
+	return bytes;
+}
+
+size_t AsyncTextureLoader::UploadLevels(Job& job, size_t budget)
+{
+	unsigned int format = TextureCooker::GetGLInternalFormat(job.mData.mFormat);
+	size_t uploaded = 0;
+	while (job.mLevelsUploaded < job.mData.mMips.size() && (uploaded == 0 || uploaded < budget))
+	{
+		const TextureMip& mip = job.mData.mMips[job.mLevelsUploaded];
+		FillPixelBuffer(mip.mData.data(), mip.mData.size());
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(job.mLevelsUploaded), format, mip.mWidth, mip.mHeight, 0,
+			static_cast<GLsizei>(mip.mData.size()), nullptr);
+		uploaded += mip.mData.size();
+		++job.mLevelsUploaded;
+	}
+	return uploaded;
+}
+
+size_t AsyncTextureLoader::UploadLayerLevels(Job& job, size_t budget)
+{
+	if (!job.mArray)
+	{
+		job.mArray = mArraySelector(job.mData);
+		job.mLayer = job.mArray->AllocateLayer(job.mFileName);
+	}
+
+	//large levels go up a slice of rows at a time; compressed slices keep to whole block rows
+	int rowStep = TextureCooker::IsCompressed(job.mData.mFormat) ? 4 : 1;
+	size_t uploaded = 0;
+	while (job.mLevelsUploaded < job.mData.mMips.size())
+	{
+		const TextureMip& mip = job.mData.mMips[job.mLevelsUploaded];
+		size_t stepBytes = mip.mData.size() / ((mip.mHeight + rowStep - 1) / rowStep);
+		size_t remaining = budget - std::min(budget, uploaded);
+		if (uploaded > 0 && remaining < stepBytes)
+		{
+			break;
+		}
+		int steps = static_cast<int>(std::max<size_t>(1, remaining / stepBytes));
+		int firstRow = job.mRowsUploaded;
+		int rows = std::min(steps * rowStep, mip.mHeight - firstRow);
+		size_t bytes = (rows + rowStep - 1) / rowStep * stepBytes;
+
+		FillPixelBuffer(mip.mData.data() + firstRow / rowStep * stepBytes, bytes);
+		job.mArray->UploadRows(job.mLayer, static_cast<int>(job.mLevelsUploaded), mip, firstRow, rows, nullptr);
+		uploaded += bytes;
+		job.mRowsUploaded += rows;
+		if (job.mRowsUploaded == mip.mHeight)
+		{
+			job.mRowsUploaded = 0;
+			++job.mLevelsUploaded;
+		}
+	}
+	return uploaded;
+}
+
+void AsyncTextureLoader::FillPixelBuffer(const unsigned char* data, size_t bytes)
+{
+	//orphaning gives a fresh store, so the copy never waits on the previous slice
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+	void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (dst)
+	{
+		memcpy(dst, data, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	else
+	{
+		glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, bytes, data);
+	}
+}
+
+bool AsyncTextureLoader::IsPending(const Texture* texture) const
+{
+	return std::any_of(mJobs.begin(), mJobs.end(), [texture](const std::shared_ptr<Job>& job) { return job->mTexture == texture; });
+}
+
+void AsyncTextureLoader::Cancel()
+{
+	for (auto& job : mJobs)
+	{
+		if (job->mTextureID != 0)
+		{
+			glDeleteTextures(1, &job->mTextureID);
+		}
+	}
+	mJobs.clear();
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "TextureCooker.h"
+
+//decodes images (or reads their cooked KTX) on the thread pool and streams them into GL
+//through a pixel buffer object, a few rows or mip levels per frame. The requesting
+//Texture keeps whatever it shows until everything is in, then takes over the new GL texture,
+//the texture array layer (material textures) or the atlas region (sprites) it went into
+class AsyncTextureLoader
+{
+public:
+	explicit AsyncTextureLoader(class ThreadPool* pool);
+	~AsyncTextureLoader();
+
+	void Request(class Texture* texture, const std::string& fileName);
+	//decodes with a full mip chain and streams into a layer of the array the selector picks
+	void RequestLayer(class Texture* texture, const std::string& fileName);
+	//decodes to RGBA and hands the image to the atlas inserter; its own texture when it does not fit
+	void RequestRegion(class Texture* texture, const std::string& fileName);
+	//must return an array compatible with the data and with a free layer
+	using ArraySelector = std::function<class TextureArray*(const TextureData&)>;
+	void SetArraySelector(ArraySelector selector) { mArraySelector = std::move(selector); }
+	//packs the image and points the texture at its region, false when no page takes it
+	using AtlasInserter = std::function<bool(const std::string&, const TextureMip&, class Texture*)>;
+	void SetAtlasInserter(AtlasInserter inserter) { mAtlasInserter = std::move(inserter); }
+	//call once per frame on the GL thread
+	void Update();
+	//drops every pending load; their textures keep the placeholder
+	void Cancel();
+
+	size_t GetNumPending() const { return mJobs.size(); }
+	bool IsPending(const class Texture* texture) const;
+	//bytes of texel data uploaded per Update; at least one row (a row of blocks when
+	//compressed) always goes up, or one whole level of a compressed standalone texture
+	void SetUploadBudget(size_t bytes) { mUploadBudget = bytes; }
+	size_t GetUploadBudget() const { return mUploadBudget; }
+
+	static const size_t DefaultUploadBudget = 1024 * 1024;
+private:
+	enum JobState
+	{
+		Decoding,
+		Decoded,
+		Failed
+	};
+
+	enum JobTarget
+	{
+		OwnTexture,
+		ArrayLayer,
+		AtlasRegion
+	};
+
+	struct Job
+	{
+		std::string mFileName;
+		class Texture* mTexture = nullptr;
+		bool mUseCooked = false;
+		JobTarget mTarget = OwnTexture;
+		//written by the worker before mState becomes Decoded
+		TextureData mData;
+		std::atomic<int> mState = Decoding;
+		//main thread only
+		unsigned int mTextureID = 0;
+		//of the level being uploaded
+		int mRowsUploaded = 0;
+		size_t mLevelsUploaded = 0;
+		class TextureArray* mArray = nullptr;
+		int mLayer = -1;
+	};
+
+	void Submit(class Texture* texture, const std::string& fileName, JobTarget target);
+
+	//each returns the bytes uploaded
+	size_t UploadRows(Job& job, size_t budget);
+	size_t UploadLevels(Job& job, size_t budget);
+	size_t UploadLayerLevels(Job& job, size_t budget);
+	//copies into the orphaned pixel buffer and leaves it bound
+	void FillPixelBuffer(const unsigned char* data, size_t bytes);
+
+	std::vector<std::shared_ptr<Job>> mJobs;
+	class ThreadPool* mPool;
+	ArraySelector mArraySelector;
+	AtlasInserter mAtlasInserter;
+	unsigned int mPixelBuffer;
+	size_t mUploadBudget;
+};
\ No newline at end of file
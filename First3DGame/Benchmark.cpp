@@ -0,0 +1,177 @@
+#include "Benchmark.h"
+#include <SDL.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include "Actor.h"
+
+namespace
+{
+	//programs that finish early still leave textures streaming in for a while
+	const int MinWarmupFrames = 60;
+	const int MaxWarmupFrames = 1200;
+	//GPU timings of a frame whose queries were dropped never come
+	const int MaxTrailingFrames = 30;
+	//inside the arena walls, which stand 1250 from the centre
+	const float PathRadius = 900.0f;
+
+	//"Depth prepass" -> "gpu_depth_prepass_ms"
+	std::string GetGpuColumn(const char* scope)
+	{
+		std::string column = "gpu_";
+		for (const char* c = scope; *c; ++c)
+		{
+			column += *c == ' ' ? '_' : static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+		}
+		return column + "_ms";
+	}
+}
+
+Benchmark::Benchmark(const std::string& csvPath, int numFrames)
+	:mCsvPath(csvPath)
+	, mRows(std::max(numFrames, 1))
+	, mFirstFrame(-1)
+{
+
+}
+
+void Benchmark::PlaceCamera(Actor* camera, unsigned int frameNumber) const
+{
+	float time = mFirstFrame < 0 ? 0.0f : (static_cast<int>(frameNumber) - mFirstFrame) * TimeStep;
+	float angle = Math::TwoPi * time / LapTime;
+	camera->SetPosition(Vector3(Math::Cos(angle), Math::Sin(angle), 0.0f) * PathRadius);
+	//ahead along the loop and a little into the arena
+	camera->SetRotation(Quaternion(Vector3::UnitZ, angle + Math::PiOver2 + 0.5f));
+}
+
+bool Benchmark::EndFrame(unsigned int frameNumber, double cpuMs, const RenderStats& stats)
+{
+	int frame = static_cast<int>(frameNumber);
+	if (mFirstFrame < 0)
+	{
+		if ((frame >= MinWarmupFrames && stats.mFrame >= 0 && stats.mShadersPending == 0) || frame >= MaxWarmupFrames)
+		{
+			mFirstFrame = frame + 1;
+			SDL_Log("Benchmark : recording %zu frames after %d warm-up frames", mRows.size(), mFirstFrame);
+		}
+		return true;
+	}
+
+	if (Row* row = GetRow(frame))
+	{
+		row->mCpuMs = cpuMs;
+		row->mHasCpu = true;
+	}
+	if (Row* row = GetRow(stats.mFrame))
+	{
+		row->mStats = stats;
+		row->mStats.mGpuTimings.clear();
+		row->mHasStats = true;
+	}
+	if (Row* row = GetRow(stats.mGpuFrame))
+	{
+		row->mGpuTimings = stats.mGpuTimings;
+		row->mHasGpu = true;
+	}
+	int lastFrame = mFirstFrame + static_cast<int>(mRows.size()) - 1;
+	return stats.mFrame < lastFrame || (stats.mGpuFrame < lastFrame && frame < lastFrame + MaxTrailingFrames);
+}
+
+Benchmark::Row* Benchmark::GetRow(int frameNumber)
+{
+	if (mFirstFrame < 0 || frameNumber < mFirstFrame || frameNumber - mFirstFrame >= static_cast<int>(mRows.size()))
+	{
+		return nullptr;
+	}
+	return &mRows[frameNumber - mFirstFrame];
+}
+
+bool Benchmark::Write() const
+{
+	//one column per scope name seen, in the order they first show up
+	std::vector<const char*> scopes;
+	for (const Row& row : mRows)
+	{
+		for (const GpuScopeTiming& timing : row.mGpuTimings)
+		{
+			if (std::none_of(scopes.begin(), scopes.end(), [&timing](const char* name) { return strcmp(name, timing.mName) == 0; }))
+			{
+				scopes.push_back(timing.mName);
+			}
+		}
+	}
+
+	std::ofstream out(mCsvPath, std::ios::trunc);
+	if (!out)
+	{
+		SDL_Log("Benchmark : failed to write %s", mCsvPath.c_str());
+		return false;
+	}
+	out << "frame,cpu_ms,draw_calls,triangles,meshes_culled,mesh_build_ms,point_lights,light_bin_ms,render_scale";
+	for (const char* scope : scopes)
+	{
+		out << ',' << GetGpuColumn(scope);
+	}
+	out << '\n';
+
+	//missing values stay empty cells
+	std::vector<double> cpuMs;
+	double gpuTotal = 0.0;
+	size_t numGpu = 0;
+	for (size_t i = 0; i < mRows.size(); ++i)
+	{
+		const Row& row = mRows[i];
+		out << i << ',';
+		if (row.mHasCpu)
+		{
+			out << row.mCpuMs;
+			cpuMs.push_back(row.mCpuMs);
+		}
+		if (row.mHasStats)
+		{
+			const RenderStats& stats = row.mStats;
+			out << ',' << stats.mDrawCalls << ',' << stats.mTriangles << ',' << stats.mMeshesCulled << ','
+				<< stats.mMeshBuildMs << ',' << stats.mPointLights << ',' << stats.mLightBinMs << ',' << stats.mRenderScale;
+		}
+		else
+		{
+			out << ",,,,,,,";
+		}
+		for (const char* scope : scopes)
+		{
+			out << ',';
+			for (const GpuScopeTiming& timing : row.mGpuTimings)
+			{
+				if (strcmp(timing.mName, scope) == 0)
+				{
+					out << timing.mMs;
+					break;
+				}
+			}
+		}
+		out << '\n';
+		//the frame scope comes first
+		if (!row.mGpuTimings.empty())
+		{
+			gpuTotal += row.mGpuTimings.front().mMs;
+			++numGpu;
+		}
+	}
+
+	double cpuAvg = 0.0;
+	double cpu95 = 0.0;
+	if (!cpuMs.empty())
+	{
+		for (double ms : cpuMs)
+		{
+			cpuAvg += ms;
+		}
+		cpuAvg /= cpuMs.size();
+		std::sort(cpuMs.begin(), cpuMs.end());
+		cpu95 = cpuMs[std::min(cpuMs.size() - 1, cpuMs.size() * 95 / 100)];
+	}
+	SDL_Log("Benchmark : %zu frames, CPU %.2f ms average and %.2f ms at the 95th percentile, GPU %.2f ms average, written to %s",
+		mRows.size(), cpuAvg, cpu95, numGpu > 0 ? gpuTotal / numGpu : 0.0, mCsvPath.c_str());
+	return true;
+}
\ No newline at end of file
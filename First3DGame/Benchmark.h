@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Renderer.h"
+
+//--benchmark: flies the camera around a fixed loop at a fixed time step and writes one CSV row
+//per frame with the CPU frame time, the renderer's counts and the GPU timings. Frames before
+//the mesh programs are ready are a warm-up and not recorded. The renderer's numbers arrive a
+//few frames late, so they are filed under the frame number they carry and the run goes on
+//until the last recorded frame has them
+class Benchmark
+{
+public:
+	static constexpr float TimeStep = 1.0f / 60.0f;
+	//seconds per loop around the arena
+	static constexpr float LapTime = 20.0f;
+
+	Benchmark(const std::string& csvPath, int numFrames);
+
+	//poses the camera for the frame Renderer::GetFrameNumber is about to submit
+	void PlaceCamera(class Actor* camera, unsigned int frameNumber) const;
+	//after the frame is submitted, with the time the whole game loop took; false when done
+	bool EndFrame(unsigned int frameNumber, double cpuMs, const RenderStats& stats);
+	//writes the CSV and logs the averages
+	bool Write() const;
+private:
+	struct Row
+	{
+		double mCpuMs = 0.0;
+		bool mHasCpu = false;
+		//without mGpuTimings, which come from a later frame's stats
+		RenderStats mStats;
+		bool mHasStats = false;
+		std::vector<GpuScopeTiming> mGpuTimings;
+		bool mHasGpu = false;
+	};
+
+	//nullptr outside the recorded frames
+	Row* GetRow(int frameNumber);
+
+	std::string mCsvPath;
+	std::vector<Row> mRows;
+	//the frame number of mRows[0], -1 while warming up
+	int mFirstFrame;
+};
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "DynamicResolution.h"
+#include <glew.h>
+#include <SDL.h>
+#include <cmath>
+#include <cstring>
+#include "Math.h"
+#include "GpuDebug.h"
+
+namespace
+{
+	const float MinScaleLimit = 0.25f;
+	//weight of each new frame in the average
+	const float Smoothing = 0.1f;
+	//frames measured at a new scale before it is judged; the timings trail by a few frames
+	const int MinSamples = 10;
+	//between these fractions of the target the scale is left alone
+	const float RaiseBelow = 0.8f;
+	const float LowerAbove = 1.0f;
+	//a change aims inside that band, so the next frames do not cross it again
+	const float AimAt = 0.9f;
+	//drops quickly when over budget, climbs back slowly
+	const float MaxStepDown = 0.15f;
+	const float MaxStepUp = 0.05f;
+	//scales are multiples of 1/Steps, which keeps tiny corrections from resizing every few frames
+	const float Steps = 32.0f;
+}
+
+DynamicResolution::DynamicResolution(int width, int height)
+	:mWidth(width)
+	, mHeight(height)
+	, mFramebuffer(0)
+	, mRenderbuffers{ 0, 0 }
+	, mScale(1.0f)
+	, mSceneWidth(width)
+	, mSceneHeight(height)
+	, mSmoothedMs(0.0f)
+	, mNumSamples(0)
+	, mLastSampleFrame(-1)
+	, mChangeFrame(0)
+{
+	if (!CreateTarget())
+	{
+		SDL_Log("DynamicResolution : scene framebuffer is incomplete, staying at full resolution");
+		glDeleteFramebuffers(1, &mFramebuffer);
+		glDeleteRenderbuffers(2, mRenderbuffers);
+		mFramebuffer = 0;
+	}
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	if (mFramebuffer)
+	{
+		glDeleteFramebuffers(1, &mFramebuffer);
+		glDeleteRenderbuffers(2, mRenderbuffers);
+	}
+}
+
+bool DynamicResolution::CreateTarget()
+{
+	glGenRenderbuffers(2, mRenderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, mRenderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, mWidth, mHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, mRenderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mWidth, mHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previous = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &mFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mRenderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mRenderbuffers[1]);
+	GpuDebug::SetLabel(GL_FRAMEBUFFER, mFramebuffer, "Scaled scene");
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+	return complete;
+}
+
+void DynamicResolution::Update(const DynamicResolutionSettings& settings, unsigned int frameNumber,
+	const std::vector<GpuScopeTiming>& timings, int timingsFrame)
+{
+	float minScale = Math::Clamp(settings.mMinScale, MinScaleLimit, 1.0f);
+	float maxScale = Math::Clamp(settings.mMaxScale, minScale, 1.0f);
+	if (!settings.mEnabled || !mFramebuffer)
+	{
+		minScale = 1.0f;
+		maxScale = 1.0f;
+	}
+	//bounds changed, or the option was turned on or off
+	if (mScale < minScale || mScale > maxScale)
+	{
+		SetScale(Math::Clamp(mScale, minScale, maxScale), frameNumber);
+		return;
+	}
+	if (minScale == maxScale)
+	{
+		return;
+	}
+
+	if (timingsFrame < 0 || timingsFrame == mLastSampleFrame || static_cast<unsigned int>(timingsFrame) < mChangeFrame)
+	{
+		return;
+	}
+	mLastSampleFrame = timingsFrame;
+	float gpuMs = GetGpuMs(timings);
+	mSmoothedMs = mNumSamples == 0 ? gpuMs : Math::Lerp(mSmoothedMs, gpuMs, Smoothing);
+	if (++mNumSamples < MinSamples || mSmoothedMs <= 0.0f)
+	{
+		return;
+	}
+	float target = settings.mTargetMs;
+	if (mSmoothedMs >= target * RaiseBelow && mSmoothedMs <= target * LowerAbove)
+	{
+		return;
+	}
+
+	//the pixel count, and with it most of the mesh pass, goes with the square of the scale
+	float scale = mScale * Math::Sqrt(target * AimAt / mSmoothedMs);
+	scale = Math::Clamp(scale, mScale - MaxStepDown, mScale + MaxStepUp);
+	//rounded down, so a drop always lands below the current scale and a rise never overshoots
+	scale = Math::Clamp(std::floor(scale * Steps) / Steps, minScale, maxScale);
+	if (scale != mScale)
+	{
+		SetScale(scale, frameNumber);
+	}
+}
+
+float DynamicResolution::GetGpuMs(const std::vector<GpuScopeTiming>& timings)
+{
+	//the swap may include waiting for vsync, which a lower resolution does not shorten
+	float ms = 0.0f;
+	for (const GpuScopeTiming& timing : timings)
+	{
+		if (timing.mDepth == 0)
+		{
+			ms += timing.mMs;
+		}
+		else if (timing.mDepth == 1 && strcmp(timing.mName, "Swap") == 0)
+		{
+			ms -= timing.mMs;
+		}
+	}
+	return ms;
+}
+
+void DynamicResolution::SetScale(float scale, unsigned int frameNumber)
+{
+	mScale = scale;
+	mSceneWidth = Math::Max(1, static_cast<int>(mWidth * scale));
+	mSceneHeight = Math::Max(1, static_cast<int>(mHeight * scale));
+	mNumSamples = 0;
+	mChangeFrame = frameNumber;
+}
+
+void DynamicResolution::BeginScene()
+{
+	if (mScale >= 1.0f)
+	{
+		return;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glViewport(0, 0, mSceneWidth, mSceneHeight);
+	//only the part in use
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, mSceneWidth, mSceneHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::EndScene(unsigned int framebuffer)
+{
+	if (mScale >= 1.0f)
+	{
+		return;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glBlitFramebuffer(0, 0, mSceneWidth, mSceneHeight, 0, 0, mWidth, mHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, mWidth, mHeight);
+}
\ No newline at end of file
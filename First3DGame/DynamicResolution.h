@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include "GpuProfiler.h"
+
+struct DynamicResolutionSettings
+{
+	bool mEnabled = false;
+	//fractions of the window's width and height; the upper bound is at most 1
+	float mMinScale = 0.5f;
+	float mMaxScale = 1.0f;
+	//GPU time per frame to stay under
+	float mTargetMs = 1000.0f / 60.0f;
+};
+
+//draws the meshes into an offscreen framebuffer at a fraction of the window size and
+//stretches the result over the window, leaving sprites and text at full resolution. The
+//fraction follows the GPU's frame time: it drops as soon as the smoothed time goes over
+//the target, but only rises once the time is well under it, so it settles instead of
+//bouncing between two sizes. Render thread only
+class DynamicResolution
+{
+public:
+	DynamicResolution(int width, int height);
+	~DynamicResolution();
+
+	//before the frame is drawn, with GpuProfiler's newest timings
+	void Update(const DynamicResolutionSettings& settings, unsigned int frameNumber,
+		const std::vector<GpuScopeTiming>& timings, int timingsFrame);
+	//binds and clears the scaled framebuffer, or does nothing at full scale
+	void BeginScene();
+	//stretches the scene onto framebuffer (0 for the window) and binds it again
+	void EndScene(unsigned int framebuffer);
+
+	float GetScale() const { return mScale; }
+	//the size the meshes are drawn at this frame
+	int GetSceneWidth() const { return mSceneWidth; }
+	int GetSceneHeight() const { return mSceneHeight; }
+private:
+	bool CreateTarget();
+	//GPU time of a frame, without the swap
+	static float GetGpuMs(const std::vector<GpuScopeTiming>& timings);
+	void SetScale(float scale, unsigned int frameNumber);
+
+	int mWidth;
+	int mHeight;
+	//at the window size; 0 if it could not be created, which keeps the scale at 1
+	unsigned int mFramebuffer;
+	unsigned int mRenderbuffers[2];
+	float mScale;
+	int mSceneWidth;
+	int mSceneHeight;
+	//exponential average of the GPU time over the mNumSamples frames drawn since the last change
+	float mSmoothedMs;
+	int mNumSamples;
+	int mLastSampleFrame;
+	//timings of frames before this one were measured at the old scale
+	unsigned int mChangeFrame;
+};
\ No newline at end of file
@@ -0,0 +1,378 @@
+#include "Font.h"
+#include <algorithm>
+#include <cmath>
+#include <glew.h>
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "SpriteBatch.h"
+
+namespace
+{
+	const float Far = 1e20f;
+
+	//squared distance transform along one row or column (Felzenszwalb and Huttenlocher)
+	void DistanceTransform1D(const float* f, float* d, int n, int* v, float* z)
+	{
+		int k = 0;
+		v[0] = 0;
+		z[0] = -Far;
+		z[1] = Far;
+		for (int q = 1; q < n; ++q)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			while (s <= z[k])
+			{
+				--k;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = Far;
+		}
+		k = 0;
+		for (int q = 0; q < n; ++q)
+		{
+			while (z[k + 1] < q)
+			{
+				++k;
+			}
+			float dq = static_cast<float>(q - v[k]);
+			d[q] = dq * dq + f[v[k]];
+		}
+	}
+
+	//in place: grid holds 0 at seed pixels and Far elsewhere, leaves squared distances
+	void DistanceTransform2D(std::vector<float>& grid, int width, int height)
+	{
+		int n = std::max(width, height);
+		std::vector<float> f(n);
+		std::vector<float> d(n);
+		std::vector<int> v(n);
+		std::vector<float> z(n + 1);
+		for (int x = 0; x < width; ++x)
+		{
+			for (int y = 0; y < height; ++y)
+			{
+				f[y] = grid[y * width + x];
+			}
+			DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+			for (int y = 0; y < height; ++y)
+			{
+				grid[y * width + x] = d[y];
+			}
+		}
+		for (int y = 0; y < height; ++y)
+		{
+			DistanceTransform1D(grid.data() + y * width, d.data(), width, v.data(), z.data());
+			std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+		}
+	}
+}
+
+std::vector<unsigned char> SignedDistance::Generate(const unsigned char* coverage, int width, int height, int spread)
+{
+	int paddedWidth = width + spread * 2;
+	int paddedHeight = height + spread * 2;
+	size_t size = static_cast<size_t>(paddedWidth) * paddedHeight;
+	std::vector<float> toInside(size, Far);
+	std::vector<float> toOutside(size, 0.0f);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			if (coverage[y * width + x] >= 128)
+			{
+				size_t i = static_cast<size_t>(y + spread) * paddedWidth + x + spread;
+				toInside[i] = 0.0f;
+				toOutside[i] = Far;
+			}
+		}
+	}
+	DistanceTransform2D(toInside, paddedWidth, paddedHeight);
+	DistanceTransform2D(toOutside, paddedWidth, paddedHeight);
+
+	std::vector<unsigned char> field(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		//pixel centres sit half a pixel off the outline on either side
+		float distance = toInside[i] > 0.0f ? std::sqrt(toInside[i]) - 0.5f : -(std::sqrt(toOutside[i]) - 0.5f);
+		float value = 0.5f - distance / (2.0f * spread);
+		field[i] = static_cast<unsigned char>(Math::Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+	return field;
+}
+
+Font::Font()
+	:mFont(nullptr)
+	, mLineHeight(0)
+{
+
+}
+
+Font::~Font()
+{
+	Unload();
+}
+
+bool Font::Load(const std::string& fileName)
+{
+	mFont = TTF_OpenFont(fileName.c_str(), RasterSize);
+	if (!mFont)
+	{
+		SDL_Log("Failed to load font : %s", fileName.c_str());
+		return false;
+	}
+	mLineHeight = TTF_FontLineSkip(mFont);
+	return true;
+}
+
+void Font::Unload()
+{
+	for (Page& page : mPages)
+	{
+		glDeleteTextures(1, &page.mTextureID);
+	}
+	mPages.clear();
+	mGlyphs.clear();
+	if (mFont)
+	{
+		TTF_CloseFont(mFont);
+		mFont = nullptr;
+	}
+}
+
+const Glyph* Font::GetGlyph(char32_t codepoint)
+{
+	auto iter = mGlyphs.find(codepoint);
+	if (iter != mGlyphs.end())
+	{
+		return &iter->second;
+	}
+	if (!mFont)
+	{
+		return nullptr;
+	}
+	//failures are kept as empty glyphs so they are not retried every frame
+	Glyph glyph;
+	if (!Rasterize(codepoint, glyph))
+	{
+		SDL_Log("Font : cannot rasterize U+%04X", static_cast<unsigned>(codepoint));
+	}
+	return &mGlyphs.emplace(codepoint, glyph).first->second;
+}
+
+float Font::GetKerning(char32_t previous, char32_t next) const
+{
+	return mFont ? static_cast<float>(TTF_GetFontKerningSizeGlyphs32(mFont, previous, next)) : 0.0f;
+}
+
+Vector2 Font::MeasureText(const std::string& text, int pointSize)
+{
+	float lineWidth = 0.0f;
+	float width = 0.0f;
+	int lines = 1;
+	char32_t previous = 0;
+	for (size_t i = 0; i < text.size();)
+	{
+		char32_t codepoint = DecodeUTF8(text, i);
+		if (codepoint == U'\n')
+		{
+			width = std::max(width, lineWidth);
+			lineWidth = 0.0f;
+			previous = 0;
+			++lines;
+			continue;
+		}
+		if (const Glyph* glyph = GetGlyph(codepoint))
+		{
+			lineWidth += (previous ? GetKerning(previous, codepoint) : 0.0f) + glyph->mAdvance;
+			previous = codepoint;
+		}
+	}
+	width = std::max(width, lineWidth);
+	float scale = GetScale(pointSize);
+	return Vector2(width * scale, lines * mLineHeight * scale);
+}
+
+void Font::AddText(SpriteBatch* batch, const std::string& text, int pointSize,
+	const Matrix4& worldTransform, uint32_t color)
+{
+	float scale = GetScale(pointSize);
+	Vector2 size = MeasureText(text, pointSize);
+	float lineHeight = mLineHeight * scale;
+	//pen starts at the top left of the block, y up like the sprites
+	float left = -size.x * 0.5f;
+	float penX = left;
+	float lineTop = size.y * 0.5f;
+	char32_t previous = 0;
+	for (size_t i = 0; i < text.size();)
+	{
+		char32_t codepoint = DecodeUTF8(text, i);
+		if (codepoint == U'\n')
+		{
+			penX = left;
+			lineTop -= lineHeight;
+			previous = 0;
+			continue;
+		}
+		const Glyph* glyph = GetGlyph(codepoint);
+		if (!glyph)
+		{
+			continue;
+		}
+		if (previous)
+		{
+			penX += GetKerning(previous, codepoint) * scale;
+		}
+		previous = codepoint;
+		if (glyph->mWidth > 0.0f)
+		{
+			float minX = penX + glyph->mOffsetX * scale;
+			float maxY = lineTop - glyph->mOffsetY * scale;
+			batch->AddQuad(glyph->mTextureID, glyph->mUV, worldTransform, minX, maxY - glyph->mHeight * scale,
+				minX + glyph->mWidth * scale, maxY, SpriteBlend::Alpha, color);
+		}
+		penX += glyph->mAdvance * scale;
+	}
+}
+
+char32_t Font::DecodeUTF8(const std::string& text, size_t& index)
+{
+	unsigned char lead = static_cast<unsigned char>(text[index++]);
+	if (lead < 0x80)
+	{
+		return lead;
+	}
+	int extra = (lead & 0xe0) == 0xc0 ? 1 : (lead & 0xf0) == 0xe0 ? 2 : (lead & 0xf8) == 0xf0 ? 3 : 0;
+	if (extra == 0)
+	{
+		return 0xfffd;
+	}
+	char32_t codepoint = lead & (0x3f >> extra);
+	for (int i = 0; i < extra; ++i)
+	{
+		if (index >= text.size() || (static_cast<unsigned char>(text[index]) & 0xc0) != 0x80)
+		{
+			return 0xfffd;
+		}
+		codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[index++]) & 0x3f);
+	}
+	return codepoint;
+}
+
+bool Font::Rasterize(char32_t codepoint, Glyph& outGlyph)
+{
+	int minX = 0;
+	int maxX = 0;
+	int minY = 0;
+	int maxY = 0;
+	int advance = 0;
+	if (TTF_GlyphMetrics32(mFont, codepoint, &minX, &maxX, &minY, &maxY, &advance) != 0)
+	{
+		return false;
+	}
+	outGlyph.mAdvance = static_cast<float>(advance);
+
+	SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface* surface = TTF_RenderGlyph32_Blended(mFont, codepoint, white);
+	if (!surface)
+	{
+		//blank glyphs such as spaces only advance the pen
+		return true;
+	}
+	SDL_Surface* formatted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
+	SDL_FreeSurface(surface);
+	if (!formatted)
+	{
+		return true;
+	}
+
+	//the surface spans the whole line height; only the inked box goes into the page
+	int left = formatted->w;
+	int top = formatted->h;
+	int right = -1;
+	int bottom = -1;
+	const unsigned char* pixels = static_cast<const unsigned char*>(formatted->pixels);
+	for (int y = 0; y < formatted->h; ++y)
+	{
+		const unsigned char* row = pixels + y * formatted->pitch;
+		for (int x = 0; x < formatted->w; ++x)
+		{
+			if (row[x * 4 + 3] != 0)
+			{
+				left = std::min(left, x);
+				right = std::max(right, x);
+				top = std::min(top, y);
+				bottom = std::max(bottom, y);
+			}
+		}
+	}
+
+	bool packed = true;
+	if (right >= left)
+	{
+		int width = right - left + 1;
+		int height = bottom - top + 1;
+		std::vector<unsigned char> coverage(static_cast<size_t>(width) * height);
+		for (int y = 0; y < height; ++y)
+		{
+			const unsigned char* row = pixels + (y + top) * formatted->pitch;
+			for (int x = 0; x < width; ++x)
+			{
+				coverage[y * width + x] = row[(x + left) * 4 + 3];
+			}
+		}
+		std::vector<unsigned char> field = SignedDistance::Generate(coverage.data(), width, height, Spread);
+		packed = Pack(field, width + Spread * 2, height + Spread * 2, outGlyph);
+		outGlyph.mOffsetX = static_cast<float>(left - Spread);
+		outGlyph.mOffsetY = static_cast<float>(top - Spread);
+	}
+	SDL_FreeSurface(formatted);
+	return packed;
+}
+
+bool Font::Pack(const std::vector<unsigned char>& field, int width, int height, Glyph& outGlyph)
+{
+	if (width > PageSize || height > PageSize)
+	{
+		return false;
+	}
+
+	int x = 0;
+	int y = 0;
+	Page* page = mPages.empty() ? nullptr : &mPages.back();
+	if (!page || !page->mPacker.Pack(width, height, x, y))
+	{
+		//the field is stored single channel; linear filtering interpolates distances
+		std::vector<unsigned char> clear(static_cast<size_t>(PageSize) * PageSize, 0);
+		unsigned int textureID = 0;
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, PageSize, PageSize, 0, GL_RED, GL_UNSIGNED_BYTE, clear.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		mPages.push_back({ SkylinePacker(PageSize, PageSize), textureID });
+		page = &mPages.back();
+		if (!page->mPacker.Pack(width, height, x, y))
+		{
+			return false;
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, page->mTextureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_UNSIGNED_BYTE, field.data());
+
+	outGlyph.mTextureID = page->mTextureID;
+	outGlyph.mUV.mU0 = static_cast<float>(x) / PageSize;
+	outGlyph.mUV.mV0 = static_cast<float>(y) / PageSize;
+	outGlyph.mUV.mU1 = static_cast<float>(x + width) / PageSize;
+	outGlyph.mUV.mV1 = static_cast<float>(y + height) / PageSize;
+	outGlyph.mWidth = static_cast<float>(width);
+	outGlyph.mHeight = static_cast<float>(height);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Math.h"
+#include "Texture.h"
+#include "SkylinePacker.h"
+
+struct Glyph
+{
+	unsigned int mTextureID = 0;
+	TextureRect mUV;
+	//quad relative to the pen at the top of the line, in raster pixels, y down
+	float mOffsetX = 0.0f;
+	float mOffsetY = 0.0f;
+	float mWidth = 0.0f;
+	float mHeight = 0.0f;
+	float mAdvance = 0.0f;
+};
+
+//a TTF font opened once at RasterSize. Glyphs are rasterized on first use, turned into
+//signed distance fields and packed into single channel pages, so any point size draws
+//sharp from the same glyphs and new strings only cost vertex writes
+class Font
+{
+public:
+	Font();
+	~Font();
+
+	bool Load(const std::string& fileName);
+	void Unload();
+
+	//rasterizes on first use; glyphs the font cannot render come back empty
+	const Glyph* GetGlyph(char32_t codepoint);
+	float GetKerning(char32_t previous, char32_t next) const;
+	float GetLineHeight() const { return static_cast<float>(mLineHeight); }
+	//size in pixels of the (possibly multi-line) string drawn at pointSize
+	Vector2 MeasureText(const std::string& text, int pointSize);
+	//adds glyph quads for the string centred on the world transform's origin, y up
+	void AddText(class SpriteBatch* batch, const std::string& text, int pointSize,
+		const Matrix4& worldTransform, uint32_t color);
+
+	size_t GetNumGlyphs() const { return mGlyphs.size(); }
+	size_t GetNumPages() const { return mPages.size(); }
+
+	static float GetScale(int pointSize) { return static_cast<float>(pointSize) / RasterSize; }
+	//advances index past one codepoint; invalid bytes come back as U+FFFD
+	static char32_t DecodeUTF8(const std::string& text, size_t& index);
+
+	static const int RasterSize = 48;
+	//distance in raster pixels covered by the field on either side of the outline
+	static const int Spread = 6;
+	static const int PageSize = 512;
+private:
+	struct Page
+	{
+		SkylinePacker mPacker;
+		unsigned int mTextureID;
+	};
+
+	bool Rasterize(char32_t codepoint, Glyph& outGlyph);
+	//writes the padded field into a page; false when the glyph fits no page
+	bool Pack(const std::vector<unsigned char>& field, int width, int height, Glyph& outGlyph);
+
+	struct _TTF_Font* mFont;
+	std::unordered_map<char32_t, Glyph> mGlyphs;
+	std::vector<Page> mPages;
+	int mLineHeight;
+};
+
+namespace SignedDistance
+{
+	//coverage is 8-bit alpha; the result is padded by spread on every side and maps the
+	//outline to 128, with spread pixels inside at 255 and outside at 0
+	std::vector<unsigned char> Generate(const unsigned char* coverage, int width, int height, int spread);
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "FrameCapture.h"
+#include <glew.h>
+#include <SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include "ThreadPool.h"
+#include "GpuDebug.h"
+
+struct FrameCapture::WriteState
+{
+	std::mutex mMutex;
+	std::condition_variable mDone;
+	int mPending = 0;
+};
+
+namespace
+{
+	//PNG and zlib both use the plain CRC-32 / Adler-32
+	uint32_t UpdateCrc(uint32_t crc, const uint8_t* data, size_t size)
+	{
+		static const std::array<uint32_t, 256> table = []()
+			{
+				std::array<uint32_t, 256> t{};
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					uint32_t c = i;
+					for (int k = 0; k < 8; ++k)
+					{
+						c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+					}
+					t[i] = c;
+				}
+				return t;
+			}();
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	void PutBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.insert(out.end(), { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+			static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) });
+	}
+
+	void WriteChunk(std::ofstream& out, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> header;
+		PutBigEndian(header, static_cast<uint32_t>(data.size()));
+		header.insert(header.end(), type, type + 4);
+		uint32_t crc = UpdateCrc(0xffffffffu, header.data() + 4, 4);
+		crc = UpdateCrc(crc, data.data(), data.size()) ^ 0xffffffffu;
+		std::vector<uint8_t> footer;
+		PutBigEndian(footer, crc);
+		out.write(reinterpret_cast<const char*>(header.data()), header.size());
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+		out.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+	}
+
+	//GL rows run bottom up and the back buffer's alpha is whatever blending left there
+	void FlipOpaque(const uint8_t* src, uint8_t* dst, int width, int height)
+	{
+		size_t rowSize = static_cast<size_t>(width) * 4;
+		for (int y = 0; y < height; ++y)
+		{
+			memcpy(dst + y * rowSize, src + (height - 1 - y) * rowSize, rowSize);
+			for (size_t x = 3; x < rowSize; x += 4)
+			{
+				dst[y * rowSize + x] = 0xff;
+			}
+		}
+	}
+}
+
+FrameCapture::FrameCapture(ThreadPool* pool)
+	:mPool(pool)
+	, mNextSlot(0)
+	, mWrites(std::make_shared<WriteState>())
+	, mNumDropped(0)
+{
+	for (Slot& slot : mSlots)
+	{
+		glGenBuffers(1, &slot.mBuffer);
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	WaitForWrites();
+	for (Slot& slot : mSlots)
+	{
+		if (slot.mFence)
+		{
+			glDeleteSync(static_cast<GLsync>(slot.mFence));
+		}
+		glDeleteBuffers(1, &slot.mBuffer);
+	}
+}
+
+void FrameCapture::Update()
+{
+	//fences signal in order, so collection stops at the first one still pending
+	for (size_t i = 0; i < NumBuffers; ++i)
+	{
+		Slot& slot = mSlots[(mNextSlot + i) % NumBuffers];
+		if (slot.mFence && !Collect(slot, false))
+		{
+			break;
+		}
+	}
+}
+
+void FrameCapture::Capture(unsigned int frameNumber, int width, int height, const std::string& directory,
+	CaptureFormat format)
+{
+	//a GPU NumBuffers frames behind makes the oldest readback wait; it is due anyway
+	Slot& slot = mSlots[mNextSlot];
+	if (slot.mFence)
+	{
+		Collect(slot, true);
+	}
+
+	size_t size = static_cast<size_t>(width) * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.mBuffer);
+	if (slot.mSize != size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		GpuDebug::SetLabel(GL_BUFFER, slot.mBuffer, "Frame capture");
+		slot.mSize = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.mFrameNumber = frameNumber;
+	slot.mWidth = width;
+	slot.mHeight = height;
+	slot.mDirectory = directory;
+	slot.mFormat = format;
+	mNextSlot = (mNextSlot + 1) % NumBuffers;
+}
+
+void FrameCapture::Flush()
+{
+	for (size_t i = 0; i < NumBuffers; ++i)
+	{
+		Slot& slot = mSlots[(mNextSlot + i) % NumBuffers];
+		if (slot.mFence)
+		{
+			Collect(slot, true);
+		}
+	}
+	WaitForWrites();
+	if (mNumDropped > 0)
+	{
+		SDL_Log("FrameCapture : %u frames dropped, the writes could not keep up", mNumDropped);
+		mNumDropped = 0;
+	}
+}
+
+bool FrameCapture::Collect(Slot& slot, bool wait)
+{
+	GLsync fence = static_cast<GLsync>(slot.mFence);
+	GLenum result = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GL_TIMEOUT_IGNORED : 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+	glDeleteSync(fence);
+	slot.mFence = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(mWrites->mMutex);
+		if (mWrites->mPending >= MaxPendingWrites)
+		{
+			++mNumDropped;
+			return true;
+		}
+		++mWrites->mPending;
+	}
+
+	//the one copy the render thread makes; flipping and encoding happen on the worker
+	auto pixels = std::make_shared<std::vector<uint8_t>>(slot.mSize);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.mBuffer);
+	if (const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.mSize, GL_MAP_READ_BIT))
+	{
+		memcpy(pixels->data(), data, slot.mSize);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	char name[64];
+	if (slot.mFormat == CaptureFormat::Png)
+	{
+		snprintf(name, sizeof(name), "/frame_%06u.png", slot.mFrameNumber);
+	}
+	else
+	{
+		snprintf(name, sizeof(name), "/frame_%06u_%dx%d.rgba", slot.mFrameNumber, slot.mWidth, slot.mHeight);
+	}
+	std::string fileName = slot.mDirectory + name;
+	mPool->Submit([writes = mWrites, pixels, fileName, width = slot.mWidth, height = slot.mHeight,
+		format = slot.mFormat]()
+		{
+			std::vector<uint8_t> image(pixels->size());
+			FlipOpaque(pixels->data(), image.data(), width, height);
+			bool written = false;
+			if (format == CaptureFormat::Png)
+			{
+				written = WritePng(fileName, image.data(), width, height);
+			}
+			else
+			{
+				std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+				out.write(reinterpret_cast<const char*>(image.data()), image.size());
+				written = static_cast<bool>(out);
+			}
+			if (!written)
+			{
+				SDL_Log("FrameCapture : failed to write %s", fileName.c_str());
+			}
+
+			std::lock_guard<std::mutex> lock(writes->mMutex);
+			--writes->mPending;
+			writes->mDone.notify_all();
+		});
+	return true;
+}
+
+void FrameCapture::WaitForWrites()
+{
+	std::unique_lock<std::mutex> lock(mWrites->mMutex);
+	mWrites->mDone.wait(lock, [this] { return mWrites->mPending == 0; });
+}
+
+bool FrameCapture::WritePng(const std::string& fileName, const uint8_t* rgba, int width, int height)
+{
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		return false;
+	}
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	out.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<uint8_t> header;
+	PutBigEndian(header, static_cast<uint32_t>(width));
+	PutBigEndian(header, static_cast<uint32_t>(height));
+	//8 bits per channel, RGBA, deflate, adaptive filtering, no interlace
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	WriteChunk(out, "IHDR", header);
+
+	//zlib stream of stored deflate blocks over the rows, each led by filter type 0
+	size_t rowSize = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; ++y)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+	}
+	const size_t MaxBlock = 65535;
+	std::vector<uint8_t> data;
+	data.reserve(raw.size() + raw.size() / MaxBlock * 5 + 16);
+	data.insert(data.end(), { 0x78, 0x01 });
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (size_t offset = 0; offset < raw.size() || offset == 0; offset += MaxBlock)
+	{
+		uint16_t length = static_cast<uint16_t>(std::min(MaxBlock, raw.size() - offset));
+		bool last = offset + length >= raw.size();
+		data.insert(data.end(), { static_cast<uint8_t>(last ? 1 : 0), static_cast<uint8_t>(length),
+			static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) });
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (size_t i = offset; i < offset + length; ++i)
+		{
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		if (last)
+		{
+			break;
+		}
+	}
+	PutBigEndian(data, (b << 16) | a);
+	WriteChunk(out, "IDAT", data);
+	WriteChunk(out, "IEND", {});
+	return static_cast<bool>(out);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+
+enum class CaptureFormat
+{
+	//8-bit RGBA, stored without compression so encoding stays a copy
+	Png,
+	//RGBA8 rows, top row first, no header; the size is in the file name
+	Raw
+};
+
+//reads finished frames into a ring of pixel pack buffers and maps each one NumBuffers - 1
+//frames later, once a fence says the GPU is done with it, so glReadPixels never waits on the
+//pipeline. Flipping, encoding and writing happen on the thread pool. Render thread only
+class FrameCapture
+{
+public:
+	static const size_t NumBuffers = 3;
+	//frames still waiting on the pool beyond this are dropped instead of piling up in memory
+	static const int MaxPendingWrites = 8;
+
+	explicit FrameCapture(class ThreadPool* pool);
+	//waits for the writes in flight; readbacks not yet collected are lost without Flush
+	~FrameCapture();
+
+	//hands the readbacks that have landed to the pool; once per frame, capturing or not
+	void Update();
+	//queues a readback of the bound read framebuffer, written a few frames later to
+	//directory/frame_000123.png (or frame_000123_1024x768.rgba)
+	void Capture(unsigned int frameNumber, int width, int height, const std::string& directory, CaptureFormat format);
+	//collects every readback, waiting on the GPU, then waits for the writes
+	void Flush();
+
+	//frames lost to a backed up pool since the last Flush
+	unsigned int GetNumDropped() const { return mNumDropped; }
+
+	static bool WritePng(const std::string& fileName, const uint8_t* rgba, int width, int height);
+private:
+	struct Slot
+	{
+		unsigned int mBuffer = 0;
+		size_t mSize = 0;
+		//a GLsync
+		void* mFence = nullptr;
+		unsigned int mFrameNumber = 0;
+		int mWidth = 0;
+		int mHeight = 0;
+		std::string mDirectory;
+		CaptureFormat mFormat = CaptureFormat::Png;
+	};
+	//shared with the write jobs, which may outlive a frame but not the FrameCapture
+	struct WriteState;
+
+	//maps the slot's buffer and submits the write; waits on the fence when wait is set
+	bool Collect(Slot& slot, bool wait);
+	void WaitForWrites();
+
+	class ThreadPool* mPool;
+	std::array<Slot, NumBuffers> mSlots;
+	//the slot the next Capture uses, which is also the oldest one in flight
+	size_t mNextSlot;
+	std::shared_ptr<WriteState> mWrites;
+	unsigned int mNumDropped;
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	SetViewProj(Matrix4::Identity);
+}
+
+Frustum::Frustum(const Matrix4& viewProj)
+{
+	SetViewProj(viewProj);
+}
+
+void Frustum::SetViewProj(const Matrix4& viewProj)
+{
+	//clip = point * viewProj, so column i of the matrix produces clip component i
+	auto column = [&viewProj](int i)
+		{
+			return Plane{ Vector3(viewProj.mat[0][i], viewProj.mat[1][i], viewProj.mat[2][i]), viewProj.mat[3][i] };
+		};
+	auto combine = [](const Plane& a, const Plane& b, float sign)
+		{
+			Plane plane{ a.mNormal + sign * b.mNormal, a.mD + sign * b.mD };
+			float length = plane.mNormal.Length();
+			plane.mNormal *= 1.0f / length;
+			plane.mD /= length;
+			return plane;
+		};
+	Plane w = column(3);
+	for (int i = 0; i < 3; ++i)
+	{
+		Plane c = column(i);
+		mPlanes[i * 2] = combine(w, c, 1.0f);
+		mPlanes[i * 2 + 1] = combine(w, c, -1.0f);
+	}
+	mDepth = w;
+}
+
+bool Frustum::Intersects(const Vector3& center, float radius) const
+{
+	for (const Plane& plane : mPlanes)
+	{
+		if (Vector3::Dot(plane.mNormal, center) + plane.mD < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+float Frustum::GetViewDepth(const Vector3& point) const
+{
+	return Vector3::Dot(mDepth.mNormal, point) + mDepth.mD;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "Math.h"
+
+//the six clip planes of a view-projection matrix, pointing inwards, for culling bounding
+//spheres. Matches GL clipping (-w <= z <= w) for the row-vector matrices of Math.h
+class Frustum
+{
+public:
+	Frustum();
+	explicit Frustum(const Matrix4& viewProj);
+
+	void SetViewProj(const Matrix4& viewProj);
+	//conservative: spheres crossing a plane near a corner still count as inside
+	bool Intersects(const Vector3& center, float radius) const;
+	//distance along the view direction, the clip space w
+	float GetViewDepth(const Vector3& point) const;
+private:
+	struct Plane
+	{
+		Vector3 mNormal;
+		float mD;
+	};
+
+	Plane mPlanes[6];
+	Plane mDepth;
+};
\ No newline at end of file
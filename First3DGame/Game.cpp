@@ -2,6 +2,8 @@
 #include "VertexArray.h"
 #include "Shader.h"
 #include <cstdint>
+#include <filesystem>
+#include <cmath>
 #include "Scene.h"
 #include "Actor.h"
 #include "ResourceManager.h"
@@ -12,8 +14,12 @@
 #include "Mesh.h"
 #include "PlaneActor.h"
 #include "SpriteComponent.h"
+#include "TextComponent.h"
 #include "AudioSystem.h"
 #include "AudioComponent.h"
+#include "ThreadPool.h"
+#include "PointLightComponent.h"
+#include "Benchmark.h"
 
 
 Game* Game::sInstance = nullptr;
@@ -37,16 +43,24 @@ Game::~Game()
 
 bool Game::Initialize()
 {
-	int sdlResult = SDL_Init(SDL_INIT_VIDEO);
+	//headless runs need no display; the renderer brings up video itself if it uses a hidden window
+	int sdlResult = SDL_Init(mHeadless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO);
 	if (sdlResult != 0)
 	{
 		SDL_Log("SDL could not initialize! SDL_Error : %s", SDL_GetError());
 		return false;
 	}
 
+	mThreadPool = std::make_unique<ThreadPool>();
 	mScene = std::make_unique<Scene>(this);
 	mResourceManager = std::make_unique<ResourceManager>(this);
 	mRenderer = std::make_unique<Renderer>(this);
+	if (!mRenderer->Initialize())
+	{
+		SDL_Log("Failed to initialize renderer");
+		mRenderer = nullptr;
+		return false;
+	}
 
 	mAudioSystem = std::make_unique<AudioSystem>(this);
 	if (!mAudioSystem->Initialize())
@@ -58,6 +72,8 @@ bool Game::Initialize()
 	}
 
 	LoadData();
+	//loading is done with the context; from here on GL belongs to the render thread
+	mRenderer->StartRenderThread();
 
 	mTicksCount = SDL_GetTicks();
 
@@ -66,24 +82,52 @@ bool Game::Initialize()
 
 void Game::Shutdown()
 {
-	UnloadData();
-	mAudioSystem->Shutdown();
+	//Initialize may have stopped part way
+	if (mRenderer)
+	{
+		mRenderer->StopRenderThread();
+		UnloadData();
+	}
+	if (mAudioSystem)
+	{
+		mAudioSystem->Shutdown();
+	}
 	SDL_Quit();
 }
 
-void Game::RunLoop()
+void Game::SetBenchmark(const std::string& csvPath, int numFrames)
+{
+	mBenchmark = std::make_unique<Benchmark>(csvPath, numFrames);
+	mHeadless = true;
+	if (mStressMeshes == 0)
+	{
+		mStressMeshes = 10000;
+	}
+}
+
+bool Game::RunLoop()
 {
-	GLenum err;
 	while (mIsRunning)
 	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		unsigned int frameNumber = mRenderer->GetFrameNumber();
 		ProcessInput();
 		UpdateGame();
 		GenerateOutput();
-		while ((err = glGetError()) != GL_NO_ERROR)
+		if (mBenchmark)
 		{
-			SDL_Log("GL_Error : %d", err);
+			double cpuMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+			if (!mBenchmark->EndFrame(frameNumber, cpuMs, mRenderer->GetStats()))
+			{
+				mIsRunning = false;
+			}
 		}
 	}
+	if (mBenchmark)
+	{
+		return mBenchmark->Write();
+	}
+	return true;
 }
 
 void Game::ProcessInput()
@@ -138,6 +182,41 @@ void Game::HandleKeyPress(int key)
 	case 'e':
 		mAudioSystem->PlayEvent("event:/Explosion2D");
 		break;
+	case 'o':
+		mRenderer->SetOcclusionCulling(!mRenderer->GetOcclusionCulling());
+		SDL_Log("Occlusion culling : %s", mRenderer->GetOcclusionCulling() ? "on" : "off");
+		break;
+	case 'f':
+		mRenderer->SetFrontToBack(!mRenderer->GetFrontToBack());
+		SDL_Log("Front to back sorting : %s", mRenderer->GetFrontToBack() ? "on" : "off");
+		break;
+	case 'g':
+		mRenderer->SetGpuOverlay(!mRenderer->GetGpuOverlay());
+		SDL_Log("GPU overlay : %s", mRenderer->GetGpuOverlay() ? "on" : "off");
+		break;
+	case 'c':
+		if (mRenderer->IsCapturing())
+		{
+			mRenderer->StopCapture();
+		}
+		else
+		{
+			mRenderer->StartCapture("Captures");
+		}
+		SDL_Log("Frame capture : %s", mRenderer->IsCapturing() ? "on" : "off");
+		break;
+	case 'v':
+	{
+		DynamicResolutionSettings settings = mRenderer->GetDynamicResolution();
+		settings.mEnabled = !settings.mEnabled;
+		mRenderer->SetDynamicResolution(settings);
+		SDL_Log("Dynamic resolution : %s", settings.mEnabled ? "on" : "off");
+		break;
+	}
+	case 'p':
+		mRenderer->SetDepthPrepass(!mRenderer->GetDepthPrepass());
+		SDL_Log("Depth prepass : %s", mRenderer->GetDepthPrepass() ? "on" : "off");
+		break;
 	case 'm':
 		mMusicEvent.SetPaused(!mMusicEvent.GetPaused());
 		break;
@@ -164,14 +243,44 @@ void Game::HandleKeyPress(int key)
 
 void Game::UpdateGame()
 {
-	while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
-	float deltaTime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
-	mTicksCount = SDL_GetTicks();
-	if (deltaTime > 0.05f)
+	float deltaTime;
+	if (mBenchmark)
+	{
+		//as fast as frames go, with fixed steps so runs compare frame for frame
+		deltaTime = Benchmark::TimeStep;
+		mBenchmark->PlaceCamera(mCameraActor, mRenderer->GetFrameNumber());
+	}
+	else
 	{
-		deltaTime = 0.05f;
+		while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
+		deltaTime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
+		mTicksCount = SDL_GetTicks();
+		if (deltaTime > 0.05f)
+		{
+			deltaTime = 0.05f;
+		}
 	}
 	mScene->Update(deltaTime);
+	if (mStatsText)
+	{
+		const RenderStats& stats = mRenderer->GetStats();
+		char text[128];
+		snprintf(text, sizeof(text), "%u draws\n%u triangles\n%u culled (%.2f ms)\n%u lights (%.2f ms)",
+			stats.mDrawCalls, stats.mTriangles, stats.mMeshesCulled, stats.mMeshBuildMs,
+			stats.mPointLights, stats.mLightBinMs);
+		std::string statsText = text;
+		if (stats.mRenderScale < 1.0f)
+		{
+			snprintf(text, sizeof(text), "\n%.0f%% resolution", stats.mRenderScale * 100.0f);
+			statsText += text;
+		}
+		for (const GpuScopeTiming& timing : stats.mGpuTimings)
+		{
+			snprintf(text, sizeof(text), "\n%*sgpu %s %.2f ms", timing.mDepth * 2, "", timing.mName, timing.mMs);
+			statsText += text;
+		}
+		mStatsText->SetText(statsText);
+	}
 	mAudioSystem->SetListener(mRenderer->GetView());
 	mAudioSystem->Update(deltaTime);
 	//ColorfulBG(deltaTime);
@@ -179,7 +288,8 @@ void Game::UpdateGame()
 
 void Game::GenerateOutput()
 {
-	mRenderer->Draw();
+	//waits for the render thread to finish the previous frame, then hands it this one
+	mRenderer->SubmitFrame();
 }
 
 void Game::LoadData()
@@ -235,6 +345,32 @@ void Game::LoadData()
 		a->SetPosition(Vector3(-start + size, start + i * size, 0.0f));
 		a->SetRotation(q);
 	}
+	mRenderer->RequestStaticBatches();
+
+	//stress scene: a cube of small spheres and cubes over the arena, most of it off screen
+	if (mStressMeshes > 0)
+	{
+		int side = static_cast<int>(std::ceil(std::cbrt(static_cast<float>(mStressMeshes))));
+		float spacing = 2500.0f / side;
+		for (int i = 0; i < mStressMeshes; ++i)
+		{
+			a = mScene->CreateActor<Actor>(this);
+			a->SetPosition(Vector3(start + (i % side) * spacing, start + (i / side % side) * spacing,
+				-50.0f + (i / (side * side)) * spacing * 0.25f));
+			mc = a->AddComponent_Pointer<MeshComponent>(a);
+			if (i % 2 == 0)
+			{
+				a->SetScale(0.25f);
+				mc->SetMesh(mResourceManager->GetMesh("Assets/Sphere.gpmesh"));
+			}
+			else
+			{
+				a->SetScale(10.0f);
+				mc->SetMesh(mResourceManager->GetMesh("Assets/Cube.gpmesh"));
+			}
+		}
+		SDL_Log("Stress scene : %d extra meshes", mStressMeshes);
+	}
 
 	//Light
 	mRenderer->SetAmbientLight(Vector3(0.2f, 0.2f, 0.2f));
@@ -243,20 +379,48 @@ void Game::LoadData()
 	dir.mDiffuseColor = Vector3(0.78f, 0.88f, 1.0f);
 	dir.mSpecColor = Vector3(0.8f, 0.8f, 0.8f);
 
+	//a grid of coloured point lights just over the floor
+	const int lightsPerSide = 16;
+	const float lightSpacing = 2500.0f / lightsPerSide;
+	for (int i = 0; i < lightsPerSide * lightsPerSide; ++i)
+	{
+		a = mScene->CreateActor<Actor>(this);
+		a->SetPosition(Vector3(start + (i % lightsPerSide + 0.5f) * lightSpacing,
+			start + (i / lightsPerSide + 0.5f) * lightSpacing, -60.0f));
+		PointLightComponent* light = a->AddComponent_Pointer<PointLightComponent>(a);
+		float hue = i * 0.618f * Math::TwoPi;
+		light->SetColor(0.6f * Vector3(0.5f + 0.5f * Math::Cos(hue), 0.5f + 0.5f * Math::Cos(hue + Math::TwoPi / 3.0f),
+			0.5f + 0.5f * Math::Cos(hue + 2.0f * Math::TwoPi / 3.0f)));
+		light->SetRadius(lightSpacing);
+	}
+
 	//Camera
 	mCameraActor = mScene->CreateActor<CameraActor>(this);
 
 	//UI
+	if (std::filesystem::exists("Assets/UI.atlas"))
+	{
+		mResourceManager->LoadSpriteAtlas("Assets/UI.atlas");
+	}
 	a = mScene->CreateActor<Actor>(this);
 	a->SetPosition(Vector3(-350.0f, -350.0f, 0.0f));
 	SpriteComponent* sc = a->AddComponent_Pointer<SpriteComponent>(a);
-	sc->SetTexture(mResourceManager->GetTexture("Assets/HealthBar.png"));
+	sc->SetTexture(mResourceManager->GetSpriteTexture("Assets/HealthBar.png"));
 
 	a = mScene->CreateActor<Actor>(this);
 	a->SetPosition(Vector3(375.0f, -275.0f, 0.0f));
 	a->SetScale(0.75f);
 	sc = a->AddComponent_Pointer<SpriteComponent>(a);
-	sc->SetTexture(mResourceManager->GetTexture("Assets/Radar.png"));
+	sc->SetTexture(mResourceManager->GetSpriteTexture("Assets/Radar.png"));
+
+	if (std::filesystem::exists("Assets/Carlito-Regular.ttf"))
+	{
+		a = mScene->CreateActor<Actor>(this);
+		a->SetPosition(Vector3(-400.0f, 330.0f, 0.0f));
+		mStatsText = a->AddComponent_Pointer<TextComponent>(a);
+		mStatsText->SetFont(mResourceManager->GetFont("Assets/Carlito-Regular.ttf"));
+		mStatsText->SetPointSize(20);
+	}
 
 	//spheres with audio
 	a = mScene->CreateActor<Actor>(this);
@@ -3,6 +3,7 @@
 #include <SDL.h>
 #include <glew.h>
 #include <memory>
+#include <string>
 #include <vector>
 #include "SoundEvent.h"
 
@@ -12,7 +13,8 @@ public:
 	Game();
 	~Game();
 	bool Initialize();
-	void RunLoop();
+	//false when a benchmark could not write its results
+	bool RunLoop();
 	void Shutdown();
 
 	static Game& Get() { return *sInstance; }
@@ -20,11 +22,20 @@ public:
 	static class ResourceManager* GetResourceInstance() { return sInstance->mResourceManager.get(); }
 	static class Renderer* GetRendererInstance() { return sInstance->mRenderer.get(); }
 	static class AudioSystem* GetAudioSystemInstance() { return sInstance->mAudioSystem.get(); }
+	static class ThreadPool* GetThreadPoolInstance() { return sInstance->mThreadPool.get(); }
 
 	class Scene* GetScene() const { return mScene.get(); }
 	class ResourceManager* GetResourceManager() const { return mResourceManager.get(); }
 	const Vector2& GetScreenSize() const { return mScreenSize; }
 	void SetGameRunning(bool running) { mIsRunning = running; }
+	bool IsGameRunning() const { return mIsRunning; }
+	//before Initialize: fills the arena with this many extra dynamic meshes to load the renderer
+	void SetStressMeshes(int count) { mStressMeshes = count; }
+	//before Initialize: renders offscreen, on a surfaceless EGL context in RENDERER_EGL builds and behind a hidden window otherwise
+	void SetHeadless(bool headless) { mHeadless = headless; }
+	bool IsHeadless() const { return mHeadless; }
+	//before Initialize: headless, a scripted camera over the stress scene and a CSV of per frame timings
+	void SetBenchmark(const std::string& csvPath, int numFrames);
 private:
 	void ProcessInput();
 	void HandleKeyPress(int key);
@@ -40,12 +51,18 @@ private:
 
 	bool mIsRunning = false;
 
+	std::unique_ptr<class ThreadPool> mThreadPool;
 	std::unique_ptr<class Scene> mScene;
 	std::unique_ptr<class ResourceManager> mResourceManager;
 	std::unique_ptr<class Renderer> mRenderer;
 	std::unique_ptr<class AudioSystem> mAudioSystem;
 
 	class CameraActor* mCameraActor;
+	//frame stats overlay, only when the HUD font ships
+	class TextComponent* mStatsText = nullptr;
+	int mStressMeshes = 0;
+	bool mHeadless = false;
+	std::unique_ptr<class Benchmark> mBenchmark;
 	SoundEvent mMusicEvent;
 	SoundEvent mReverbSnap;
 
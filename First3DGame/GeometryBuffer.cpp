@@ -0,0 +1,166 @@
+#include "GeometryBuffer.h"
+#include <glew.h>
+#include <SDL.h>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include "GpuDebug.h"
+
+GeometryBuffer::GeometryBuffer(VertexLayout layout, unsigned int vertexCapacity, unsigned int indexCapacityBytes)
+	:mLayout(layout)
+	, mStride(VertexFormat::GetStride(layout))
+	, mVertexCapacity(vertexCapacity)
+	, mIndexCapacityBytes(indexCapacityBytes)
+	, mNumVerts(0)
+	, mIndexBytes(0)
+{
+	glGenVertexArrays(1, &mVertexArray);
+	glBindVertexArray(mVertexArray);
+
+	glGenBuffers(1, &mVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, mVertexCapacity * mStride, nullptr, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndexCapacityBytes, nullptr, GL_STATIC_DRAW);
+
+	VertexFormat::SetAttributes(mLayout);
+	LabelObjects();
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+	glDeleteBuffers(1, &mVertexBuffer);
+	glDeleteBuffers(1, &mIndexBuffer);
+	glDeleteVertexArrays(1, &mVertexArray);
+}
+
+GeometryRange GeometryBuffer::Allocate(const void* verts, unsigned int numVerts,
+	const unsigned int* indices, unsigned int numIndices)
+{
+	if (numVerts <= 65536)
+	{
+		std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+		return AllocateRaw(verts, numVerts, shortIndices.data(), numIndices, sizeof(uint16_t));
+	}
+	return AllocateRaw(verts, numVerts, indices, numIndices, sizeof(unsigned int));
+}
+
+GeometryRange GeometryBuffer::AllocateRaw(const void* verts, unsigned int numVerts,
+	const void* indices, unsigned int numIndices, unsigned int indexSize)
+{
+	if (mNumVerts + numVerts > mVertexCapacity)
+	{
+		Grow(mNumVerts + numVerts, mIndexBytes);
+	}
+
+	GeometryRange vertices;
+	vertices.mBaseVertex = mNumVerts;
+	vertices.mNumVerts = numVerts;
+
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, mNumVerts * mStride, numVerts * mStride, verts);
+	mNumVerts += numVerts;
+
+	return AllocateIndicesRaw(vertices, indices, numIndices, indexSize);
+}
+
+GeometryRange GeometryBuffer::AllocateIndices(const GeometryRange& vertices,
+	const unsigned int* indices, unsigned int numIndices)
+{
+	if (vertices.mNumVerts <= 65536)
+	{
+		std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+		return AllocateIndicesRaw(vertices, shortIndices.data(), numIndices, sizeof(uint16_t));
+	}
+	return AllocateIndicesRaw(vertices, indices, numIndices, sizeof(unsigned int));
+}
+
+GeometryRange GeometryBuffer::AllocateIndicesRaw(const GeometryRange& vertices, const void* indices,
+	unsigned int numIndices, unsigned int indexSize)
+{
+	GeometryRange range;
+	range.mBaseVertex = vertices.mBaseVertex;
+	range.mNumVerts = vertices.mNumVerts;
+	range.mNumIndices = numIndices;
+	range.mIndexType = indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	//keep every range aligned to its own index size
+	unsigned int indexOffset = (mIndexBytes + indexSize - 1) / indexSize * indexSize;
+	unsigned int indexBytes = numIndices * indexSize;
+	if (indexOffset + indexBytes > mIndexCapacityBytes)
+	{
+		Grow(mNumVerts, indexOffset + indexBytes);
+	}
+	range.mIndexOffset = indexOffset;
+
+	glBindVertexArray(mVertexArray);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset, indexBytes, indices);
+
+	mIndexBytes = indexOffset + indexBytes;
+	return range;
+}
+
+void GeometryBuffer::ClearIndices(const GeometryRange& range, unsigned int firstIndex, unsigned int numIndices)
+{
+	unsigned int indexSize = range.mIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+	std::vector<uint8_t> zeros(numIndices * indexSize, 0);
+	//the copy target leaves the bound vertex array's element buffer alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mIndexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, range.mIndexOffset + firstIndex * indexSize, zeros.size(), zeros.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryBuffer::SetActive()
+{
+	glBindVertexArray(mVertexArray);
+}
+
+void GeometryBuffer::Draw(const GeometryRange& range)
+{
+	glDrawElementsBaseVertex(GL_TRIANGLES, range.mNumIndices, range.mIndexType,
+		reinterpret_cast<void*>(static_cast<uintptr_t>(range.mIndexOffset)), range.mBaseVertex);
+}
+
+void GeometryBuffer::Grow(unsigned int minVerts, unsigned int minIndexBytes)
+{
+	unsigned int newVertexCapacity = std::max(mVertexCapacity * 2, minVerts);
+	unsigned int newIndexCapacityBytes = std::max(mIndexCapacityBytes * 2, minIndexBytes);
+	SDL_Log("GeometryBuffer : growing to %u verts, %u index bytes", newVertexCapacity, newIndexCapacityBytes);
+
+	unsigned int newVertexBuffer = 0;
+	glGenBuffers(1, &newVertexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newVertexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newVertexCapacity * mStride, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, mVertexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mNumVerts * mStride);
+
+	unsigned int newIndexBuffer = 0;
+	glGenBuffers(1, &newIndexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newIndexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newIndexCapacityBytes, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, mIndexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mIndexBytes);
+
+	glDeleteBuffers(1, &mVertexBuffer);
+	glDeleteBuffers(1, &mIndexBuffer);
+	mVertexBuffer = newVertexBuffer;
+	mIndexBuffer = newIndexBuffer;
+	LabelObjects();
+	mVertexCapacity = newVertexCapacity;
+	mIndexCapacityBytes = newIndexCapacityBytes;
+
+	glBindVertexArray(mVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	VertexFormat::SetAttributes(mLayout);
+}
+
+void GeometryBuffer::LabelObjects()
+{
+	const char* name = VertexFormat::GetName(mLayout);
+	GpuDebug::SetLabel(GL_VERTEX_ARRAY, mVertexArray, name);
+	GpuDebug::SetLabel(GL_BUFFER, mVertexBuffer, name);
+	GpuDebug::SetLabel(GL_BUFFER, mIndexBuffer, name);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include "VertexFormat.h"
+
+struct GeometryRange
+{
+	unsigned int mBaseVertex = 0;
+	unsigned int mNumVerts = 0;
+	unsigned int mIndexOffset = 0;
+	unsigned int mNumIndices = 0;
+	unsigned int mIndexType = 0;
+};
+
+class GeometryBuffer
+{
+public:
+	GeometryBuffer(VertexLayout layout, unsigned int vertexCapacity, unsigned int indexCapacityBytes);
+	~GeometryBuffer();
+
+	//16-bit indices are stored whenever the vertex count allows it
+	GeometryRange Allocate(const void* verts, unsigned int numVerts,
+		const unsigned int* indices, unsigned int numIndices);
+	//uploads indices as-is; indexSize is 2 or 4 bytes
+	GeometryRange AllocateRaw(const void* verts, unsigned int numVerts,
+		const void* indices, unsigned int numIndices, unsigned int indexSize);
+	//adds another index list over the vertices of an existing range (mesh LODs)
+	GeometryRange AllocateIndices(const GeometryRange& vertices, const unsigned int* indices, unsigned int numIndices);
+	GeometryRange AllocateIndicesRaw(const GeometryRange& vertices, const void* indices,
+		unsigned int numIndices, unsigned int indexSize);
+
+	//zeroes numIndices of a range's indices from firstIndex on, which leaves those
+	//triangles degenerate so they draw nothing
+	void ClearIndices(const GeometryRange& range, unsigned int firstIndex, unsigned int numIndices);
+
+	void SetActive();
+	void Draw(const GeometryRange& range);
+
+	VertexLayout GetLayout() const { return mLayout; }
+	unsigned int GetNumVerts() const { return mNumVerts; }
+	unsigned int GetIndexBytes() const { return mIndexBytes; }
+private:
+	void Grow(unsigned int minVerts, unsigned int minIndexBytes);
+	//names the vertex array and both buffers after the layout for GpuDebug
+	void LabelObjects();
+
+	VertexLayout mLayout;
+	unsigned int mStride;
+	unsigned int mVertexCapacity;
+	unsigned int mIndexCapacityBytes;
+	unsigned int mNumVerts;
+	unsigned int mIndexBytes;
+	unsigned int mVertexBuffer;
+	unsigned int mIndexBuffer;
+	unsigned int mVertexArray;
+};
\ No newline at end of file
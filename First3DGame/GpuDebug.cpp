@@ -0,0 +1,125 @@
+#include "GpuDebug.h"
+
+#ifdef GPU_DEBUG
+#include <glew.h>
+#include <SDL.h>
+#include <vector>
+
+namespace
+{
+	bool sHasOutput = false;
+	//groups and labels need KHR_debug; ARB_debug_output only has the messages
+	bool sHasGroups = false;
+	//open groups of the context's thread, innermost last, for the messages
+	std::vector<const char*> sGroups;
+
+	const char* GetSeverityName(GLenum severity)
+	{
+		switch (severity)
+		{
+		case GL_DEBUG_SEVERITY_HIGH:
+			return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM:
+			return "medium";
+		case GL_DEBUG_SEVERITY_LOW:
+			return "low";
+		default:
+			return "note";
+		}
+	}
+
+	const char* GetTypeName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR:
+			return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+			return "deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+			return "undefined behavior";
+		case GL_DEBUG_TYPE_PORTABILITY:
+			return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE:
+			return "performance";
+		default:
+			return "other";
+		}
+	}
+
+	void GLAPIENTRY LogMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+		const GLchar* message, const void* userParam)
+	{
+		SDL_Log("GL %s (%s, 0x%x) in %s : %s", GetTypeName(type), GetSeverityName(severity), id,
+			sGroups.empty() ? "no pass" : sGroups.back(), message);
+	}
+}
+
+void GpuDebug::Initialize()
+{
+	//both share the GL 4.3 enum values
+	if (GLEW_KHR_debug)
+	{
+		glEnable(GL_DEBUG_OUTPUT);
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		glDebugMessageCallback(LogMessage, nullptr);
+		//notifications are driver chatter, like where a buffer was placed or a group being pushed
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+		sHasGroups = true;
+	}
+	else if (GLEW_ARB_debug_output)
+	{
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+		glDebugMessageCallbackARB(LogMessage, nullptr);
+	}
+	else
+	{
+		SDL_Log("GpuDebug : no debug output from this driver, checking glGetError once a frame");
+		return;
+	}
+	sHasOutput = true;
+}
+
+void GpuDebug::PushGroup(const char* name)
+{
+	sGroups.push_back(name);
+	if (sHasGroups)
+	{
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	}
+}
+
+void GpuDebug::PopGroup()
+{
+	if (sGroups.empty())
+	{
+		return;
+	}
+	sGroups.pop_back();
+	if (sHasGroups)
+	{
+		glPopDebugGroup();
+	}
+}
+
+void GpuDebug::SetLabel(unsigned int type, unsigned int object, const char* label)
+{
+	if (sHasGroups)
+	{
+		glObjectLabel(type, object, -1, label);
+	}
+}
+
+void GpuDebug::CheckErrors(const char* where)
+{
+	if (sHasOutput)
+	{
+		return;
+	}
+	GLenum err;
+	while ((err = glGetError()) != GL_NO_ERROR)
+	{
+		SDL_Log("GL_Error : 0x%x in %s", err, where);
+	}
+}
+#endif
\ No newline at end of file
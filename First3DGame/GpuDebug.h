@@ -0,0 +1,32 @@
+#pragma once
+
+//on in debug builds; define GPU_DEBUG to get it in any other build
+#if defined(_DEBUG) && !defined(GPU_DEBUG)
+#define GPU_DEBUG
+#endif
+
+//GL's own error reporting. KHR_debug (or ARB_debug_output) messages are logged synchronously,
+//from inside the call that raised them, so a breakpoint in the callback stops at the culprit.
+//Labels and groups name objects and passes in those messages and in tools like RenderDoc.
+//Without GPU_DEBUG every function here is an empty inline and GL is never asked for errors
+namespace GpuDebug
+{
+#ifdef GPU_DEBUG
+	//after glewInit, on the thread holding the context, which should carry the debug flag
+	void Initialize();
+	//GpuProfiler opens one around each of its scopes
+	void PushGroup(const char* name);
+	void PopGroup();
+	//type is GL_TEXTURE, GL_BUFFER, GL_PROGRAM, GL_VERTEX_ARRAY, GL_FRAMEBUFFER and so on.
+	//Names from glGen* only become objects once bound, so label after the first bind
+	void SetLabel(unsigned int type, unsigned int object, const char* label);
+	//drains glGetError into the log when the driver has no debug output, else does nothing
+	void CheckErrors(const char* where);
+#else
+	inline void Initialize() {}
+	inline void PushGroup(const char*) {}
+	inline void PopGroup() {}
+	inline void SetLabel(unsigned int, unsigned int, const char*) {}
+	inline void CheckErrors(const char*) {}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "GpuProfiler.h"
+#include <glew.h>
+#include <SDL.h>
+#include <algorithm>
+#include "SpriteBatch.h"
+#include "Texture.h"
+#include "GpuDebug.h"
+
+namespace
+{
+	const float FrameBudgetMs = 1000.0f / 60.0f;
+	const float BarWidth = 300.0f;
+	const float BarHeight = 12.0f;
+	const float BarSpacing = 4.0f;
+	const float Margin = 20.0f;
+	//indent per nesting level
+	const float Indent = 10.0f;
+	const Vector3 BarColors[] = { Vector3(0.2f, 0.8f, 0.3f), Vector3(0.3f, 0.6f, 1.0f), Vector3(1.0f, 0.7f, 0.2f),
+		Vector3(0.9f, 0.3f, 0.8f), Vector3(0.3f, 0.9f, 0.9f), Vector3(1.0f, 0.4f, 0.3f) };
+}
+
+GpuProfiler::GpuProfiler()
+	:mWhiteTexture(0)
+{
+	const uint32_t white = 0xffffffff;
+	glGenTextures(1, &mWhiteTexture);
+	glBindTexture(GL_TEXTURE_2D, mWhiteTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+	Texture::SetFiltering(1);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	for (Frame& frame : mFrames)
+	{
+		if (!frame.mQueries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.mQueries.size()), frame.mQueries.data());
+		}
+	}
+	glDeleteTextures(1, &mWhiteTexture);
+}
+
+void GpuProfiler::BeginFrame(unsigned int frameNumber)
+{
+	//oldest first, so mTimings ends up with the newest frame that is done
+	for (size_t i = 1; i <= NumFrames; ++i)
+	{
+		Frame& frame = mFrames[(mCurrentFrame + i) % NumFrames];
+		if (frame.mPending && Resolve(frame))
+		{
+			frame.mPending = false;
+		}
+	}
+
+	//a slot the GPU still has not finished after NumFrames frames is dropped, not waited on
+	Frame& frame = mFrames[mCurrentFrame];
+	frame.mPending = false;
+	frame.mNumQueries = 0;
+	frame.mScopes.clear();
+	frame.mFrameNumber = frameNumber;
+	mOpenScopes.clear();
+	BeginScope("Frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+	while (!mOpenScopes.empty())
+	{
+		EndScope();
+	}
+	mFrames[mCurrentFrame].mPending = true;
+	mCurrentFrame = (mCurrentFrame + 1) % NumFrames;
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+	GpuDebug::PushGroup(name);
+	Frame& frame = mFrames[mCurrentFrame];
+	frame.mScopes.push_back({ name, static_cast<int>(mOpenScopes.size()), IssueQuery(frame), 0 });
+	mOpenScopes.emplace_back(frame.mScopes.size() - 1);
+}
+
+void GpuProfiler::EndScope()
+{
+	if (mOpenScopes.empty())
+	{
+		SDL_Log("GpuProfiler : EndScope without a matching BeginScope");
+		return;
+	}
+	Frame& frame = mFrames[mCurrentFrame];
+	frame.mScopes[mOpenScopes.back()].mEndQuery = IssueQuery(frame);
+	mOpenScopes.pop_back();
+	GpuDebug::PopGroup();
+}
+
+size_t GpuProfiler::IssueQuery(Frame& frame)
+{
+	if (frame.mNumQueries == frame.mQueries.size())
+	{
+		size_t oldSize = frame.mQueries.size();
+		frame.mQueries.resize(std::max<size_t>(oldSize * 2, 16));
+		glGenQueries(static_cast<GLsizei>(frame.mQueries.size() - oldSize), frame.mQueries.data() + oldSize);
+	}
+	glQueryCounter(frame.mQueries[frame.mNumQueries], GL_TIMESTAMP);
+	return frame.mNumQueries++;
+}
+
+bool GpuProfiler::Resolve(Frame& frame)
+{
+	if (frame.mNumQueries == 0)
+	{
+		return true;
+	}
+	//timestamps land in submission order, so the last one tells for the whole frame
+	GLint available = 0;
+	glGetQueryObjectiv(frame.mQueries[frame.mNumQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		return false;
+	}
+
+	mTimings.clear();
+	mTimingsFrame = static_cast<int>(frame.mFrameNumber);
+	for (const Scope& scope : frame.mScopes)
+	{
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(frame.mQueries[scope.mBeginQuery], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.mQueries[scope.mEndQuery], GL_QUERY_RESULT, &end);
+		float ms = end > begin ? static_cast<float>((end - begin) / 1000000.0) : 0.0f;
+		mTimings.push_back({ scope.mName, ms, scope.mDepth });
+	}
+	return true;
+}
+
+void GpuProfiler::DrawOverlay(SpriteBatch* batch, const Vector2& screenSize) const
+{
+	//sprite space is in pixels with the origin at the centre of the screen
+	float left = screenSize.x * 0.5f - Margin - BarWidth;
+	float top = screenSize.y * 0.5f - Margin;
+	float pixelsPerMs = BarWidth / FrameBudgetMs;
+	TextureRect uv;
+	for (size_t i = 0; i < mTimings.size(); ++i)
+	{
+		const GpuScopeTiming& timing = mTimings[i];
+		float minX = left + timing.mDepth * Indent;
+		float maxY = top - i * (BarHeight + BarSpacing);
+		float minY = maxY - BarHeight;
+		batch->AddQuad(mWhiteTexture, uv, Matrix4::Identity, minX, minY, left + BarWidth, maxY,
+			SpriteBlend::Alpha, SpriteBatch::PackColor(Vector3(0.0f, 0.0f, 0.0f), 0.5f));
+		float width = Math::Min(timing.mMs * pixelsPerMs, left + BarWidth - minX);
+		batch->AddQuad(mWhiteTexture, uv, Matrix4::Identity, minX, minY, minX + width, maxY,
+			SpriteBlend::Alpha, SpriteBatch::PackColor(BarColors[i % std::size(BarColors)]));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <array>
+#include "Math.h"
+
+struct GpuScopeTiming
+{
+	//the literal given to BeginScope
+	const char* mName;
+	float mMs;
+	//0 for the frame itself, 1 for scopes directly inside it and so on
+	int mDepth;
+};
+
+//times named passes on the GPU with GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED may
+//nest. Each frame's queries go into one of NumFrames slots and are only read once the
+//driver reports them available, so the render thread never waits on the GPU; the results
+//trail the frame being drawn by a couple of frames. Render thread only
+class GpuProfiler
+{
+public:
+	static const size_t NumFrames = 4;
+
+	GpuProfiler();
+	~GpuProfiler();
+
+	//opens the scope timing the whole frame; the number comes back with its timings
+	void BeginFrame(unsigned int frameNumber);
+	void EndFrame();
+	//name has to outlive the profiler, a string literal in practice. Scopes nest but do not overlap,
+	//and each is also a GpuDebug group
+	void BeginScope(const char* name);
+	void EndScope();
+
+	//the newest frame that has landed, the frame itself first and the rest in the order they began
+	const std::vector<GpuScopeTiming>& GetTimings() const { return mTimings; }
+	//the frame number GetTimings belongs to, -1 until one has landed
+	int GetTimingsFrame() const { return mTimingsFrame; }
+
+	//one bar per timing at the top right of the screen, scaled so a 60 Hz frame fills its background
+	void DrawOverlay(class SpriteBatch* batch, const Vector2& screenSize) const;
+private:
+	struct Scope
+	{
+		const char* mName;
+		int mDepth;
+		size_t mBeginQuery;
+		size_t mEndQuery;
+	};
+	struct Frame
+	{
+		//grown on demand and reused, two per scope
+		std::vector<unsigned int> mQueries;
+		size_t mNumQueries = 0;
+		std::vector<Scope> mScopes;
+		unsigned int mFrameNumber = 0;
+		bool mPending = false;
+	};
+
+	size_t IssueQuery(Frame& frame);
+	//false while the GPU has not passed the last query of the frame
+	bool Resolve(Frame& frame);
+
+	std::array<Frame, NumFrames> mFrames;
+	size_t mCurrentFrame = 0;
+	//indices into the current frame's mScopes
+	std::vector<size_t> mOpenScopes;
+	std::vector<GpuScopeTiming> mTimings;
+	int mTimingsFrame = -1;
+	//1x1 white for the overlay quads
+	unsigned int mWhiteTexture;
+};
\ No newline at end of file
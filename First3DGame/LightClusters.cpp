@@ -0,0 +1,264 @@
+#include "LightClusters.h"
+#include <glew.h>
+#include <SDL.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define LIGHTCLUSTERS_SSE
+#endif
+#include "RenderFrame.h"
+#include "ThreadPool.h"
+#include "Shader.h"
+
+static_assert(LightClusters::PaddedTilesY <= LightClusters::TilesX, "rows share the column plane arrays");
+
+namespace
+{
+	const GLenum TextureFormats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+
+	//orphans the old storage so the draws still reading it do not stall the upload
+	void UploadTextureBuffer(GLuint buffer, const void* data, size_t bytes)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		//an empty buffer texture is incomplete, so there is always one texel
+		glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(bytes, 16), nullptr, GL_STREAM_DRAW);
+		if (bytes > 0)
+		{
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+		}
+	}
+}
+
+LightClusters::LightClusters()
+	:mColumnMin{}
+	, mColumnMax{}
+	, mRowMin{}
+	, mRowMax{}
+{
+	glGenBuffers(3, mBuffers);
+	glGenTextures(3, mTextures);
+	for (int i = 0; i < 3; ++i)
+	{
+		UploadTextureBuffer(mBuffers[i], nullptr, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, mTextures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, TextureFormats[i], mBuffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::~LightClusters()
+{
+	glDeleteTextures(3, mTextures);
+	glDeleteBuffers(3, mBuffers);
+}
+
+void LightClusters::Bin(RenderFrame& frame, ThreadPool* pool)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	frame.mLightGrid.assign(NumClusters * 2, 0);
+	frame.mLightIndices.clear();
+	size_t numLights = frame.mPointLights.size();
+	if (numLights == 0)
+	{
+		return;
+	}
+
+	BuildTilePlanes(frame.mProjection);
+	float nearPlane, farPlane, sliceScale, sliceBias;
+	GetDepthRange(frame.mProjection, nearPlane, farPlane);
+	GetSliceParams(frame.mProjection, sliceScale, sliceBias);
+	auto getSlice = [sliceScale, sliceBias](float depth)
+		{
+			return std::clamp(static_cast<int>(std::log(depth) * sliceScale + sliceBias), 0, NumSlices - 1);
+		};
+
+	//which slices, columns and rows each light touches
+	mBounds.resize(numLights);
+	pool->ParallelFor(numLights, 64, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const PointLight& light = frame.mPointLights[i];
+				Vector3 center = Vector3::Transform(light.mPosition, frame.mView);
+				LightBounds& bounds = mBounds[i];
+				bounds = { 0, 0, 0, -1 };
+				if (center.z + light.mRadius < nearPlane || center.z - light.mRadius > farPlane)
+				{
+					continue;
+				}
+				bounds.mColumns = TestTiles(mColumnMin, mColumnMax, TilesX, center.x, center.z, light.mRadius);
+				bounds.mRows = TestTiles(mRowMin, mRowMax, TilesY, center.y, center.z, light.mRadius);
+				bounds.mFirstSlice = getSlice(Math::Max(center.z - light.mRadius, nearPlane));
+				bounds.mLastSlice = getSlice(Math::Min(center.z + light.mRadius, farPlane));
+			}
+		});
+
+	//every slice counts, then fills, its own clusters with offsets local to the slice
+	const int clustersPerSlice = TilesX * TilesY;
+	mSliceIndices.resize(NumSlices);
+	pool->ParallelFor(NumSlices, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; ++slice)
+			{
+				uint32_t* grid = frame.mLightGrid.data() + slice * clustersPerSlice * 2;
+				auto forEachCluster = [this, slice](auto&& fn)
+					{
+						for (uint32_t i = 0; i < mBounds.size(); ++i)
+						{
+							const LightBounds& bounds = mBounds[i];
+							if (static_cast<int>(slice) < bounds.mFirstSlice || static_cast<int>(slice) > bounds.mLastSlice)
+							{
+								continue;
+							}
+							for (uint32_t rows = bounds.mRows; rows != 0; rows &= rows - 1)
+							{
+								int row = std::countr_zero(rows);
+								for (uint32_t columns = bounds.mColumns; columns != 0; columns &= columns - 1)
+								{
+									fn(row * TilesX + std::countr_zero(columns), i);
+								}
+							}
+						}
+					};
+				forEachCluster([grid](int cluster, uint32_t) { ++grid[cluster * 2 + 1]; });
+				uint32_t offset = 0;
+				for (int cluster = 0; cluster < clustersPerSlice; ++cluster)
+				{
+					grid[cluster * 2] = offset;
+					offset += grid[cluster * 2 + 1];
+					grid[cluster * 2 + 1] = 0;
+				}
+				std::vector<uint32_t>& indices = mSliceIndices[slice];
+				indices.resize(offset);
+				forEachCluster([grid, &indices](int cluster, uint32_t light)
+					{
+						indices[grid[cluster * 2] + grid[cluster * 2 + 1]++] = light;
+					});
+			}
+		});
+
+	std::vector<uint32_t> sliceStarts(NumSlices);
+	size_t numIndices = 0;
+	for (int slice = 0; slice < NumSlices; ++slice)
+	{
+		sliceStarts[slice] = static_cast<uint32_t>(numIndices);
+		numIndices += mSliceIndices[slice].size();
+	}
+	frame.mLightIndices.resize(numIndices);
+	pool->ParallelFor(NumSlices, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; ++slice)
+			{
+				std::copy(mSliceIndices[slice].begin(), mSliceIndices[slice].end(), frame.mLightIndices.begin() + sliceStarts[slice]);
+				uint32_t* grid = frame.mLightGrid.data() + slice * clustersPerSlice * 2;
+				for (int cluster = 0; cluster < clustersPerSlice; ++cluster)
+				{
+					grid[cluster * 2] += sliceStarts[slice];
+				}
+			}
+		});
+	frame.mLightBinMs = static_cast<float>((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void LightClusters::Upload(const RenderFrame& frame)
+{
+	//three texels per light: position and radius, color and outer cone, direction and inner cone
+	mLightData.clear();
+	for (const PointLight& light : frame.mPointLights)
+	{
+		mLightData.insert(mLightData.end(), {
+			light.mPosition.x, light.mPosition.y, light.mPosition.z, light.mRadius,
+			light.mColor.x, light.mColor.y, light.mColor.z, light.mSpotCosOuter,
+			light.mDirection.x, light.mDirection.y, light.mDirection.z, light.mSpotCosInner });
+	}
+	UploadTextureBuffer(mBuffers[0], mLightData.data(), mLightData.size() * sizeof(float));
+	UploadTextureBuffer(mBuffers[1], frame.mLightGrid.data(), frame.mLightGrid.size() * sizeof(uint32_t));
+	UploadTextureBuffer(mBuffers[2], frame.mLightIndices.data(), frame.mLightIndices.size() * sizeof(uint32_t));
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::Bind(Shader* shader, const RenderFrame& frame, float viewportWidth, float viewportHeight) const
+{
+	const char* names[3] = { "uLightData", "uLightGrid", "uLightIndices" };
+	for (int i = 0; i < 3; ++i)
+	{
+		glActiveTexture(GL_TEXTURE2 + i);
+		glBindTexture(GL_TEXTURE_BUFFER, mTextures[i]);
+		shader->SetIntUniform(names[i], 2 + i);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	float sliceScale, sliceBias;
+	GetSliceParams(frame.mProjection, sliceScale, sliceBias);
+	shader->SetVectorUniform("uClusterScale", Vector3(TilesX / viewportWidth, TilesY / viewportHeight, sliceScale));
+	shader->SetFloatUniform("uClusterBias", sliceBias);
+}
+
+void LightClusters::BuildTilePlanes(const Matrix4& projection)
+{
+	//tile edge i sits at NDC -1 + 2i/n, which is view space x/z = ndc / xScale (y likewise)
+	auto build = [](float scale, int numTiles, float (&minPlanes)[2][TilesX], float (&maxPlanes)[2][TilesX])
+		{
+			for (int i = 0; i < numTiles; ++i)
+			{
+				float minSlope = (-1.0f + 2.0f * i / numTiles) / scale;
+				float maxSlope = (-1.0f + 2.0f * (i + 1) / numTiles) / scale;
+				//inside: side - minSlope * z >= 0 and maxSlope * z - side >= 0
+				float minLength = Math::Sqrt(1.0f + minSlope * minSlope);
+				float maxLength = Math::Sqrt(1.0f + maxSlope * maxSlope);
+				minPlanes[0][i] = 1.0f / minLength;
+				minPlanes[1][i] = -minSlope / minLength;
+				maxPlanes[0][i] = -1.0f / maxLength;
+				maxPlanes[1][i] = maxSlope / maxLength;
+			}
+		};
+	build(projection.mat[0][0], TilesX, mColumnMin, mColumnMax);
+	build(projection.mat[1][1], TilesY, mRowMin, mRowMax);
+}
+
+uint32_t LightClusters::TestTiles(const float (&minPlanes)[2][TilesX], const float (&maxPlanes)[2][TilesX],
+	int numTiles, float side, float depth, float radius)
+{
+	uint32_t mask = 0;
+#ifdef LIGHTCLUSTERS_SSE
+	__m128 sides = _mm_set1_ps(side);
+	__m128 depths = _mm_set1_ps(depth);
+	__m128 negRadius = _mm_set1_ps(-radius);
+	for (int i = 0; i < numTiles; i += 4)
+	{
+		__m128 minDist = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&minPlanes[0][i]), sides), _mm_mul_ps(_mm_load_ps(&minPlanes[1][i]), depths));
+		__m128 maxDist = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&maxPlanes[0][i]), sides), _mm_mul_ps(_mm_load_ps(&maxPlanes[1][i]), depths));
+		__m128 inside = _mm_and_ps(_mm_cmpge_ps(minDist, negRadius), _mm_cmpge_ps(maxDist, negRadius));
+		mask |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << i;
+	}
+#else
+	for (int i = 0; i < numTiles; ++i)
+	{
+		float minDist = minPlanes[0][i] * side + minPlanes[1][i] * depth;
+		float maxDist = maxPlanes[0][i] * side + maxPlanes[1][i] * depth;
+		if (minDist >= -radius && maxDist >= -radius)
+		{
+			mask |= 1u << i;
+		}
+	}
+#endif
+	return mask & ((1u << numTiles) - 1);
+}
+
+void LightClusters::GetDepthRange(const Matrix4& projection, float& outNear, float& outFar)
+{
+	//z/w = m22 + m32 / z is 0 at the near plane and 1 at the far plane
+	outNear = -projection.mat[3][2] / projection.mat[2][2];
+	outFar = projection.mat[3][2] / (1.0f - projection.mat[2][2]);
+}
+
+void LightClusters::GetSliceParams(const Matrix4& projection, float& outScale, float& outBias)
+{
+	float nearPlane, farPlane;
+	GetDepthRange(projection, nearPlane, farPlane);
+	outScale = NumSlices / std::log(farPlane / nearPlane);
+	outBias = -std::log(nearPlane) * outScale;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Math.h"
+
+//clustered forward lighting: the view frustum is cut into TilesX x TilesY screen tiles by
+//NumSlices depth slices (exponential from the near plane), and every froxel lists the
+//lights whose sphere touches it. Bin runs on the game thread into the RenderFrame,
+//Upload and Bind on the render thread put the lists in texture buffers for Phong.frag
+class LightClusters
+{
+public:
+	//Phong.frag has the same constants
+	static const int TilesX = 16;
+	static const int TilesY = 9;
+	static const int NumSlices = 24;
+	static const int NumClusters = TilesX * TilesY * NumSlices;
+	//rows rounded up to the SIMD width
+	static const int PaddedTilesY = (TilesY + 3) & ~3;
+
+	LightClusters();
+	~LightClusters();
+
+	//fills frame.mLightGrid and frame.mLightIndices from frame.mPointLights with the
+	//frame's camera; the projection must come from CreatePerspectiveFOV
+	void Bin(struct RenderFrame& frame, class ThreadPool* pool);
+
+	//render thread
+	void Upload(const struct RenderFrame& frame);
+	//the texture buffers on units 2-4 and the uniforms finding a fragment's cluster
+	void Bind(class Shader* shader, const struct RenderFrame& frame, float viewportWidth, float viewportHeight) const;
+private:
+	struct LightBounds
+	{
+		uint32_t mColumns;
+		uint32_t mRows;
+		int mFirstSlice;
+		int mLastSlice;
+	};
+
+	//planes through the eye bounding every tile column and row, stored as the x (or y)
+	//and z of their inward unit normals so four tiles test at a time
+	void BuildTilePlanes(const Matrix4& projection);
+	//bit i set when the view space sphere is inside both planes of tile i
+	static uint32_t TestTiles(const float (&minPlanes)[2][TilesX], const float (&maxPlanes)[2][TilesX],
+		int numTiles, float side, float depth, float radius);
+	static void GetDepthRange(const Matrix4& projection, float& outNear, float& outFar);
+	//slice = log(z) * scale + bias
+	static void GetSliceParams(const Matrix4& projection, float& outScale, float& outBias);
+
+	//game thread
+	std::vector<LightBounds> mBounds;
+	//per slice light indices and per cluster counts while binning
+	std::vector<std::vector<uint32_t>> mSliceIndices;
+	alignas(16) float mColumnMin[2][TilesX];
+	alignas(16) float mColumnMax[2][TilesX];
+	//TilesX wide so both go through TestTiles; only PaddedTilesY are used
+	alignas(16) float mRowMin[2][TilesX];
+	alignas(16) float mRowMax[2][TilesX];
+
+	//render thread; light data, grid and indices
+	std::vector<float> mLightData;
+	unsigned int mBuffers[3];
+	unsigned int mTextures[3];
+};
\ No newline at end of file
@@ -1,13 +1,101 @@
 #include "Game.h"
+#include "Renderer.h"
+#include "MeshCooker.h"
+#include "TextureAtlas.h"
+#include "TextureCooker.h"
+#include "ShaderCache.h"
+#include <string>
+#include <cstdlib>
+#include <vector>
 
 int main(int argc, char** argv)
 {
+	if (argc >= 2 && std::string(argv[1]) == "--cook-meshes")
+	{
+		std::vector<std::string> fileNames(argv + 2, argv + argc);
+		return MeshCooker::CookAll(fileNames) == 0 ? 0 : 1;
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--cook-textures")
+	{
+		std::vector<std::string> fileNames(argv + 2, argv + argc);
+		return TextureCooker::CookAll(fileNames) == 0 ? 0 : 1;
+	}
+	if (argc >= 4 && std::string(argv[1]) == "--build-atlas")
+	{
+		std::vector<std::string> fileNames(argv + 3, argv + argc);
+		return TextureAtlas::Build(argv[2], fileNames) == 0 ? 0 : 1;
+	}
+
+	//run once with this to time a cold shader start against the usual warm one
+	if (argc >= 2 && std::string(argv[1]) == "--clear-shader-cache")
+	{
+		ShaderCache::Clear();
+	}
+
+	//these combine, e.g. --benchmark out.csv --benchmark-frames 2000 --stress-meshes 50000 --capture Frames
+	//or --dynamic-resolution --resolution-bounds 0.5 1 --target-frame-ms 8
 	Game game;
+	std::string benchmarkPath;
+	std::string capturePath;
+	CaptureFormat captureFormat = CaptureFormat::Png;
+	DynamicResolutionSettings resolution;
+	int benchmarkFrames = 1000;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--headless")
+		{
+			game.SetHeadless(true);
+		}
+		else if (i + 1 < argc && arg == "--stress-meshes")
+		{
+			game.SetStressMeshes(std::atoi(argv[++i]));
+		}
+		else if (i + 1 < argc && arg == "--benchmark")
+		{
+			benchmarkPath = argv[++i];
+		}
+		else if (i + 1 < argc && arg == "--benchmark-frames")
+		{
+			benchmarkFrames = std::atoi(argv[++i]);
+		}
+		else if (arg == "--dynamic-resolution")
+		{
+			resolution.mEnabled = true;
+		}
+		else if (i + 2 < argc && arg == "--resolution-bounds")
+		{
+			resolution.mMinScale = static_cast<float>(std::atof(argv[++i]));
+			resolution.mMaxScale = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (i + 1 < argc && arg == "--target-frame-ms")
+		{
+			resolution.mTargetMs = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (i + 1 < argc && (arg == "--capture" || arg == "--capture-raw"))
+		{
+			capturePath = argv[++i];
+			captureFormat = arg == "--capture" ? CaptureFormat::Png : CaptureFormat::Raw;
+		}
+	}
+	if (!benchmarkPath.empty())
+	{
+		game.SetBenchmark(benchmarkPath, benchmarkFrames);
+	}
 	bool success = game.Initialize();
 	if (success)
 	{
-		game.RunLoop();
+		Game::GetRendererInstance()->SetDynamicResolution(resolution);
+	}
+	if (success && !capturePath.empty())
+	{
+		success = Game::GetRendererInstance()->StartCapture(capturePath, captureFormat);
+	}
+	if (success)
+	{
+		success = game.RunLoop();
 	}
 	game.Shutdown();
-	return 0;
+	//scripts running --benchmark see a failed start or an unwritten CSV
+	return success ? 0 : 1;
 }
\ No newline at end of file
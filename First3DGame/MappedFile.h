@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+	const unsigned char* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+	bool IsOpen() const { return mData != nullptr; }
+private:
+	const unsigned char* mData;
+	size_t mSize;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#endif
+};
\ No newline at end of file
@@ -1,18 +1,17 @@
-#define _SILENCE_CXX17_ITERATOR_BASE_CLASS_DEPRECATION_WARNING
-
 #include "Mesh.h"
-#include <fstream>
-#include <sstream>
+#include <cstring>
 #include <SDL.h>
-#include <rapidjson/document.h>
 #include "Math.h"
-#include "VertexArray.h"
+#include "MeshCooker.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "Renderer.h"
 #include "Game.h"
 #include "ResourceManager.h"
 
 Mesh::Mesh()
-	:mVertexArray(nullptr)
+	:mNormalTexture(nullptr)
+	,mLayout(VertexLayout::PosNormTex)
 	,mRadius(0.0f)
 	,mSpecPower(0.0f)
 {
@@ -26,121 +25,251 @@ Mesh::~Mesh()
 
 bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 {
-	std::ifstream file(fileName);
-	if (!file.is_open())
+	if (MeshCooker::IsCookedUpToDate(fileName))
+	{
+		if (LoadCooked(MeshCooker::GetCookedName(fileName), renderer))
+		{
+			return true;
+		}
+		SDL_Log("Cooked mesh for %s is invalid, falling back to json", fileName.c_str());
+	}
+
+	MeshData data;
+	if (!MeshCooker::LoadJson(fileName, data))
 	{
-		SDL_Log("File not found : Mesh %s", fileName.c_str());
 		return false;
 	}
 
-	std::stringstream fileStream;
-	fileStream << file.rdbuf();
-	std::string contents = fileStream.str();
-	rapidjson::StringStream jsonStr(contents.c_str());
-	rapidjson::Document doc;
-	doc.ParseStream(jsonStr);
+	if (Game::GetResourceInstance()->GetOptimizeMeshesOnLoad())
+	{
+		MeshOptimizer::Optimize(data.mVertices, data.mIndices, VertexSize, fileName);
+	}
 
-	if (!doc.IsObject())
+	std::vector<MeshLodLevel> lodLevels;
+	if (Game::GetResourceInstance()->GetGenerateMeshLodsOnLoad())
 	{
-		SDL_Log("Mesh %s is not valid json", fileName.c_str());
-		return false;
+		lodLevels = MeshSimplifier::GenerateLods(data.mVertices, VertexSize, data.mIndices);
+		//level 0 is renumbered along with the rest
+		MeshSimplifier::OptimizeVertexFetch(data.mVertices, VertexSize, lodLevels);
+		data.mIndices = lodLevels[0].mIndices;
 	}
 
-	int ver = doc["version"].GetInt();
+	mShaderName = data.mShaderName;
+	mSpecPower = data.mSpecPower;
+	mRadius = data.mRadius;
+	SetTextures(data.mTextures);
+	SetNormalTexture(data.mNormalTexture);
 
-	if (ver != 1)
+	size_t numVerts = data.mVertices.size() / VertexSize;
+	mLayout = VertexFormat::ChooseLayout(data.mVertices.data(), numVerts);
+	mQuantization = VertexFormat::ComputeQuantization(data.mVertices.data(), numVerts);
+	std::vector<uint8_t> gpuVerts = VertexFormat::Encode(mLayout, data.mVertices.data(), numVerts, mQuantization);
+
+	GeometryBuffer* geometry = renderer->GetMeshGeometry(mLayout);
+	MeshLod source;
+	source.mRange = geometry->Allocate(gpuVerts.data(), static_cast<unsigned>(numVerts),
+		data.mIndices.data(), static_cast<unsigned>(data.mIndices.size()));
+	mLods.emplace_back(source);
+	for (size_t i = 1; i < lodLevels.size(); ++i)
 	{
-		SDL_Log("Mesh %s not version 1", fileName.c_str());
-		return false;
+		MeshLod lod;
+		lod.mRange = geometry->AllocateIndices(source.mRange, lodLevels[i].mIndices.data(),
+			static_cast<unsigned>(lodLevels[i].mIndices.size()));
+		lod.mError = lodLevels[i].mError;
+		mLods.emplace_back(lod);
 	}
 
-	mShaderName = doc["shader"].GetString();
+	mVertices = std::move(data.mVertices);
+	mIndices = std::move(data.mIndices);
+	return true;
+}
 
-	size_t vertSize = 8;
+bool Mesh::LoadCooked(const std::string& fileName, Renderer* renderer)
+{
+	if (!mCookedFile.Open(fileName))
+	{
+		return false;
+	}
 
-	const rapidjson::Value& textures = doc["textures"];
-	if (!textures.IsArray() || textures.Size() < 1)
+	const unsigned char* base = mCookedFile.GetData();
+	size_t size = mCookedFile.GetSize();
+	CookedMeshHeader header;
+	if (size < sizeof(header))
 	{
-		SDL_Log("Mesh %s has no textures, there should be at least one", fileName.c_str());
+		mCookedFile.Close();
 		return false;
 	}
+	memcpy(&header, base, sizeof(header));
 
-	mSpecPower = static_cast<float>(doc["specularPower"].GetDouble());
+	if (memcmp(header.mMagic, "GPMB", 4) != 0 || header.mVersion != MeshCooker::CookedVersion ||
+		header.mLayout >= static_cast<uint32_t>(VertexLayout::NumLayouts) ||
+		(header.mIndexSize != 2 && header.mIndexSize != 4) ||
+		static_cast<size_t>(header.mStringTableOffset) + header.mStringTableBytes > size ||
+		static_cast<size_t>(header.mVertexOffset) + header.mVertexBytes > size ||
+		static_cast<size_t>(header.mIndexOffset) + header.mIndexBytes > size ||
+		header.mVertexBytes != header.mNumVerts * VertexFormat::GetStride(static_cast<VertexLayout>(header.mLayout)) ||
+		header.mIndexBytes % header.mIndexSize != 0 || header.mNumLods < 1 ||
+		static_cast<size_t>(header.mLodTableOffset) + header.mNumLods * sizeof(CookedMeshLod) > size)
+	{
+		SDL_Log("Cooked mesh %s has an invalid header", fileName.c_str());
+		mCookedFile.Close();
+		return false;
+	}
 
-	for (rapidjson::SizeType i = 0; i < textures.Size(); ++i)
+	std::vector<std::string> strings;
+	const char* table = reinterpret_cast<const char*>(base + header.mStringTableOffset);
+	const char* tableEnd = table + header.mStringTableBytes;
+	while (table < tableEnd)
 	{
-		std::string texName = textures[i].GetString();
-		Texture* t = Game::GetResourceInstance()->GetTexture(texName);
-		if (t == nullptr)
+		const char* end = static_cast<const char*>(memchr(table, '\0', tableEnd - table));
+		if (!end)
 		{
-			t = Game::GetResourceInstance()->GetTexture("Assets/Default.png");
+			break;
 		}
-		mTextures.emplace_back(t);
+		strings.emplace_back(table, end);
+		table = end + 1;
 	}
-
-	const rapidjson::Value& vertsJson = doc["vertices"];
-	if (!vertsJson.IsArray() || vertsJson.Size() < 1)
+	if (strings.size() != header.mNumTextures + 2 || header.mNumTextures < 1)
 	{
-		SDL_Log("Mesh %s has no vertices", fileName.c_str());
+		SDL_Log("Cooked mesh %s has an invalid texture table", fileName.c_str());
+		mCookedFile.Close();
 		return false;
 	}
 
-	std::vector<float> vertices;
-	vertices.reserve(vertsJson.Size() * vertSize);
-	mRadius = 0.0f;
-
-	for (rapidjson::SizeType i = 0; i < vertsJson.Size(); ++i)
+	std::vector<CookedMeshLod> lodTable(header.mNumLods);
+	memcpy(lodTable.data(), base + header.mLodTableOffset, header.mNumLods * sizeof(CookedMeshLod));
+	uint32_t totalIndices = header.mIndexBytes / header.mIndexSize;
+	for (const CookedMeshLod& entry : lodTable)
 	{
-		const rapidjson::Value& vert = vertsJson[i];
-		if (!vert.IsArray() || vert.Size() != 8)
+		if (static_cast<size_t>(entry.mFirstIndex) + entry.mNumIndices > totalIndices)
 		{
-			SDL_Log("Unexpected vertex format for %s", fileName.c_str());
+			SDL_Log("Cooked mesh %s has an invalid LOD table", fileName.c_str());
+			mCookedFile.Close();
 			return false;
 		}
+	}
+	if (lodTable[0].mFirstIndex != 0 || lodTable[0].mNumIndices != header.mNumIndices)
+	{
+		SDL_Log("Cooked mesh %s has an invalid LOD table", fileName.c_str());
+		mCookedFile.Close();
+		return false;
+	}
+
+	//nothing is kept until the whole file checks out, since a failure falls back to the json
+	mShaderName = strings[0];
+	mSpecPower = header.mSpecPower;
+	mRadius = header.mRadius;
+	mLayout = static_cast<VertexLayout>(header.mLayout);
+	mQuantization.mOffset.Set(header.mPosOffset[0], header.mPosOffset[1], header.mPosOffset[2]);
+	mQuantization.mScale.Set(header.mPosScale[0], header.mPosScale[1], header.mPosScale[2]);
+	SetTextures(std::vector<std::string>(strings.begin() + 2, strings.end()));
+	SetNormalTexture(strings[1]);
+
+	//every LOD goes up in one upload and becomes a sub range of it
+	GeometryRange all = renderer->GetMeshGeometry(mLayout)->AllocateRaw(base + header.mVertexOffset, header.mNumVerts,
+		base + header.mIndexOffset, totalIndices, header.mIndexSize);
+	for (const CookedMeshLod& entry : lodTable)
+	{
+		MeshLod lod;
+		lod.mRange = all;
+		lod.mRange.mIndexOffset += entry.mFirstIndex * header.mIndexSize;
+		lod.mRange.mNumIndices = entry.mNumIndices;
+		lod.mError = entry.mError;
+		mLods.emplace_back(lod);
+	}
+	return true;
+}
 
-		Vector3 pos(vert[0].GetDouble(), vert[1].GetDouble(), vert[2].GetDouble());
-		mRadius = Math::Max(mRadius, pos.LengthSq());
+size_t Mesh::SelectLod(float screenRadius) const
+{
+	if (mRadius <= 0.0f)
+	{
+		return 0;
+	}
+	for (size_t i = mLods.size(); i-- > 1;)
+	{
+		//object space error scaled to pixels
+		if (mLods[i].mError / mRadius * screenRadius <= MaxLodScreenError)
+		{
+			return i;
+		}
+	}
+	return 0;
+}
 
-		for (rapidjson::SizeType i = 0; i < vert.Size(); ++i)
+void Mesh::SetTextures(const std::vector<std::string>& textureNames)
+{
+	for (const std::string& texName : textureNames)
+	{
+		Texture* t = Game::GetResourceInstance()->GetMaterialTexture(texName);
+		if (t == nullptr)
 		{
-			vertices.emplace_back(static_cast<float>(vert[i].GetDouble()));
+			t = Game::GetResourceInstance()->GetMaterialTexture(ResourceManager::DefaultTexture);
 		}
+		mTextures.emplace_back(t);
+	}
+}
+
+void Mesh::SetNormalTexture(const std::string& textureName)
+{
+	if (textureName.empty())
+	{
+		return;
 	}
+	//without one the mesh is simply lit by its vertex normals
+	mNormalTexture = Game::GetResourceInstance()->GetMaterialTexture(textureName);
+}
 
-	mRadius = Math::Sqrt(mRadius);
+const std::vector<float>& Mesh::GetVertices() const
+{
+	if (mVertices.empty() && mCookedFile.IsOpen())
+	{
+		DecodeCooked();
+	}
+	return mVertices;
+}
 
-	const rapidjson::Value& indJson = doc["indices"];
-	if (!indJson.IsArray() || indJson.Size() < 1)
+const std::vector<unsigned int>& Mesh::GetIndices() const
+{
+	if (mIndices.empty() && mCookedFile.IsOpen())
 	{
-		SDL_Log("Mesh %s has no indices", fileName.c_str());
-		return false;
+		DecodeCooked();
 	}
+	return mIndices;
+}
 
-	std::vector<unsigned int> indices;
-	indices.reserve(indJson.Size() * 3);
-	for (rapidjson::SizeType i = 0; i < indJson.Size(); ++i)
+void Mesh::DecodeCooked() const
+{
+	CookedMeshHeader header;
+	memcpy(&header, mCookedFile.GetData(), sizeof(header));
+	const unsigned char* base = mCookedFile.GetData();
+
+	mVertices = VertexFormat::Decode(mLayout, base + header.mVertexOffset, header.mNumVerts, mQuantization);
+
+	mIndices.resize(header.mNumIndices);
+	for (uint32_t i = 0; i < header.mNumIndices; ++i)
 	{
-		const rapidjson::Value& ind = indJson[i];
-		if (!ind.IsArray() || ind.Size() != 3)
+		if (header.mIndexSize == sizeof(uint16_t))
 		{
-			SDL_Log("Invalid indices for %s", fileName.c_str());
-			return false;
+			uint16_t index;
+			memcpy(&index, base + header.mIndexOffset + i * sizeof(uint16_t), sizeof(index));
+			mIndices[i] = index;
+		}
+		else
+		{
+			uint32_t index;
+			memcpy(&index, base + header.mIndexOffset + i * sizeof(uint32_t), sizeof(index));
+			mIndices[i] = index;
 		}
-
-		indices.emplace_back(ind[0].GetUint());
-		indices.emplace_back(ind[1].GetUint());
-		indices.emplace_back(ind[2].GetUint());
 	}
-
-	mVertexArray = std::make_unique<VertexArray>(vertices.data(), static_cast<unsigned>(vertices.size()) / vertSize,
-		indices.data(), static_cast<unsigned>(indices.size()));
-	return true;
 }
 
 void Mesh::Unload()
 {
-	mVertexArray.reset();
-	mVertexArray = nullptr;
+	mLods.clear();
+	mCookedFile.Close();
+	mVertices.clear();
+	mIndices.clear();
 }
 
 Texture* Mesh::GetTexture(size_t index)
@@ -2,6 +2,15 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include "GeometryBuffer.h"
+#include "MappedFile.h"
+
+struct MeshLod
+{
+	GeometryRange mRange;
+	//object space simplification error, 0 for the source mesh
+	float mError = 0.0f;
+};
 
 class Mesh
 {
@@ -12,14 +21,39 @@ public:
 	bool Load(const std::string& fileName, class Renderer* renderer);
 	void Unload();
 
-	class VertexArray* GetVertexArray() { return mVertexArray.get(); }
+	//LOD 0 is the source mesh; every LOD shares its vertices
+	size_t GetNumLods() const { return mLods.size(); }
+	const MeshLod& GetLod(size_t index) const { return mLods[index]; }
+	//coarsest LOD whose error stays below MaxLodScreenError pixels at this projected radius
+	size_t SelectLod(float screenRadius) const;
+	static constexpr float MaxLodScreenError = 1.0f;
+	VertexLayout GetLayout() const { return mLayout; }
+	const VertexQuantization& GetQuantization() const { return mQuantization; }
 	class Texture* GetTexture(size_t index);
+	//nullptr unless the mesh file lists a normal texture; selects ShaderFeature::NormalMap
+	class Texture* GetNormalTexture() const { return mNormalTexture; }
 	const std::string& GetShaderName() const { return mShaderName; }
 	float GetRadius() const { return mRadius; }
 	float GetSpecPower() const noexcept { return mSpecPower; }
+
+	//cooked meshes decode these from the mapped file on first use
+	const std::vector<float>& GetVertices() const;
+	const std::vector<unsigned int>& GetIndices() const;
+	static constexpr size_t VertexSize = VertexFormat::SourceVertexSize;
 private:
+	bool LoadCooked(const std::string& fileName, class Renderer* renderer);
+	void SetTextures(const std::vector<std::string>& textureNames);
+	void SetNormalTexture(const std::string& textureName);
+	void DecodeCooked() const;
+
 	std::vector<class Texture*> mTextures;
-	std::unique_ptr<class VertexArray> mVertexArray;
+	class Texture* mNormalTexture;
+	std::vector<MeshLod> mLods;
+	VertexLayout mLayout;
+	VertexQuantization mQuantization;
+	MappedFile mCookedFile;
+	mutable std::vector<float> mVertices;
+	mutable std::vector<unsigned int> mIndices;
 	std::string mShaderName;
 	float mRadius;
 	float mSpecPower;
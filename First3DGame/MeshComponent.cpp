@@ -1,51 +1,120 @@
 #include "MeshComponent.h"
-#include "Shader.h"
 #include "Actor.h"
-#include "Texture.h"
 #include "Mesh.h"
-#include "VertexArray.h"
-#include <glew.h>
-#include <SDL.h>
 #include "Game.h"
 #include "Renderer.h"
+#include "RenderFrame.h"
+#include "OcclusionBuffer.h"
+#include <SDL.h>
 
 MeshComponent::MeshComponent(Actor* owner)
 	:Component(owner)
 	, mMesh(nullptr)
 	, mTextureIndex(0)
+	, mCurrentLod(0)
+	, mIsOccluder(false)
+	, mBatch(nullptr)
+	, mBatchIndex(0)
 {
 	Game::GetRendererInstance()->AddMeshComp(this);
 }
 
 MeshComponent::~MeshComponent()
 {
+	Renderer* renderer = Game::GetRendererInstance();
+	if (renderer)
+	{
+		renderer->RemoveMeshComp(this);
+		if (mIsOccluder)
+		{
+			renderer->RemoveOccluder(this);
+		}
+		//at shutdown the batches are already gone with the renderer's data
+		if (mBatch && mOwner->GetGame()->IsGameRunning())
+		{
+			renderer->RemoveFromStaticBatch(this);
+		}
+	}
+}
 
+void MeshComponent::OnUpdateWorldTransform()
+{
+	if (mBatch)
+	{
+		SDL_Log("MeshComponent : a static actor moved after batching, drawing it on its own");
+		Renderer* renderer = Game::GetRendererInstance();
+		renderer->RemoveFromStaticBatch(this);
+		renderer->AddMeshComp(this);
+	}
 }
 
-void MeshComponent::Draw(Shader* shader)
+void MeshComponent::SetOccluder(bool occluder)
 {
-	if (mMesh)
-	{
-		shader->SetMatrixUniform("uWorldTransform",
-			mOwner->GetWorldTransform());
-		shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
-		Texture* t = mMesh->GetTexture(mTextureIndex);
-		if (t)
-		{ 
-			t->SetActive();
-		}
-		else
-		{
-			SDL_Log("MeshComponent : Texture does not get");
-		}
-		VertexArray* va = mMesh->GetVertexArray();
-		SDL_assert(va != nullptr);
-		va->SetActive();
-		glDrawElements(GL_TRIANGLES, va->GetNumIndices(),
-			GL_UNSIGNED_INT, nullptr);
+	if (occluder == mIsOccluder)
+	{
+		return;
+	}
+	mIsOccluder = occluder;
+	if (occluder)
+	{
+		Game::GetRendererInstance()->AddOccluder(this);
 	}
 	else
 	{
-		SDL_Log("Mesh could not draw");
+		Game::GetRendererInstance()->RemoveOccluder(this);
+	}
+}
+
+bool MeshComponent::BuildPacket(const RenderFrame& frame, MeshPacket& outPacket)
+{
+	if (!mMesh)
+	{
+		return false;
+	}
+	const Matrix4& world = mOwner->GetWorldTransform();
+	Vector3 center;
+	float radius;
+	GetBounds(world, center, radius);
+	if (!frame.mFrustum.Intersects(center, radius) || (frame.mOcclusion && !frame.mOcclusion->IsVisible(center, radius)))
+	{
+		return false;
+	}
+
+	float screenRadius = frame.GetProjectedRadius(center, radius);
+	outPacket.mMesh = mMesh;
+	outPacket.mTexture = mMesh->GetTexture(mTextureIndex);
+	outPacket.mWorldTransform = world;
+	outPacket.mRange = mMesh->GetLod(SelectLod(screenRadius)).mRange;
+	outPacket.mScreenSize = screenRadius * 2.0f;
+	outPacket.mViewDepth = frame.mFrustum.GetViewDepth(center);
+	outPacket.mSortKey = MeshPacket::MakeSortKey(mMesh, outPacket.mTexture, outPacket.mViewDepth, frame.mFrontToBack);
+	return true;
+}
+
+void MeshComponent::GetBounds(const Matrix4& world, Vector3& outCenter, float& outRadius) const
+{
+	Vector3 scale = world.GetScale();
+	outCenter = world.GetTranslation();
+	outRadius = mMesh->GetRadius() * Math::Max(scale.x, Math::Max(scale.y, scale.z));
+}
+
+size_t MeshComponent::SelectLod(float screenRadius)
+{
+	if (mMesh->GetNumLods() <= 1)
+	{
+		mCurrentLod = 0;
+		return mCurrentLod;
+	}
+
+	size_t coarser = mMesh->SelectLod(screenRadius * (1.0f + LodHysteresis));
+	size_t finer = mMesh->SelectLod(screenRadius * (1.0f - LodHysteresis));
+	if (coarser > mCurrentLod)
+	{
+		mCurrentLod = coarser;
+	}
+	else if (finer < mCurrentLod)
+	{
+		mCurrentLod = finer;
 	}
+	return mCurrentLod;
 }
\ No newline at end of file
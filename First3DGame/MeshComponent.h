@@ -1,5 +1,6 @@
 #pragma once
 #include "Component.h"
+#include "Math.h"
 
 class MeshComponent : public Component
 {
@@ -7,10 +8,38 @@ public:
 	MeshComponent(class Actor* owner);
 	~MeshComponent();
 
-	virtual void Draw(class Shader* shader);
-	virtual void SetMesh(class Mesh* mesh) { mMesh = mesh; };
+	//fills this frame's packet (transform, LOD, texture, sort key), false when there is
+	//nothing to draw or the bounds are outside the frustum. Only touches this component,
+	//so the renderer calls it for many components at once from worker threads
+	virtual bool BuildPacket(const struct RenderFrame& frame, struct MeshPacket& outPacket);
+	virtual void SetMesh(class Mesh* mesh) { mMesh = mesh; mCurrentLod = 0; };
 	void SetTextureIndex(size_t index) { mTextureIndex = index; };
+	class Mesh* GetMesh() const { return mMesh; }
+	size_t GetTextureIndex() const { return mTextureIndex; }
+	size_t GetCurrentLod() const { return mCurrentLod; }
+	//occluders are rasterized into the renderer's occlusion buffer each frame and hide
+	//the meshes behind them. Meant for big, simple, opaque meshes like walls
+	void SetOccluder(bool occluder);
+	bool IsOccluder() const { return mIsOccluder; }
+	//the StaticBatch drawing this mesh and its index there, set by Renderer::BuildStaticBatches.
+	//Moving the actor afterwards takes the mesh out of the batch and draws it on its own again
+	void SetBatch(class StaticBatch* batch, size_t index) { mBatch = batch; mBatchIndex = index; }
+	class StaticBatch* GetBatch() const { return mBatch; }
+	size_t GetBatchIndex() const { return mBatchIndex; }
+	void OnUpdateWorldTransform() override;
+	//world space bounding sphere of the mesh
+	void GetBounds(const Matrix4& world, Vector3& outCenter, float& outRadius) const;
+
+	//a LOD switch needs the projected size to move this far past the threshold, so
+	//objects sitting on a boundary do not flicker between LODs
+	static constexpr float LodHysteresis = 0.15f;
 protected:
+	size_t SelectLod(float screenRadius);
+
 	class Mesh* mMesh;
 	size_t mTextureIndex;
+	size_t mCurrentLod;
+	bool mIsOccluder;
+	class StaticBatch* mBatch;
+	size_t mBatchIndex;
 };
\ No newline at end of file
@@ -0,0 +1,294 @@
+#define _SILENCE_CXX17_ITERATOR_BASE_CLASS_DEPRECATION_WARNING
+
+#include "MeshCooker.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <SDL.h>
+#include <rapidjson/document.h>
+#include "Math.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+bool MeshCooker::LoadJson(const std::string& fileName, MeshData& outData)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+	{
+		SDL_Log("File not found : Mesh %s", fileName.c_str());
+		return false;
+	}
+
+	std::stringstream fileStream;
+	fileStream << file.rdbuf();
+	std::string contents = fileStream.str();
+	rapidjson::StringStream jsonStr(contents.c_str());
+	rapidjson::Document doc;
+	doc.ParseStream(jsonStr);
+
+	if (!doc.IsObject())
+	{
+		SDL_Log("Mesh %s is not valid json", fileName.c_str());
+		return false;
+	}
+
+	int ver = doc["version"].GetInt();
+
+	if (ver != 1)
+	{
+		SDL_Log("Mesh %s not version 1", fileName.c_str());
+		return false;
+	}
+
+	outData.mShaderName = doc["shader"].GetString();
+
+	VertexLayout sourceLayout;
+	if (!doc["vertexformat"].IsString() ||
+		!VertexFormat::FromName(doc["vertexformat"].GetString(), sourceLayout) ||
+		sourceLayout != VertexLayout::PosNormTex)
+	{
+		SDL_Log("Mesh %s has unsupported vertex format", fileName.c_str());
+		return false;
+	}
+
+	const rapidjson::Value& textures = doc["textures"];
+	if (!textures.IsArray() || textures.Size() < 1)
+	{
+		SDL_Log("Mesh %s has no textures, there should be at least one", fileName.c_str());
+		return false;
+	}
+
+	outData.mSpecPower = static_cast<float>(doc["specularPower"].GetDouble());
+
+	for (rapidjson::SizeType i = 0; i < textures.Size(); ++i)
+	{
+		outData.mTextures.emplace_back(textures[i].GetString());
+	}
+	if (doc.HasMember("normalTexture"))
+	{
+		if (!doc["normalTexture"].IsString())
+		{
+			SDL_Log("Mesh %s has a normal texture that is not a file name", fileName.c_str());
+			return false;
+		}
+		outData.mNormalTexture = doc["normalTexture"].GetString();
+	}
+
+	const rapidjson::Value& vertsJson = doc["vertices"];
+	if (!vertsJson.IsArray() || vertsJson.Size() < 1)
+	{
+		SDL_Log("Mesh %s has no vertices", fileName.c_str());
+		return false;
+	}
+
+	std::vector<float>& vertices = outData.mVertices;
+	vertices.reserve(vertsJson.Size() * VertexFormat::SourceVertexSize);
+	float radiusSq = 0.0f;
+
+	for (rapidjson::SizeType i = 0; i < vertsJson.Size(); ++i)
+	{
+		const rapidjson::Value& vert = vertsJson[i];
+		if (!vert.IsArray() || vert.Size() != VertexFormat::SourceVertexSize)
+		{
+			SDL_Log("Unexpected vertex format for %s", fileName.c_str());
+			return false;
+		}
+
+		Vector3 pos(vert[0].GetDouble(), vert[1].GetDouble(), vert[2].GetDouble());
+		radiusSq = Math::Max(radiusSq, pos.LengthSq());
+
+		for (rapidjson::SizeType i = 0; i < vert.Size(); ++i)
+		{
+			vertices.emplace_back(static_cast<float>(vert[i].GetDouble()));
+		}
+	}
+
+	outData.mRadius = Math::Sqrt(radiusSq);
+
+	const rapidjson::Value& indJson = doc["indices"];
+	if (!indJson.IsArray() || indJson.Size() < 1)
+	{
+		SDL_Log("Mesh %s has no indices", fileName.c_str());
+		return false;
+	}
+
+	//one triple per triangle, so the count is always a multiple of 3. The optimizer and
+	//simplifier index their own per vertex arrays with these, so each one is checked here
+	std::vector<unsigned int>& indices = outData.mIndices;
+	indices.reserve(indJson.Size() * 3);
+	for (rapidjson::SizeType i = 0; i < indJson.Size(); ++i)
+	{
+		const rapidjson::Value& ind = indJson[i];
+		if (!ind.IsArray() || ind.Size() != 3)
+		{
+			SDL_Log("Invalid indices for %s", fileName.c_str());
+			return false;
+		}
+
+		for (rapidjson::SizeType k = 0; k < 3; ++k)
+		{
+			if (!ind[k].IsUint() || ind[k].GetUint() >= vertsJson.Size())
+			{
+				SDL_Log("Mesh %s has an index outside its %u vertices", fileName.c_str(), vertsJson.Size());
+				return false;
+			}
+			indices.emplace_back(ind[k].GetUint());
+		}
+	}
+	return true;
+}
+
+bool MeshCooker::Cook(const std::string& fileName)
+{
+	MeshData data;
+	if (!LoadJson(fileName, data))
+	{
+		return false;
+	}
+	MeshOptimizer::Optimize(data.mVertices, data.mIndices, VertexFormat::SourceVertexSize, fileName);
+	std::vector<MeshLodLevel> lods = MeshSimplifier::GenerateLods(data.mVertices, VertexFormat::SourceVertexSize, data.mIndices);
+	MeshSimplifier::OptimizeVertexFetch(data.mVertices, VertexFormat::SourceVertexSize, lods);
+
+	size_t numVerts = data.mVertices.size() / VertexFormat::SourceVertexSize;
+	VertexLayout layout = VertexFormat::ChooseLayout(data.mVertices.data(), numVerts);
+	VertexQuantization quant = VertexFormat::ComputeQuantization(data.mVertices.data(), numVerts);
+	std::vector<uint8_t> vertexBlob = VertexFormat::Encode(layout, data.mVertices.data(), numVerts, quant);
+
+	std::vector<CookedMeshLod> lodTable;
+	std::vector<unsigned int> allIndices;
+	for (const MeshLodLevel& level : lods)
+	{
+		CookedMeshLod entry;
+		entry.mFirstIndex = static_cast<uint32_t>(allIndices.size());
+		entry.mNumIndices = static_cast<uint32_t>(level.mIndices.size());
+		entry.mError = level.mError;
+		lodTable.emplace_back(entry);
+		allIndices.insert(allIndices.end(), level.mIndices.begin(), level.mIndices.end());
+	}
+
+	std::vector<uint8_t> indexBlob;
+	uint32_t indexSize = numVerts <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+	indexBlob.resize(allIndices.size() * indexSize);
+	for (size_t i = 0; i < allIndices.size(); ++i)
+	{
+		if (indexSize == sizeof(uint16_t))
+		{
+			uint16_t index = static_cast<uint16_t>(allIndices[i]);
+			memcpy(indexBlob.data() + i * indexSize, &index, indexSize);
+		}
+		else
+		{
+			uint32_t index = allIndices[i];
+			memcpy(indexBlob.data() + i * indexSize, &index, indexSize);
+		}
+	}
+
+	std::string stringTable = data.mShaderName;
+	stringTable.push_back('\0');
+	stringTable += data.mNormalTexture;
+	stringTable.push_back('\0');
+	for (const std::string& texture : data.mTextures)
+	{
+		stringTable += texture;
+		stringTable.push_back('\0');
+	}
+
+	auto align = [](uint32_t offset) { return (offset + BlobAlignment - 1) / BlobAlignment * BlobAlignment; };
+
+	CookedMeshHeader header = {};
+	memcpy(header.mMagic, "GPMB", 4);
+	header.mVersion = CookedVersion;
+	header.mLayout = static_cast<uint32_t>(layout);
+	header.mIndexSize = indexSize;
+	header.mNumVerts = static_cast<uint32_t>(numVerts);
+	header.mNumIndices = static_cast<uint32_t>(data.mIndices.size());
+	header.mRadius = data.mRadius;
+	header.mSpecPower = data.mSpecPower;
+	memcpy(header.mPosOffset, quant.mOffset.GetAsFloatPtr(), sizeof(header.mPosOffset));
+	memcpy(header.mPosScale, quant.mScale.GetAsFloatPtr(), sizeof(header.mPosScale));
+	header.mNumTextures = static_cast<uint32_t>(data.mTextures.size());
+	header.mStringTableOffset = sizeof(CookedMeshHeader);
+	header.mStringTableBytes = static_cast<uint32_t>(stringTable.size());
+	header.mNumLods = static_cast<uint32_t>(lodTable.size());
+	header.mLodTableOffset = align(header.mStringTableOffset + header.mStringTableBytes);
+	header.mVertexOffset = align(header.mLodTableOffset + header.mNumLods * static_cast<uint32_t>(sizeof(CookedMeshLod)));
+	header.mVertexBytes = static_cast<uint32_t>(vertexBlob.size());
+	header.mIndexOffset = align(header.mVertexOffset + header.mVertexBytes);
+	header.mIndexBytes = static_cast<uint32_t>(indexBlob.size());
+
+	std::vector<uint8_t> file(header.mIndexOffset + header.mIndexBytes, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + header.mStringTableOffset, stringTable.data(), stringTable.size());
+	memcpy(file.data() + header.mLodTableOffset, lodTable.data(), lodTable.size() * sizeof(CookedMeshLod));
+	memcpy(file.data() + header.mVertexOffset, vertexBlob.data(), vertexBlob.size());
+	memcpy(file.data() + header.mIndexOffset, indexBlob.data(), indexBlob.size());
+
+	std::string cookedName = GetCookedName(fileName);
+	std::ofstream out(cookedName, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		SDL_Log("Failed to write cooked mesh : %s", cookedName.c_str());
+		return false;
+	}
+	out.write(reinterpret_cast<const char*>(file.data()), file.size());
+
+	std::error_code ec;
+	uintmax_t sourceBytes = std::filesystem::file_size(fileName, ec);
+	SDL_Log("Cooked %s : %zu verts (%s), %zu LODs, %llu -> %zu bytes", fileName.c_str(), numVerts,
+		layout == VertexLayout::PosNormTexCompact ? "compact" : "full", lodTable.size(),
+		static_cast<unsigned long long>(ec ? 0 : sourceBytes), file.size());
+	return true;
+}
+
+int MeshCooker::CookAll(std::vector<std::string> fileNames)
+{
+	if (fileNames.empty())
+	{
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator("Assets", ec))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".gpmesh")
+			{
+				fileNames.emplace_back(entry.path().generic_string());
+			}
+		}
+	}
+
+	int failures = 0;
+	for (const std::string& fileName : fileNames)
+	{
+		if (!Cook(fileName))
+		{
+			++failures;
+		}
+	}
+	return failures;
+}
+
+std::string MeshCooker::GetCookedName(const std::string& fileName)
+{
+	return fileName + "b";
+}
+
+bool MeshCooker::IsCookedUpToDate(const std::string& fileName)
+{
+	std::error_code ec;
+	std::filesystem::path cooked(GetCookedName(fileName));
+	if (!std::filesystem::exists(cooked, ec))
+	{
+		return false;
+	}
+	//a shipped build may carry only the cooked file
+	if (!std::filesystem::exists(fileName, ec))
+	{
+		return true;
+	}
+	auto cookedTime = std::filesystem::last_write_time(cooked, ec);
+	if (ec)
+	{
+		return false;
+	}
+	auto sourceTime = std::filesystem::last_write_time(fileName, ec);
+	return !ec && cookedTime >= sourceTime;
+}
\ No newline at end of file
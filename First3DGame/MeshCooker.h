@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "VertexFormat.h"
+
+struct MeshData
+{
+	std::string mShaderName;
+	std::vector<std::string> mTextures;
+	//the "normalTexture" field, empty when the mesh has none
+	std::string mNormalTexture;
+	float mSpecPower = 0.0f;
+	float mRadius = 0.0f;
+	std::vector<float> mVertices;
+	std::vector<unsigned int> mIndices;
+};
+
+//.gpmeshb layout : header, string table (shader name, normal texture name or an
+//empty string, then texture names, each null terminated), LOD table, then the vertex and index blobs, each aligned to
+//BlobAlignment and already in the layout GeometryBuffer uploads.
+//mNumIndices counts LOD 0 only; the index blob holds every LOD back to back
+struct CookedMeshHeader
+{
+	char mMagic[4];
+	uint32_t mVersion;
+	uint32_t mLayout;
+	uint32_t mIndexSize;
+	uint32_t mNumVerts;
+	uint32_t mNumIndices;
+	float mRadius;
+	float mSpecPower;
+	float mPosOffset[3];
+	float mPosScale[3];
+	uint32_t mNumTextures;
+	uint32_t mStringTableOffset;
+	uint32_t mStringTableBytes;
+	uint32_t mVertexOffset;
+	uint32_t mVertexBytes;
+	uint32_t mIndexOffset;
+	uint32_t mIndexBytes;
+	uint32_t mNumLods;
+	uint32_t mLodTableOffset;
+};
+
+struct CookedMeshLod
+{
+	uint32_t mFirstIndex;
+	uint32_t mNumIndices;
+	float mError;
+};
+
+namespace MeshCooker
+{
+	const uint32_t CookedVersion = 4;
+	const uint32_t BlobAlignment = 16;
+
+	bool LoadJson(const std::string& fileName, MeshData& outData);
+	bool Cook(const std::string& fileName);
+	//cooks every .gpmesh given, or every .gpmesh under Assets when the list is empty
+	int CookAll(std::vector<std::string> fileNames);
+
+	std::string GetCookedName(const std::string& fileName);
+	bool IsCookedUpToDate(const std::string& fileName);
+}
\ No newline at end of file
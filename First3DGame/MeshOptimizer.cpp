@@ -0,0 +1,355 @@
+#include "MeshOptimizer.h"
+#include "Math.h"
+#include <SDL.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	const int ForsythCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const size_t MaxClusterTriangles = 64;
+	//overdraw ordering may give up this much vertex cache efficiency
+	const float MaxOverdrawACMRLoss = 1.05f;
+
+	float ForsythScore(int cachePosition, unsigned int remainingTris)
+	{
+		if (remainingTris == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = LastTriScore;
+			}
+			else
+			{
+				float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = 1.0f - (cachePosition - 3) * scaler;
+				score = powf(score, CacheDecayPower);
+			}
+		}
+
+		score += ValenceBoostScale * powf(static_cast<float>(remainingTris), -ValenceBoostPower);
+		return score;
+	}
+
+	Vector3 GetPosition(const std::vector<float>& verts, size_t vertexSize, unsigned int index)
+	{
+		const float* v = verts.data() + index * vertexSize;
+		return Vector3(v[0], v[1], v[2]);
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts)
+{
+	size_t numTris = indices.size() / 3;
+	if (numTris == 0)
+	{
+		return;
+	}
+
+	std::vector<unsigned int> triCounts(numVerts, 0);
+	for (unsigned int index : indices)
+	{
+		++triCounts[index];
+	}
+
+	std::vector<unsigned int> adjacencyOffsets(numVerts + 1, 0);
+	for (size_t v = 0; v < numVerts; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + triCounts[v];
+	}
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t t = 0; t < numTris; ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = indices[t * 3 + k];
+			adjacency[fill[v]++] = static_cast<unsigned int>(t);
+		}
+	}
+
+	std::vector<unsigned int> remaining = triCounts;
+	std::vector<int> cachePos(numVerts, -1);
+	std::vector<float> vertScore(numVerts);
+	for (size_t v = 0; v < numVerts; ++v)
+	{
+		vertScore[v] = ForsythScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triScore(numTris);
+	std::vector<bool> emitted(numTris, false);
+	for (size_t t = 0; t < numTris; ++t)
+	{
+		triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> cache;
+	cache.reserve(ForsythCacheSize + 3);
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	size_t scanStart = 0;
+	int bestTri = -1;
+	for (size_t emittedCount = 0; emittedCount < numTris; ++emittedCount)
+	{
+		if (bestTri < 0)
+		{
+			//nothing adjacent to the cache is left, fall back to the best unused triangle
+			float bestScore = -1.0f;
+			while (scanStart < numTris && emitted[scanStart])
+			{
+				++scanStart;
+			}
+			for (size_t t = scanStart; t < numTris; ++t)
+			{
+				if (!emitted[t] && triScore[t] > bestScore)
+				{
+					bestScore = triScore[t];
+					bestTri = static_cast<int>(t);
+				}
+			}
+		}
+
+		emitted[bestTri] = true;
+		unsigned int triVerts[3] = { indices[bestTri * 3], indices[bestTri * 3 + 1], indices[bestTri * 3 + 2] };
+		for (unsigned int v : triVerts)
+		{
+			output.emplace_back(v);
+			--remaining[v];
+
+			auto cacheIter = std::find(cache.begin(), cache.end(), v);
+			if (cacheIter != cache.end())
+			{
+				cache.erase(cacheIter);
+			}
+			cache.insert(cache.begin(), v);
+		}
+
+		//vertices pushed out of the cache lose their cache bonus
+		for (size_t i = ForsythCacheSize; i < cache.size(); ++i)
+		{
+			cachePos[cache[i]] = -1;
+			vertScore[cache[i]] = ForsythScore(-1, remaining[cache[i]]);
+		}
+		if (cache.size() > static_cast<size_t>(ForsythCacheSize))
+		{
+			cache.resize(ForsythCacheSize);
+		}
+
+		for (size_t i = 0; i < cache.size(); ++i)
+		{
+			cachePos[cache[i]] = static_cast<int>(i);
+			vertScore[cache[i]] = ForsythScore(static_cast<int>(i), remaining[cache[i]]);
+		}
+
+		bestTri = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+			{
+				unsigned int t = adjacency[a];
+				if (emitted[t])
+				{
+					continue;
+				}
+				triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+				if (triScore[t] > bestScore)
+				{
+					bestScore = triScore[t];
+					bestTri = static_cast<int>(t);
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& verts,
+	size_t vertexSize)
+{
+	size_t numTris = indices.size() / 3;
+	size_t numVerts = verts.size() / vertexSize;
+	if (numTris == 0)
+	{
+		return;
+	}
+
+	//split the cache-ordered list into clusters wherever the FIFO would restart,
+	//so reordering clusters keeps most of the vertex cache locality
+	std::vector<size_t> clusterStarts;
+	std::vector<uint32_t> lastSeen(numVerts, UINT32_MAX);
+	uint32_t time = 0;
+	for (size_t t = 0; t < numTris; ++t)
+	{
+		int misses = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = indices[t * 3 + k];
+			if (lastSeen[v] == UINT32_MAX || time - lastSeen[v] >= SimulatedCacheSize)
+			{
+				lastSeen[v] = time++;
+				++misses;
+			}
+		}
+		bool clusterFull = !clusterStarts.empty() && t - clusterStarts.back() >= MaxClusterTriangles;
+		if (clusterStarts.empty() || misses == 3 || clusterFull)
+		{
+			clusterStarts.emplace_back(t);
+		}
+	}
+
+	Vector3 meshCenter;
+	for (size_t v = 0; v < numVerts; ++v)
+	{
+		meshCenter += GetPosition(verts, vertexSize, static_cast<unsigned int>(v));
+	}
+	meshCenter *= 1.0f / static_cast<float>(numVerts);
+
+	struct Cluster
+	{
+		size_t mStart;
+		size_t mEnd;
+		float mSortKey;
+	};
+	std::vector<Cluster> clusters;
+	for (size_t c = 0; c < clusterStarts.size(); ++c)
+	{
+		Cluster cluster;
+		cluster.mStart = clusterStarts[c];
+		cluster.mEnd = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : numTris;
+
+		Vector3 centroid;
+		Vector3 normal;
+		float totalWeight = 0.0f;
+		for (size_t t = cluster.mStart; t < cluster.mEnd; ++t)
+		{
+			Vector3 a = GetPosition(verts, vertexSize, indices[t * 3]);
+			Vector3 b = GetPosition(verts, vertexSize, indices[t * 3 + 1]);
+			Vector3 c2 = GetPosition(verts, vertexSize, indices[t * 3 + 2]);
+			Vector3 area = Vector3::Cross(b - a, c2 - a);
+			float weight = area.Length();
+			centroid += (a + b + c2) * (weight / 3.0f);
+			normal += area;
+			totalWeight += weight;
+		}
+		if (totalWeight > 0.0f)
+		{
+			centroid *= 1.0f / totalWeight;
+		}
+		if (normal.LengthSq() > 0.0f)
+		{
+			normal.Normalize();
+		}
+		//clusters facing away from the centre occlude the rest from most viewpoints
+		cluster.mSortKey = Vector3::Dot(centroid - meshCenter, normal);
+		clusters.emplace_back(cluster);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const Cluster& a, const Cluster& b)
+		{
+			return a.mSortKey > b.mSortKey;
+		});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (const Cluster& cluster : clusters)
+	{
+		output.insert(output.end(), indices.begin() + cluster.mStart * 3, indices.begin() + cluster.mEnd * 3);
+	}
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<float>& verts, std::vector<unsigned int>& indices,
+	size_t vertexSize)
+{
+	size_t numVerts = verts.size() / vertexSize;
+	std::vector<unsigned int> remap(numVerts, UINT32_MAX);
+	std::vector<float> output;
+	output.reserve(verts.size());
+
+	unsigned int nextVertex = 0;
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = nextVertex++;
+			output.insert(output.end(), verts.begin() + index * vertexSize, verts.begin() + (index + 1) * vertexSize);
+		}
+		index = remap[index];
+	}
+	verts.swap(output);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVerts,
+	unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	std::vector<uint32_t> lastSeen(numVerts, UINT32_MAX);
+	std::vector<bool> used(numVerts, false);
+	uint32_t time = 0;
+	size_t uniqueVerts = 0;
+	for (unsigned int v : indices)
+	{
+		if (lastSeen[v] == UINT32_MAX || time - lastSeen[v] >= cacheSize)
+		{
+			lastSeen[v] = time++;
+		}
+		if (!used[v])
+		{
+			used[v] = true;
+			++uniqueVerts;
+		}
+	}
+
+	stats.mACMR = static_cast<float>(time) / static_cast<float>(indices.size() / 3);
+	stats.mATVR = static_cast<float>(time) / static_cast<float>(uniqueVerts);
+	return stats;
+}
+
+void MeshOptimizer::Optimize(std::vector<float>& verts, std::vector<unsigned int>& indices, size_t vertexSize,
+	const std::string& name)
+{
+	size_t numVerts = verts.size() / vertexSize;
+	VertexCacheStats before = AnalyzeVertexCache(indices, numVerts);
+
+	//exporters sometimes already emit a good order, so never keep a worse one
+	std::vector<unsigned int> optimized = indices;
+	OptimizeVertexCache(optimized, numVerts);
+	VertexCacheStats cacheOnly = AnalyzeVertexCache(optimized, numVerts);
+	if (cacheOnly.mACMR < before.mACMR)
+	{
+		indices.swap(optimized);
+	}
+
+	std::vector<unsigned int> overdraw = indices;
+	OptimizeOverdraw(overdraw, verts, vertexSize);
+	float baseACMR = Math::Min(before.mACMR, cacheOnly.mACMR);
+	if (AnalyzeVertexCache(overdraw, numVerts).mACMR <= baseACMR * MaxOverdrawACMRLoss)
+	{
+		indices.swap(overdraw);
+	}
+
+	OptimizeVertexFetch(verts, indices, vertexSize);
+
+	VertexCacheStats after = AnalyzeVertexCache(indices, verts.size() / vertexSize);
+	SDL_Log("MeshOptimizer %s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", name.c_str(),
+		before.mACMR, after.mACMR, before.mATVR, after.mATVR);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <string>
+
+struct VertexCacheStats
+{
+	//average cache miss ratio : transformed vertices per triangle
+	float mACMR = 0.0f;
+	//average transform to vertex ratio : transformed vertices per unique vertex
+	float mATVR = 0.0f;
+};
+
+namespace MeshOptimizer
+{
+	//FIFO size used for the ACMR/ATVR report, close to typical post-transform caches
+	const unsigned int SimulatedCacheSize = 16;
+
+	//Forsyth's linear-speed vertex cache optimisation
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts);
+	//reorders cache-optimised triangle clusters so outward-facing ones come first
+	void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& verts,
+		size_t vertexSize);
+	//renumbers vertices in first-use order and drops unreferenced ones
+	void OptimizeVertexFetch(std::vector<float>& verts, std::vector<unsigned int>& indices,
+		size_t vertexSize);
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVerts,
+		unsigned int cacheSize = SimulatedCacheSize);
+
+	//runs all passes in order and logs the before/after cache statistics
+	void Optimize(std::vector<float>& verts, std::vector<unsigned int>& indices, size_t vertexSize,
+		const std::string& name);
+}
\ No newline at end of file
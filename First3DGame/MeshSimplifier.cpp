@@ -0,0 +1,411 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Math.h"
+#include <queue>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace
+{
+	struct Quadric
+	{
+		//upper triangle of the symmetric 4x4 matrix
+		double m[10] = {};
+		double mNumPlanes = 0.0;
+
+		void AddPlane(double a, double b, double c, double d)
+		{
+			mNumPlanes += 1.0;
+			m[0] += a * a; m[1] += a * b; m[2] += a * c; m[3] += a * d;
+			m[4] += b * b; m[5] += b * c; m[6] += b * d;
+			m[7] += c * c; m[8] += c * d;
+			m[9] += d * d;
+		}
+
+		void Add(const Quadric& q)
+		{
+			for (int i = 0; i < 10; ++i)
+			{
+				m[i] += q.m[i];
+			}
+			mNumPlanes += q.mNumPlanes;
+		}
+
+		double Evaluate(const Vector3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double result = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+				+ m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+				+ m[7] * z * z + 2.0 * m[8] * z
+				+ m[9];
+			return result > 0.0 ? result : 0.0;
+		}
+
+		//root mean square distance to the accumulated planes
+		double GetDistance(const Vector3& p) const
+		{
+			return mNumPlanes > 0.0 ? std::sqrt(Evaluate(p) / mNumPlanes) : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		double mCost;
+		double mDistance;
+		unsigned int mFrom;
+		unsigned int mTo;
+		uint32_t mFromVersion;
+		uint32_t mToVersion;
+
+		bool operator>(const Collapse& other) const { return mCost > other.mCost; }
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<float>& verts, size_t vertexSize, const std::vector<unsigned int>& indices)
+			:mIndices(indices)
+			, mNumVerts(verts.size() / vertexSize)
+			, mPositions(mNumVerts)
+			, mQuadrics(mNumVerts)
+			, mVertexTris(mNumVerts)
+			, mRemap(mNumVerts)
+			, mLocked(mNumVerts, false)
+			, mVersion(mNumVerts, 0)
+			, mTriAlive(indices.size() / 3, true)
+			, mAliveTris(indices.size() / 3)
+		{
+			for (size_t v = 0; v < mNumVerts; ++v)
+			{
+				const float* src = verts.data() + v * vertexSize;
+				mPositions[v] = Vector3(src[0], src[1], src[2]);
+				mRemap[v] = static_cast<unsigned int>(v);
+			}
+
+			for (size_t t = 0; t < mAliveTris; ++t)
+			{
+				const unsigned int* tri = &mIndices[t * 3];
+				Vector3 normal = Vector3::Cross(mPositions[tri[1]] - mPositions[tri[0]],
+					mPositions[tri[2]] - mPositions[tri[0]]);
+				if (normal.LengthSq() > 0.0f)
+				{
+					normal.Normalize();
+				}
+				double d = -Vector3::Dot(normal, mPositions[tri[0]]);
+				for (int k = 0; k < 3; ++k)
+				{
+					mQuadrics[tri[k]].AddPlane(normal.x, normal.y, normal.z, d);
+					mVertexTris[tri[k]].emplace_back(static_cast<unsigned int>(t));
+				}
+			}
+
+			LockSeamsAndBorders();
+
+			for (size_t v = 0; v < mNumVerts; ++v)
+			{
+				PushCollapses(static_cast<unsigned int>(v));
+			}
+		}
+
+		std::vector<unsigned int> Run(size_t targetIndexCount, float maxError, float& outError)
+		{
+			double maxDistance = 0.0;
+			while (mAliveTris * 3 > targetIndexCount && !mQueue.empty())
+			{
+				Collapse c = mQueue.top();
+				mQueue.pop();
+				if (c.mFromVersion != mVersion[c.mFrom] || c.mToVersion != mVersion[c.mTo] ||
+					mRemap[c.mFrom] != c.mFrom || mRemap[c.mTo] != c.mTo)
+				{
+					continue;
+				}
+				if (c.mDistance > maxError)
+				{
+					break;
+				}
+				if (!IsValidCollapse(c.mFrom, c.mTo))
+				{
+					continue;
+				}
+				maxDistance = std::max(maxDistance, c.mDistance);
+				ApplyCollapse(c.mFrom, c.mTo);
+			}
+			outError = static_cast<float>(maxDistance);
+
+			std::vector<unsigned int> result;
+			result.reserve(mAliveTris * 3);
+			for (size_t t = 0; t < mTriAlive.size(); ++t)
+			{
+				if (mTriAlive[t])
+				{
+					result.insert(result.end(), mIndices.begin() + t * 3, mIndices.begin() + t * 3 + 3);
+				}
+			}
+			return result;
+		}
+
+	private:
+		void LockSeamsAndBorders()
+		{
+			//vertices split for uv or normal seams share a position with another vertex;
+			//collapsing them independently would tear the surface open
+			std::map<std::tuple<float, float, float>, unsigned int> firstAtPosition;
+			for (size_t v = 0; v < mNumVerts; ++v)
+			{
+				auto key = std::make_tuple(mPositions[v].x, mPositions[v].y, mPositions[v].z);
+				auto result = firstAtPosition.emplace(key, static_cast<unsigned int>(v));
+				if (!result.second)
+				{
+					mLocked[v] = true;
+					mLocked[result.first->second] = true;
+				}
+			}
+
+			std::map<std::pair<unsigned int, unsigned int>, int> edgeCounts;
+			for (size_t t = 0; t < mIndices.size() / 3; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					unsigned int a = mIndices[t * 3 + k];
+					unsigned int b = mIndices[t * 3 + (k + 1) % 3];
+					++edgeCounts[std::minmax(a, b)];
+				}
+			}
+			for (const auto& edge : edgeCounts)
+			{
+				if (edge.second != 2)
+				{
+					mLocked[edge.first.first] = true;
+					mLocked[edge.first.second] = true;
+				}
+			}
+		}
+
+		std::vector<unsigned int> GetNeighbors(unsigned int v) const
+		{
+			std::vector<unsigned int> neighbors;
+			for (unsigned int t : mVertexTris[v])
+			{
+				if (!mTriAlive[t])
+				{
+					continue;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					unsigned int n = mIndices[t * 3 + k];
+					if (n != v && std::find(neighbors.begin(), neighbors.end(), n) == neighbors.end())
+					{
+						neighbors.emplace_back(n);
+					}
+				}
+			}
+			return neighbors;
+		}
+
+		void PushCollapses(unsigned int v)
+		{
+			for (unsigned int n : GetNeighbors(v))
+			{
+				if (!mLocked[v])
+				{
+					PushCollapse(v, n);
+				}
+				if (!mLocked[n])
+				{
+					PushCollapse(n, v);
+				}
+			}
+		}
+
+		void PushCollapse(unsigned int from, unsigned int to)
+		{
+			Quadric q = mQuadrics[from];
+			q.Add(mQuadrics[to]);
+			mQueue.push({ q.Evaluate(mPositions[to]), q.GetDistance(mPositions[to]), from, to, mVersion[from], mVersion[to] });
+		}
+
+		bool IsValidCollapse(unsigned int from, unsigned int to) const
+		{
+			//link condition : an interior edge must have exactly two shared neighbours
+			std::vector<unsigned int> fromNeighbors = GetNeighbors(from);
+			std::vector<unsigned int> toNeighbors = GetNeighbors(to);
+			int shared = 0;
+			bool adjacent = false;
+			for (unsigned int n : fromNeighbors)
+			{
+				if (n == to)
+				{
+					adjacent = true;
+				}
+				else if (std::find(toNeighbors.begin(), toNeighbors.end(), n) != toNeighbors.end())
+				{
+					++shared;
+				}
+			}
+			if (!adjacent || shared != 2)
+			{
+				return false;
+			}
+
+			//reject collapses that flip or degenerate the remaining triangles
+			for (unsigned int t : mVertexTris[from])
+			{
+				if (!mTriAlive[t])
+				{
+					continue;
+				}
+				const unsigned int* tri = &mIndices[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					continue;
+				}
+				Vector3 p[3];
+				Vector3 q[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					p[k] = mPositions[tri[k]];
+					q[k] = mPositions[tri[k] == from ? to : tri[k]];
+				}
+				Vector3 before = Vector3::Cross(p[1] - p[0], p[2] - p[0]);
+				Vector3 after = Vector3::Cross(q[1] - q[0], q[2] - q[0]);
+				if (Vector3::Dot(before, after) <= 0.0f || after.LengthSq() <= before.LengthSq() * 1e-4f)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void ApplyCollapse(unsigned int from, unsigned int to)
+		{
+			mRemap[from] = to;
+			mQuadrics[to].Add(mQuadrics[from]);
+			++mVersion[from];
+			++mVersion[to];
+
+			for (unsigned int t : mVertexTris[from])
+			{
+				if (!mTriAlive[t])
+				{
+					continue;
+				}
+				unsigned int* tri = &mIndices[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					mTriAlive[t] = false;
+					--mAliveTris;
+					continue;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					if (tri[k] == from)
+					{
+						tri[k] = to;
+					}
+				}
+				mVertexTris[to].emplace_back(t);
+			}
+			mVertexTris[from].clear();
+
+			for (unsigned int n : GetNeighbors(to))
+			{
+				++mVersion[n];
+			}
+			PushCollapses(to);
+			for (unsigned int n : GetNeighbors(to))
+			{
+				PushCollapses(n);
+			}
+		}
+
+		std::vector<unsigned int> mIndices;
+		size_t mNumVerts;
+		std::vector<Vector3> mPositions;
+		std::vector<Quadric> mQuadrics;
+		std::vector<std::vector<unsigned int>> mVertexTris;
+		std::vector<unsigned int> mRemap;
+		std::vector<bool> mLocked;
+		std::vector<uint32_t> mVersion;
+		std::vector<bool> mTriAlive;
+		size_t mAliveTris;
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mQueue;
+	};
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(const std::vector<float>& verts, size_t vertexSize,
+	const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float& outError)
+{
+	Simplifier simplifier(verts, vertexSize, indices);
+	return simplifier.Run(targetIndexCount, maxError, outError);
+}
+
+std::vector<MeshLodLevel> MeshSimplifier::GenerateLods(const std::vector<float>& verts, size_t vertexSize,
+	const std::vector<unsigned int>& indices)
+{
+	std::vector<MeshLodLevel> lods(1);
+	lods[0].mIndices = indices;
+
+	size_t numVerts = verts.size() / vertexSize;
+	float radiusSq = 0.0f;
+	for (size_t v = 0; v < numVerts; ++v)
+	{
+		const float* p = verts.data() + v * vertexSize;
+		radiusSq = Math::Max(radiusSq, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+	}
+	float maxError = Math::Sqrt(radiusSq) * MaxLodErrorRatio;
+
+	while (lods.size() < MaxLods)
+	{
+		const std::vector<unsigned int>& previous = lods.back().mIndices;
+		size_t target = (previous.size() / 3 / 2) * 3;
+		if (target / 3 < MinLodTriangles)
+		{
+			break;
+		}
+
+		//what is left of the error budget after the levels before
+		float previousError = lods.back().mError;
+		if (previousError >= maxError)
+		{
+			break;
+		}
+
+		MeshLodLevel level;
+		level.mIndices = Simplify(verts, vertexSize, previous, target, maxError - previousError, level.mError);
+		//stop once locked seams keep the simplifier from making real progress
+		if (level.mIndices.size() > previous.size() * 4 / 5)
+		{
+			break;
+		}
+		level.mError += previousError;
+		MeshOptimizer::OptimizeVertexCache(level.mIndices, numVerts);
+		lods.emplace_back(std::move(level));
+	}
+	return lods;
+}
+
+void MeshSimplifier::OptimizeVertexFetch(std::vector<float>& verts, size_t vertexSize, std::vector<MeshLodLevel>& lods)
+{
+	if (lods.size() < 2)
+	{
+		return;
+	}
+	//every level only uses vertices of the one before, so walking the coarsest first
+	//numbers each level's vertices ahead of those only finer levels add
+	std::vector<unsigned int> all;
+	for (auto iter = lods.rbegin(); iter != lods.rend(); ++iter)
+	{
+		all.insert(all.end(), iter->mIndices.begin(), iter->mIndices.end());
+	}
+	MeshOptimizer::OptimizeVertexFetch(verts, all, vertexSize);
+
+	size_t offset = 0;
+	for (auto iter = lods.rbegin(); iter != lods.rend(); ++iter)
+	{
+		std::copy(all.begin() + offset, all.begin() + offset + iter->mIndices.size(), iter->mIndices.begin());
+		offset += iter->mIndices.size();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+
+struct MeshLodLevel
+{
+	std::vector<unsigned int> mIndices;
+	//bound on the distance from the source mesh, in mesh units: each level is simplified
+	//from the one before it, so its largest collapse distance adds to that level's error
+	float mError = 0.0f;
+};
+
+namespace MeshSimplifier
+{
+	const size_t MaxLods = 4;
+	const size_t MinLodTriangles = 16;
+	//the levels together never move the surface further than this fraction of the radius
+	const float MaxLodErrorRatio = 0.1f;
+
+	//quadric error metric edge collapse. Vertices are never moved or created, so
+	//every level indexes the original vertex buffer
+	std::vector<unsigned int> Simplify(const std::vector<float>& verts, size_t vertexSize,
+		const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float& outError);
+
+	//level 0 is the source index list; each further level halves the triangle count
+	//until simplification stops paying off
+	std::vector<MeshLodLevel> GenerateLods(const std::vector<float>& verts, size_t vertexSize,
+		const std::vector<unsigned int>& indices);
+	//renumbers the shared vertices for every level at once, coarsest level first, so each
+	//level reads one run from the start of the buffer instead of a sparse subset of it
+	void OptimizeVertexFetch(std::vector<float>& verts, size_t vertexSize, std::vector<MeshLodLevel>& lods);
+}
\ No newline at end of file
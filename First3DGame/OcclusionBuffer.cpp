@@ -0,0 +1,276 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+	:mWidth((width + 3) & ~3)
+	, mHeight(height)
+	, mNearPlane(0.0f)
+	, mNumTriangles(0)
+{
+	int levelWidth = mWidth;
+	int levelHeight = mHeight;
+	while (true)
+	{
+		Level& level = mLevels.emplace_back();
+		level.mWidth = levelWidth;
+		level.mHeight = levelHeight;
+		level.mMin.resize(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+		level.mMax.resize(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+		if (levelWidth == 1 && levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionBuffer::Begin(const Matrix4& view, const Matrix4& projection)
+{
+	mView = view;
+	mProjection = projection;
+	mViewProj = view * projection;
+	//z/w is 0 on the near plane
+	mNearPlane = -projection.mat[3][2] / projection.mat[2][2];
+	mNumTriangles = 0;
+	//rasterized into the max of level 0, End copies it to the min
+	std::fill(mLevels[0].mMax.begin(), mLevels[0].mMax.end(), 1.0f);
+}
+
+void OcclusionBuffer::AddOccluder(const std::vector<float>& vertices, size_t stride, const std::vector<unsigned int>& indices, const Matrix4& world)
+{
+	Matrix4 toClip = world * mViewProj;
+	const float (*m)[4] = toClip.mat;
+	size_t numVerts = vertices.size() / stride;
+	mClipVertices.resize(numVerts);
+	for (size_t i = 0; i < numVerts; ++i)
+	{
+		const float* pos = &vertices[i * stride];
+		ClipVertex& v = mClipVertices[i];
+		v.x = pos[0] * m[0][0] + pos[1] * m[1][0] + pos[2] * m[2][0] + m[3][0];
+		v.y = pos[0] * m[0][1] + pos[1] * m[1][1] + pos[2] * m[2][1] + m[3][1];
+		v.z = pos[0] * m[0][2] + pos[1] * m[1][2] + pos[2] * m[2][2] + m[3][2];
+		v.w = pos[0] * m[0][3] + pos[1] * m[1][3] + pos[2] * m[2][3] + m[3][3];
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		ClipTriangle(mClipVertices[indices[i]], mClipVertices[indices[i + 1]], mClipVertices[indices[i + 2]]);
+	}
+}
+
+void OcclusionBuffer::ClipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	//only the near plane needs clipping; the raster loop clamps to the buffer
+	const ClipVertex* in[3] = { &a, &b, &c };
+	ClipVertex out[4];
+	int numOut = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		const ClipVertex& p = *in[i];
+		const ClipVertex& q = *in[(i + 1) % 3];
+		if (p.z >= 0.0f)
+		{
+			out[numOut++] = p;
+		}
+		if ((p.z >= 0.0f) != (q.z >= 0.0f))
+		{
+			float t = p.z / (p.z - q.z);
+			out[numOut++] = { p.x + (q.x - p.x) * t, p.y + (q.y - p.y) * t, 0.0f, p.w + (q.w - p.w) * t };
+		}
+	}
+	for (int i = 1; i + 1 < numOut; ++i)
+	{
+		DrawTriangle(out[0], out[i], out[i + 1]);
+	}
+}
+
+void OcclusionBuffer::DrawTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+{
+	//to pixels, y up like NDC
+	auto toScreen = [this](const ClipVertex& v)
+		{
+			float invW = 1.0f / v.w;
+			return Vector3((v.x * invW * 0.5f + 0.5f) * mWidth, (v.y * invW * 0.5f + 0.5f) * mHeight, v.z * invW);
+		};
+	Vector3 v0 = toScreen(a);
+	Vector3 v1 = toScreen(b);
+	Vector3 v2 = toScreen(c);
+	//occluders are double sided, so either winding is turned counter-clockwise
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+	if (area < 1e-4f)
+	{
+		return;
+	}
+
+	int minX = std::max(0, static_cast<int>(std::floor(Math::Min(v0.x, Math::Min(v1.x, v2.x)))));
+	int maxX = std::min(mWidth - 1, static_cast<int>(std::floor(Math::Max(v0.x, Math::Max(v1.x, v2.x)))));
+	int minY = std::max(0, static_cast<int>(std::floor(Math::Min(v0.y, Math::Min(v1.y, v2.y)))));
+	int maxY = std::min(mHeight - 1, static_cast<int>(std::floor(Math::Max(v0.y, Math::Max(v1.y, v2.y)))));
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+	minX &= ~3;
+	++mNumTriangles;
+
+	//edge functions a * x + b * y + c, positive inside
+	auto edge = [](const Vector3& from, const Vector3& to, float& outA, float& outB, float& outC)
+		{
+			outA = from.y - to.y;
+			outB = to.x - from.x;
+			outC = -(outA * from.x + outB * from.y);
+		};
+	float ea[3], eb[3], ec[3];
+	edge(v0, v1, ea[0], eb[0], ec[0]);
+	edge(v1, v2, ea[1], eb[1], ec[1]);
+	edge(v2, v0, ea[2], eb[2], ec[2]);
+	//z/w is affine in screen space
+	float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+	float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 a0 = _mm_set1_ps(ea[0]);
+	__m128 a1 = _mm_set1_ps(ea[1]);
+	__m128 a2 = _mm_set1_ps(ea[2]);
+	__m128 zStep = _mm_set1_ps(dzdx);
+	float* depth = mLevels[0].mMax.data();
+	for (int y = minY; y <= maxY; ++y)
+	{
+		float py = y + 0.5f;
+		__m128 row0 = _mm_set1_ps(eb[0] * py + ec[0]);
+		__m128 row1 = _mm_set1_ps(eb[1] * py + ec[1]);
+		__m128 row2 = _mm_set1_ps(eb[2] * py + ec[2]);
+		__m128 rowZ = _mm_set1_ps(v0.z - dzdx * v0.x + dzdy * (py - v0.y));
+		float* rowDepth = depth + static_cast<size_t>(y) * mWidth;
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixelOffsets);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+			__m128 inside = _mm_cmpge_ps(_mm_min_ps(e0, _mm_min_ps(e1, e2)), zero);
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+			__m128 z = _mm_add_ps(_mm_mul_ps(zStep, px), rowZ);
+			__m128 old = _mm_loadu_ps(rowDepth + x);
+			__m128 nearest = _mm_min_ps(old, z);
+			_mm_storeu_ps(rowDepth + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+		}
+	}
+}
+
+void OcclusionBuffer::End()
+{
+	mLevels[0].mMin = mLevels[0].mMax;
+	for (size_t i = 1; i < mLevels.size(); ++i)
+	{
+		const Level& src = mLevels[i - 1];
+		Level& dst = mLevels[i];
+		for (int y = 0; y < dst.mHeight; ++y)
+		{
+			int y0 = y * 2;
+			int y1 = std::min(y0 + 1, src.mHeight - 1);
+			for (int x = 0; x < dst.mWidth; ++x)
+			{
+				int x0 = x * 2;
+				int x1 = std::min(x0 + 1, src.mWidth - 1);
+				size_t texels[4] = {
+					static_cast<size_t>(y0) * src.mWidth + x0, static_cast<size_t>(y0) * src.mWidth + x1,
+					static_cast<size_t>(y1) * src.mWidth + x0, static_cast<size_t>(y1) * src.mWidth + x1 };
+				float minDepth = src.mMin[texels[0]];
+				float maxDepth = src.mMax[texels[0]];
+				for (int t = 1; t < 4; ++t)
+				{
+					minDepth = Math::Min(minDepth, src.mMin[texels[t]]);
+					maxDepth = Math::Max(maxDepth, src.mMax[texels[t]]);
+				}
+				size_t texel = static_cast<size_t>(y) * dst.mWidth + x;
+				dst.mMin[texel] = minDepth;
+				dst.mMax[texel] = maxDepth;
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::IsVisible(const Vector3& center, float radius) const
+{
+	Vector3 viewCenter = Vector3::Transform(center, mView);
+	float nearest = viewCenter.z - radius;
+	float farthest = viewCenter.z + radius;
+	if (nearest <= mNearPlane)
+	{
+		return true;
+	}
+
+	//x/z over the sphere is extreme at x = c +- r with z = c -+ r, depending on the sign
+	auto lower = [nearest, farthest](float c, float r) { return (c - r) / (c - r < 0.0f ? nearest : farthest); };
+	auto upper = [nearest, farthest](float c, float r) { return (c + r) / (c + r > 0.0f ? nearest : farthest); };
+	float xScale = mProjection.mat[0][0] * 0.5f * mWidth;
+	float yScale = mProjection.mat[1][1] * 0.5f * mHeight;
+	int x0 = static_cast<int>(std::floor(lower(viewCenter.x, radius) * xScale + 0.5f * mWidth));
+	int x1 = static_cast<int>(std::floor(upper(viewCenter.x, radius) * xScale + 0.5f * mWidth));
+	int y0 = static_cast<int>(std::floor(lower(viewCenter.y, radius) * yScale + 0.5f * mHeight));
+	int y1 = static_cast<int>(std::floor(upper(viewCenter.y, radius) * yScale + 0.5f * mHeight));
+	if (x1 < 0 || x0 >= mWidth || y1 < 0 || y0 >= mHeight)
+	{
+		//off screen, the frustum test decides
+		return true;
+	}
+	//texels count as covered when their center is, so an occluder edge can overhang by
+	//up to half a texel. One texel of margin sees past it
+	x0 = std::max(0, x0 - 1);
+	y0 = std::max(0, y0 - 1);
+	x1 = std::min(mWidth - 1, x1 + 1);
+	y1 = std::min(mHeight - 1, y1 + 1);
+	float depth = mProjection.mat[2][2] + mProjection.mat[3][2] / nearest;
+
+	//the level where the rectangle spans at most 2x2 texels decides most spheres,
+	//the ones in between look again at up to two finer levels
+	size_t level = 0;
+	while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+	{
+		++level;
+	}
+	for (size_t i = 0; i <= 2 && i <= level; ++i)
+	{
+		size_t l = level - i;
+		TestResult result = TestLevel(l, x0 >> l, y0 >> l, x1 >> l, y1 >> l, depth);
+		if (result != Unknown)
+		{
+			return result == Visible;
+		}
+	}
+	return true;
+}
+
+OcclusionBuffer::TestResult OcclusionBuffer::TestLevel(size_t level, int x0, int y0, int x1, int y1, float depth) const
+{
+	const Level& texels = mLevels[level];
+	bool unknown = false;
+	for (int y = y0; y <= y1; ++y)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			size_t texel = static_cast<size_t>(y) * texels.mWidth + x;
+			if (depth < texels.mMin[texel])
+			{
+				return Visible;
+			}
+			if (depth < texels.mMax[texel])
+			{
+				unknown = true;
+			}
+		}
+	}
+	return unknown ? Unknown : Occluded;
+}
\ No newline at end of file
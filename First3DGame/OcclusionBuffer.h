@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "Math.h"
+
+//a small depth buffer the CPU rasterizes occluders into each frame, so meshes they hide
+//can be dropped before submission. Depth is z/w as the projection produces it, nearest
+//kept. A min/max pyramid over it lets a bounding sphere be tested with a few texel reads
+class OcclusionBuffer
+{
+public:
+	//width is rounded up to a multiple of 4, the SIMD step
+	OcclusionBuffer(int width, int height);
+
+	//clears the buffer for a new camera; the projection must come from CreatePerspectiveFOV
+	void Begin(const Matrix4& view, const Matrix4& projection);
+	//rasterizes object space triangles; vertices are stride floats apart, position first
+	void AddOccluder(const std::vector<float>& vertices, size_t stride, const std::vector<unsigned int>& indices, const Matrix4& world);
+	//builds the pyramid, IsVisible is only valid after this
+	void End();
+
+	//false only when the sphere is certainly behind the occluders
+	bool IsVisible(const Vector3& center, float radius) const;
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	size_t GetNumTriangles() const { return mNumTriangles; }
+
+	static const int DefaultWidth = 256;
+private:
+	struct ClipVertex
+	{
+		float x, y, z, w;
+	};
+	struct Level
+	{
+		int mWidth;
+		int mHeight;
+		std::vector<float> mMin;
+		std::vector<float> mMax;
+	};
+	enum TestResult
+	{
+		Visible,
+		Occluded,
+		Unknown
+	};
+
+	void ClipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	void DrawTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	//the texel rectangle [x0, x1] x [y0, y1] of a level against a sphere at depth
+	TestResult TestLevel(size_t level, int x0, int y0, int x1, int y1, float depth) const;
+
+	int mWidth;
+	int mHeight;
+	//level 0 is the depth buffer itself
+	std::vector<Level> mLevels;
+	std::vector<ClipVertex> mClipVertices;
+	Matrix4 mView;
+	Matrix4 mViewProj;
+	Matrix4 mProjection;
+	float mNearPlane;
+	size_t mNumTriangles;
+};
\ No newline at end of file
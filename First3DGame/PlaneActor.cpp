@@ -8,6 +8,8 @@ PlaneActor::PlaneActor(class Game* game)
 	:Actor(game)
 {
 	SetScale(10.0f);
+	SetStatic(true);
 	MeshComponent* mc = AddComponent_Pointer<MeshComponent>(this);
 	mc->SetMesh(mGame->GetResourceInstance()->GetMesh("Assets/Plane.gpmesh"));
+	mc->SetOccluder(true);
 }
\ No newline at end of file
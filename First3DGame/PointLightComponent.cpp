@@ -0,0 +1,35 @@
+#include "PointLightComponent.h"
+#include "Actor.h"
+#include "Game.h"
+#include "Renderer.h"
+#include "RenderFrame.h"
+
+PointLightComponent::PointLightComponent(Actor* owner)
+	:Component(owner)
+	, mColor(Vector3(1.0f, 1.0f, 1.0f))
+	, mRadius(100.0f)
+	, mSpotCosInner(-2.0f)
+	, mSpotCosOuter(-2.0f)
+{
+	Game::GetRendererInstance()->AddPointLight(this);
+}
+
+PointLightComponent::~PointLightComponent()
+{
+	if (Renderer* renderer = Game::GetRendererInstance())
+	{
+		renderer->RemovePointLight(this);
+	}
+}
+
+void PointLightComponent::Submit(RenderFrame& frame)
+{
+	frame.mPointLights.push_back({ mOwner->GetWorldTransform().GetTranslation(), mRadius, mColor,
+		mOwner->GetForward(), mSpotCosInner, mSpotCosOuter });
+}
+
+void PointLightComponent::SetSpotCone(float innerAngle, float outerAngle)
+{
+	mSpotCosInner = Math::Cos(innerAngle);
+	mSpotCosOuter = Math::Cos(outerAngle);
+}
\ No newline at end of file
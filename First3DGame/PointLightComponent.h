@@ -0,0 +1,27 @@
+#pragma once
+#include "Component.h"
+#include "Math.h"
+
+//a point light at the owner's position, or a spot light along its forward once a cone
+//is set. Any number of them go through the renderer's clustered lighting
+class PointLightComponent : public Component
+{
+public:
+	PointLightComponent(class Actor* owner);
+	~PointLightComponent();
+
+	void Submit(struct RenderFrame& frame);
+	void SetColor(const Vector3& color) { mColor = color; }
+	//no light past this distance
+	void SetRadius(float radius) { mRadius = radius; }
+	//full brightness inside the inner angle, fading to nothing at the outer (half angles, radians)
+	void SetSpotCone(float innerAngle, float outerAngle);
+	const Vector3& GetColor() const { return mColor; }
+	float GetRadius() const { return mRadius; }
+private:
+	Vector3 mColor;
+	float mRadius;
+	//cosines; an outer of -1 or less is a point light
+	float mSpotCosInner;
+	float mSpotCosOuter;
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "RenderFrame.h"
+#include "StaticBatch.h"
+#include "Mesh.h"
+#include <cstring>
+#include <functional>
+
+uint64_t MeshPacket::MakeSortKey(const Mesh* mesh, const Texture* texture, float viewDepth, bool depthFirst)
+{
+	//bit 63 layout, then 39 bits of mesh/texture hash and 24 bits of depth in either order
+	uint64_t layout = mesh->GetLayout() == VertexLayout::PosNormTexCompact ? 1 : 0;
+	size_t hash = std::hash<const void*>()(mesh) * 31 + std::hash<const void*>()(texture);
+	//positive floats sort like their bits, so the top 24 keep the order at a coarser step
+	float depth = Math::Max(viewDepth, 0.0f);
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t material = static_cast<uint64_t>(hash) & 0x7FFFFFFFFFull;
+	uint64_t depthKey = depthBits >> 8;
+	if (depthFirst)
+	{
+		return (layout << 63) | (depthKey << 39) | material;
+	}
+	return (layout << 63) | (material << 24) | depthKey;
+}
+
+RenderFrame::RenderFrame()
+	:mFrameNumber(0)
+	, mOcclusion(nullptr)
+	, mLodScale(0.0f)
+	, mFrontToBack(false)
+	, mDepthPrepass(false)
+	, mGpuOverlay(false)
+	, mCaptureFormat(CaptureFormat::Png)
+	, mLightBinMs(0.0f)
+	, mMeshesCulled(0)
+	, mMeshBuildMs(0.0f)
+{
+
+}
+
+RenderFrame::~RenderFrame()
+{
+
+}
+
+void RenderFrame::Clear()
+{
+	mOcclusion = nullptr;
+	mMeshes.clear();
+	mMeshesCulled = 0;
+	mMeshBuildMs = 0.0f;
+	mPointLights.clear();
+	mLightGrid.clear();
+	mLightIndices.clear();
+	mLightBinMs = 0.0f;
+	mSprites.clear();
+	mTexts.clear();
+	mNewStaticBatches.clear();
+	mBatchRemovals.clear();
+}
+
+float RenderFrame::GetProjectedRadius(const Vector3& center, float radius) const
+{
+	float dist = (center - mCameraPos).Length();
+	if (dist <= radius)
+	{
+		return Math::Infinity;
+	}
+	return radius / dist * mLodScale;
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "Math.h"
+#include "Frustum.h"
+#include "GeometryBuffer.h"
+#include "SpriteBatch.h"
+#include "FrameCapture.h"
+#include "DynamicResolution.h"
+
+struct DirectionalLight
+{
+	Vector3 mDirection;
+	Vector3 mDiffuseColor;
+	Vector3 mSpecColor;
+};
+
+//a point light, or a spot light along mDirection when mSpotCosOuter > -1
+struct PointLight
+{
+	Vector3 mPosition;
+	float mRadius;
+	Vector3 mColor;
+	Vector3 mDirection;
+	float mSpotCosInner;
+	float mSpotCosOuter;
+};
+
+//packets only point at resources (meshes, textures, fonts), which outlive any frame;
+//everything owned by actors is copied, so the game can change or destroy them while
+//the render thread still draws the frame
+struct MeshPacket
+{
+	class Mesh* mMesh;
+	//nullptr when the mesh has no texture at the component's index
+	class Texture* mTexture;
+	Matrix4 mWorldTransform;
+	//the LOD picked on the game thread
+	GeometryRange mRange;
+	//projected diameter in pixels, reported to texture streaming when drawn
+	float mScreenSize;
+	//packets are drawn in increasing key order
+	uint64_t mSortKey;
+	//of the bounding sphere's center
+	float mViewDepth;
+
+	//vertex layout first, then mesh and texture so state changes group, then front to back.
+	//depthFirst puts depth before mesh and texture, for strict front to back order
+	static uint64_t MakeSortKey(const class Mesh* mesh, const class Texture* texture, float viewDepth, bool depthFirst);
+};
+
+struct SpritePacket
+{
+	class Texture* mTexture;
+	Matrix4 mWorldTransform;
+	SpriteBlend mBlend;
+	uint32_t mColor;
+};
+
+struct TextPacket
+{
+	class Font* mFont;
+	std::string mText;
+	Matrix4 mWorldTransform;
+	int mPointSize;
+	uint32_t mColor;
+};
+
+//a static actor's mesh that moved or was destroyed after its batch was merged
+struct BatchRemoval
+{
+	class StaticBatch* mBatch;
+	//from StaticBatch::AddMesh
+	size_t mIndex;
+};
+
+//everything the render thread needs to draw one frame. The game thread fills one
+//while the render thread draws the other
+struct RenderFrame
+{
+	RenderFrame();
+	~RenderFrame();
+
+	//keeps the vectors' storage for the next fill
+	void Clear();
+	//radius in pixels of a world space sphere seen from this frame's camera
+	float GetProjectedRadius(const Vector3& center, float radius) const;
+
+	//Renderer::GetFrameNumber when it was submitted
+	unsigned int mFrameNumber;
+	Matrix4 mView;
+	Matrix4 mProjection;
+	Frustum mFrustum;
+	//the occluders of this frame while it is built on the game thread, nullptr when off
+	const class OcclusionBuffer* mOcclusion;
+	Vector3 mCameraPos;
+	//pixels per world unit at distance 1
+	float mLodScale;
+	//opaque meshes strictly front to back instead of grouped by program and material
+	bool mFrontToBack;
+	//depth only pass over the opaque meshes, then shading with GL_EQUAL
+	bool mDepthPrepass;
+	//GpuProfiler bars over the frame
+	bool mGpuOverlay;
+	//read back into mCaptureDirectory once drawn, empty when not capturing
+	std::string mCaptureDirectory;
+	CaptureFormat mCaptureFormat;
+	DynamicResolutionSettings mResolutionSettings;
+	Vector3 mAmbientLight;
+	DirectionalLight mDirLight;
+	std::vector<PointLight> mPointLights;
+	//binned by LightClusters: an offset into mLightIndices and a count per cluster
+	std::vector<uint32_t> mLightGrid;
+	std::vector<uint32_t> mLightIndices;
+	float mLightBinMs;
+
+	//in draw order
+	std::vector<MeshPacket> mMeshes;
+	//outside the frustum or hidden by occluders
+	unsigned int mMeshesCulled;
+	//time the game thread spent culling and sorting mMeshes
+	float mMeshBuildMs;
+	std::vector<SpritePacket> mSprites;
+	std::vector<TextPacket> mTexts;
+	//merged on the game thread; the render thread uploads them and draws them from then on
+	std::vector<std::unique_ptr<class StaticBatch>> mNewStaticBatches;
+	//applied once mNewStaticBatches are built, since a mesh may leave a batch merged at the same sync
+	std::vector<BatchRemoval> mBatchRemovals;
+};
\ No newline at end of file
@@ -3,21 +3,67 @@
 #include "SpriteComponent.h"
 #include <algorithm>
 #include "Shader.h"
-#include "VertexArray.h"
+#include "SpriteBatch.h"
+#include "TextComponent.h"
 #include "Game.h"
 #include "MeshComponent.h"
+#include "Mesh.h"
+#include "Actor.h"
+#include "StaticBatch.h"
+#include "GeometryBuffer.h"
+#include "ResourceManager.h"
+#include "ShaderLibrary.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+#include "Font.h"
+#include "ThreadPool.h"
+#include "OcclusionBuffer.h"
+#include "LightClusters.h"
+#include "PointLightComponent.h"
+#include "GpuDebug.h"
 #include <SDL_ttf.h>
+#include <filesystem>
+#ifdef RENDERER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace
+{
+	uint32_t GetLayoutFeatures(VertexLayout layout)
+	{
+		return layout == VertexLayout::PosNormTexCompact ? ShaderFeature::Compact : 0;
+	}
+
+	//render thread; a normal texture still loading shows the default texture, which is no normal map
+	uint32_t GetMaterialFeatures(const Mesh* mesh)
+	{
+		Texture* normalTexture = mesh->GetNormalTexture();
+		return normalTexture && !Game::GetResourceInstance()->IsTexturePending(normalTexture) ? ShaderFeature::NormalMap : 0;
+	}
+
+	//a total order, so the merged result does not depend on how the chunks were split
+	template <typename Entry>
+	bool EntryLess(const Entry& a, const Entry& b)
+	{
+		if (a.mKey != b.mKey)
+		{
+			return a.mKey < b.mKey;
+		}
+		return a.mChunk != b.mChunk ? a.mChunk < b.mChunk : a.mIndex < b.mIndex;
+	}
+}
 
 
 Renderer::Renderer(Game* game)
 	:mGame(game)
 {
-	Initialize();
+
 }
 
 Renderer::~Renderer()
 {
-
+	StopRenderThread();
 }
 
 bool Renderer::Initialize()
@@ -33,13 +79,13 @@ bool Renderer::Initialize()
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-
-	mWindow = SDL_CreateWindow("Asteroids_OpenGL", 100, 100, 1024, 768, SDL_WINDOW_OPENGL);
-	if (!mWindow)
-	{
-		SDL_Log("SDL cannot create Window! SDL_Error : %s", SDL_GetError());
-		return false;
-	}
+#ifdef GPU_DEBUG
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
+#ifdef RENDERER_EGL
+	//GLEW is built with GLEW_EGL here, so windows need EGL contexts too (Wayland always has them)
+	SDL_SetHint(SDL_HINT_VIDEO_X11_FORCE_EGL, "1");
+#endif
 
 	if (TTF_Init() != 0)
 	{
@@ -47,10 +93,8 @@ bool Renderer::Initialize()
 		return false;
 	}
 
-	mContext = SDL_GL_CreateContext(mWindow);
-	if (!mContext)
+	if (!CreateContext())
 	{
-		SDL_Log("Failed to create context : %s", SDL_GetError());
 		return false;
 	}
 
@@ -61,70 +105,789 @@ bool Renderer::Initialize()
 		return false;
 	}
 
-	if (SDL_GL_SetSwapInterval(1) < 0)
+	if (mWindow && !mGame->IsHeadless() && SDL_GL_SetSwapInterval(1) < 0)
 	{
 		SDL_Log("Warning: Unable to set VSync! SDL Error: %s", SDL_GetError());
 	}
 
+	//glewInit's GL_INVALID_ENUM on core profiles comes before the debug callback is in place
 	glGetError();
+	GpuDebug::Initialize();
+
+	if (mGame->IsHeadless() && !CreateOffscreenTarget())
+	{
+		return false;
+	}
 
+	//cold runs compile every program, warm runs pull linked binaries from ShaderCache.
+	//Mesh programs only get submitted here and finish in the background
+	Uint64 shaderStart = SDL_GetPerformanceCounter();
 	if (!LoadShaders())
 	{
 		SDL_Log("Failed to load shader");
 		return false;
 	} 
+	double shaderMs = (SDL_GetPerformanceCounter() - shaderStart) * 1000.0 / SDL_GetPerformanceFrequency();
+	Shader* shaders[] = { mSpriteShader.get(), mTextShader.get() };
+	size_t numCached = mShaderLibrary->GetNumFromCache();
+	for (Shader* shader : shaders)
+	{
+		numCached += shader->WasLoadedFromCache() ? 1 : 0;
+	}
+	SDL_Log("Shaders : %zu programs in %.2f ms, %zu from cache, %zu still compiling%s",
+		std::size(shaders) + mShaderLibrary->GetNumPrograms(), shaderMs, numCached,
+		mShaderLibrary->GetNumPending(), ShaderLibrary::IsParallelCompileAvailable() ? " in parallel" : "");
 
-	CreateSpriteVerts();
+	mSpriteBatch = std::make_unique<SpriteBatch>();
+	mMeshGeometry[static_cast<size_t>(VertexLayout::PosNormTex)] =
+		std::make_unique<GeometryBuffer>(VertexLayout::PosNormTex, 16384, 65536 * 4);
+	mMeshGeometry[static_cast<size_t>(VertexLayout::PosNormTexCompact)] =
+		std::make_unique<GeometryBuffer>(VertexLayout::PosNormTexCompact, 65536, 65536 * 6);
+	mLightClusters = std::make_unique<LightClusters>();
+	mGpuProfiler = std::make_unique<GpuProfiler>();
+	mFrameCapture = std::make_unique<FrameCapture>(Game::GetThreadPoolInstance());
+	mDynamicResolution = std::make_unique<DynamicResolution>(static_cast<int>(mGame->GetScreenSize().x),
+		static_cast<int>(mGame->GetScreenSize().y));
+	for (auto& frame : mFrames)
+	{
+		frame = std::make_unique<RenderFrame>();
+	}
 
 	return true;
 }
 
 void Renderer::Shutdown()
 {
+	StopRenderThread();
+	mFrameCapture->Flush();
+	mFrameCapture.reset();
+	mDynamicResolution.reset();
 	mSpriteShader->Unload();
-	mMeshShader->Unload();
+	mTextShader->Unload();
+	mShaderLibrary->Unload();
 	UnloadData();
+	if (mFramebuffer)
+	{
+		glDeleteFramebuffers(1, &mFramebuffer);
+		glDeleteRenderbuffers(2, mRenderbuffers);
+	}
+#ifdef RENDERER_EGL
+	if (mEglDisplay)
+	{
+		eglMakeCurrent(mEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(mEglDisplay, mEglContext);
+		eglTerminate(mEglDisplay);
+		return;
+	}
+#endif
 	SDL_GL_DeleteContext(mContext);
 	SDL_DestroyWindow(mWindow);
 }
 
+bool Renderer::StartCapture(const std::string& directory, CaptureFormat format)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		SDL_Log("Failed to create capture directory %s : %s", directory.c_str(), error.message().c_str());
+		return false;
+	}
+	mCaptureDirectory = directory;
+	mCaptureFormat = format;
+	return true;
+}
+
+bool Renderer::CreateContext()
+{
+	int width = static_cast<int>(mGame->GetScreenSize().x);
+	int height = static_cast<int>(mGame->GetScreenSize().y);
+	bool headless = mGame->IsHeadless();
+#ifdef RENDERER_EGL
+	//no display server needed: Mesa's surfaceless platform, llvmpipe when there is no GPU
+	if (headless)
+	{
+		EGLDisplay display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API))
+		{
+			SDL_Log("Failed to open a surfaceless EGL display : 0x%x", eglGetError());
+			return false;
+		}
+		//frames go to an FBO; the config only has to exist, and the default asks for window surfaces
+		const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		const EGLint contextAttribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifdef GPU_DEBUG
+			EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+			EGL_NONE };
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		EGLContext context = EGL_NO_CONTEXT;
+		if (eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) && numConfigs > 0)
+		{
+			context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		}
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			SDL_Log("Failed to create a surfaceless EGL context : 0x%x", eglGetError());
+			eglTerminate(display);
+			return false;
+		}
+		mEglDisplay = display;
+		mEglContext = context;
+		return true;
+	}
+#endif
+
+	//other headless builds keep a hidden window for the context, so they still need a desktop
+	//session. A machine without a GPU gets one from Mesa's llvmpipe opengl32.dll next to the executable
+	if (headless && SDL_InitSubSystem(SDL_INIT_VIDEO) != 0)
+	{
+		SDL_Log("SDL video could not initialize! SDL_Error : %s", SDL_GetError());
+		return false;
+	}
+	mWindow = SDL_CreateWindow("Asteroids_OpenGL", 100, 100, width, height,
+		SDL_WINDOW_OPENGL | (headless ? SDL_WINDOW_HIDDEN : 0));
+	if (!mWindow)
+	{
+		SDL_Log("SDL cannot create Window! SDL_Error : %s", SDL_GetError());
+		return false;
+	}
+
+	mContext = SDL_GL_CreateContext(mWindow);
+	if (!mContext)
+	{
+		SDL_Log("Failed to create context : %s", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+bool Renderer::CreateOffscreenTarget()
+{
+	GLsizei width = static_cast<GLsizei>(mGame->GetScreenSize().x);
+	GLsizei height = static_cast<GLsizei>(mGame->GetScreenSize().y);
+	glGenRenderbuffers(2, mRenderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, mRenderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, mRenderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &mFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mRenderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mRenderbuffers[1]);
+	GpuDebug::SetLabel(GL_FRAMEBUFFER, mFramebuffer, "Offscreen");
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		SDL_Log("Offscreen framebuffer is incomplete");
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void Renderer::MakeContextCurrent(bool current)
+{
+#ifdef RENDERER_EGL
+	if (mEglDisplay)
+	{
+		eglMakeCurrent(mEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? mEglContext : EGL_NO_CONTEXT);
+		return;
+	}
+#endif
+	SDL_GL_MakeCurrent(mWindow, current ? mContext : nullptr);
+}
+
+void Renderer::PresentFrame()
+{
+	if (mFramebuffer)
+	{
+		//nothing is shown. Waiting keeps the CPU from queueing frames without bound,
+		//which a swap would otherwise do, and GpuProfiler's ring from running over
+		glFinish();
+	}
+	else
+	{
+		SDL_GL_SwapWindow(mWindow);
+	}
+}
+
 void Renderer::UnloadData()
 {
 	mSprites.clear();
+	mTexts.clear();
 	mMeshComps.clear();
+	mOccluders.clear();
+	mPointLights.clear();
+	mNewStaticBatches.clear();
+	mBatchRemovals.clear();
+	mStaticBatches.clear();
+	for (auto& frame : mFrames)
+	{
+		frame->Clear();
+	}
+}
+
+void Renderer::StartRenderThread()
+{
+	if (mRenderThread.joinable())
+	{
+		return;
+	}
+	mStopRenderThread = false;
+	//a context is current on one thread at a time. Swapping from a thread other than
+	//the one that made the window works with WGL and GLX, not with Cocoa
+	MakeContextCurrent(false);
+	mRenderThread = std::thread(&Renderer::RenderThreadLoop, this);
+}
+
+void Renderer::StopRenderThread()
+{
+	if (!mRenderThread.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mFrameMutex);
+		mStopRenderThread = true;
+	}
+	mFrameQueuedCondition.notify_one();
+	mRenderThread.join();
+	MakeContextCurrent(true);
 }
 
-void Renderer::Draw()
+bool Renderer::IsGLThread() const
 {
+	return !mRenderThread.joinable() || std::this_thread::get_id() == mRenderThread.get_id();
+}
+
+void Renderer::RunOnGLThread(const std::function<void()>& task)
+{
+	if (IsGLThread())
+	{
+		task();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mFrameMutex);
+		mGLTask = &task;
+	}
+	mFrameQueuedCondition.notify_one();
+	std::unique_lock<std::mutex> lock(mFrameMutex);
+	mFrameDoneCondition.wait(lock, [this] { return mGLTask == nullptr; });
+}
+
+void Renderer::RenderThreadLoop()
+{
+	MakeContextCurrent(true);
+	std::unique_lock<std::mutex> lock(mFrameMutex);
+	while (true)
+	{
+		mFrameQueuedCondition.wait(lock, [this] { return mFrameQueued || mGLTask || mStopRenderThread; });
+		if (mGLTask)
+		{
+			const std::function<void()>* task = mGLTask;
+			lock.unlock();
+			(*task)();
+			lock.lock();
+			mGLTask = nullptr;
+			mFrameDoneCondition.notify_one();
+			continue;
+		}
+		if (!mFrameQueued)
+		{
+			break;
+		}
+		RenderFrame& frame = *mFrames[1 - mFrontFrame];
+		lock.unlock();
+		DrawFrame(frame);
+		lock.lock();
+		mFrameQueued = false;
+		mFrameDoneCondition.notify_one();
+	}
+	lock.unlock();
+	//captured frames still in the pack buffers are written before the context moves
+	mFrameCapture->Flush();
+	MakeContextCurrent(false);
+}
+
+void Renderer::SubmitFrame()
+{
+	RenderFrame& frame = *mFrames[mFrontFrame];
+	BuildFrame(frame);
+	if (!mRenderThread.joinable())
+	{
+		DrawFrame(frame);
+		mStats = mBackStats;
+		BuildStaticBatches();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mFrameMutex);
+		mFrameDoneCondition.wait(lock, [this] { return !mFrameQueued; });
+		//the render thread sits idle until this block ends, so state it owns can be read here
+		mStats = mBackStats;
+		BuildStaticBatches();
+		mFrontFrame = 1 - mFrontFrame;
+		mFrameQueued = true;
+	}
+	mFrameQueuedCondition.notify_one();
+}
+
+void Renderer::BuildFrame(RenderFrame& frame)
+{
+	frame.Clear();
+	frame.mFrameNumber = mFrameNumber++;
+	frame.mView = mView;
+	frame.mProjection = mProjection;
+	frame.mFrustum.SetViewProj(mView * mProjection);
+	Matrix4 invView = mView;
+	invView.Invert();
+	frame.mCameraPos = invView.GetTranslation();
+	frame.mLodScale = mProjection.mat[1][1] * mGame->GetScreenSize().y * 0.5f;
+	frame.mFrontToBack = mFrontToBack;
+	frame.mDepthPrepass = mDepthPrepass;
+	frame.mGpuOverlay = mGpuOverlay;
+	frame.mCaptureDirectory = mCaptureDirectory;
+	frame.mCaptureFormat = mCaptureFormat;
+	frame.mResolutionSettings = mResolutionSettings;
+	frame.mAmbientLight = mAmbientLight;
+	frame.mDirLight = mDirLight;
+
+	if (BuildOcclusion(frame))
+	{
+		frame.mOcclusion = mOcclusionBuffer.get();
+	}
+	BuildMeshPackets(frame);
+	//the buffer is rewritten next frame, while the render thread still holds this one
+	frame.mOcclusion = nullptr;
+	for (auto sprite : mSprites)
+	{
+		sprite->Submit(frame);
+	}
+	for (auto text : mTexts)
+	{
+		text->Submit(frame);
+	}
+	for (auto light : mPointLights)
+	{
+		light->Submit(frame);
+	}
+	mLightClusters->Bin(frame, Game::GetThreadPoolInstance());
+	//batches merged at the last sync; their meshes left mMeshComps before this frame was built
+	frame.mNewStaticBatches = std::move(mNewStaticBatches);
+	mNewStaticBatches.clear();
+	frame.mBatchRemovals.swap(mBatchRemovals);
+}
+
+bool Renderer::BuildOcclusion(const RenderFrame& frame)
+{
+	if (!mOcclusionCulling || mOccluders.empty())
+	{
+		return false;
+	}
+	if (!mOcclusionBuffer)
+	{
+		Vector2 screen = mGame->GetScreenSize();
+		int width = OcclusionBuffer::DefaultWidth;
+		mOcclusionBuffer = std::make_unique<OcclusionBuffer>(width, static_cast<int>(width * screen.y / screen.x));
+	}
+
+	mOcclusionBuffer->Begin(mView, mProjection);
+	for (MeshComponent* mc : mOccluders)
+	{
+		Mesh* mesh = mc->GetMesh();
+		if (!mesh)
+		{
+			continue;
+		}
+		const Matrix4& world = mc->GetOwner()->GetWorldTransform();
+		Vector3 center;
+		float radius;
+		mc->GetBounds(world, center, radius);
+		if (frame.mFrustum.Intersects(center, radius))
+		{
+			mOcclusionBuffer->AddOccluder(mesh->GetVertices(), Mesh::VertexSize, mesh->GetIndices(), world);
+		}
+	}
+	mOcclusionBuffer->End();
+	return true;
+}
+
+void Renderer::BuildMeshPackets(RenderFrame& frame)
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	ThreadPool* pool = Game::GetThreadPoolInstance();
+	size_t numChunks = (mMeshComps.size() + MeshChunkSize - 1) / MeshChunkSize;
+	if (mMeshChunks.size() < numChunks)
+	{
+		mMeshChunks.resize(numChunks);
+	}
+
+	//each chunk culls, keys and sorts its own components into its own buffers
+	pool->ParallelFor(mMeshComps.size(), MeshChunkSize, [this, &frame](size_t begin, size_t end)
+		{
+			uint32_t chunkIndex = static_cast<uint32_t>(begin / MeshChunkSize);
+			MeshChunk& chunk = mMeshChunks[chunkIndex];
+			chunk.mPackets.clear();
+			chunk.mEntries.clear();
+			MeshPacket packet;
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (mMeshComps[i]->BuildPacket(frame, packet))
+				{
+					chunk.mEntries.push_back({ packet.mSortKey, chunkIndex, static_cast<uint32_t>(chunk.mPackets.size()) });
+					chunk.mPackets.push_back(packet);
+				}
+			}
+			std::sort(chunk.mEntries.begin(), chunk.mEntries.end(), EntryLess<MeshSortEntry>);
+		});
+
+	size_t numVisible = 0;
+	std::vector<size_t> runs;
+	for (size_t i = 0; i < numChunks; ++i)
+	{
+		mMeshChunks[i].mOffset = numVisible;
+		runs.emplace_back(numVisible);
+		numVisible += mMeshChunks[i].mEntries.size();
+	}
+	runs.emplace_back(numVisible);
+	frame.mMeshesCulled = static_cast<unsigned int>(mMeshComps.size() - numVisible);
+
+	mMeshSortEntries.resize(numVisible);
+	mMeshSortScratch.resize(numVisible);
+	pool->ParallelFor(numChunks, 1, [this](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const MeshChunk& chunk = mMeshChunks[i];
+				std::copy(chunk.mEntries.begin(), chunk.mEntries.end(), mMeshSortEntries.begin() + chunk.mOffset);
+			}
+		});
+	//sorted runs merge pairwise, every pair of a pass in parallel, until one run is left
+	while (runs.size() > 2)
+	{
+		size_t numRuns = runs.size() - 1;
+		pool->ParallelFor((numRuns + 1) / 2, 1, [this, &runs, numRuns](size_t begin, size_t end)
+			{
+				for (size_t pair = begin; pair < end; ++pair)
+				{
+					auto first = mMeshSortEntries.begin() + runs[pair * 2];
+					auto middle = mMeshSortEntries.begin() + runs[std::min(pair * 2 + 1, numRuns)];
+					auto last = mMeshSortEntries.begin() + runs[std::min(pair * 2 + 2, numRuns)];
+					std::merge(first, middle, middle, last, mMeshSortScratch.begin() + runs[pair * 2], EntryLess<MeshSortEntry>);
+				}
+			});
+		std::vector<size_t> merged;
+		for (size_t i = 0; i < numRuns; i += 2)
+		{
+			merged.emplace_back(runs[i]);
+		}
+		merged.emplace_back(numVisible);
+		runs.swap(merged);
+		mMeshSortEntries.swap(mMeshSortScratch);
+	}
+
+	frame.mMeshes.resize(numVisible);
+	pool->ParallelFor(numVisible, MeshChunkSize, [this, &frame](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const MeshSortEntry& entry = mMeshSortEntries[i];
+				frame.mMeshes[i] = mMeshChunks[entry.mChunk].mPackets[entry.mIndex];
+			}
+		});
+	frame.mMeshBuildMs = static_cast<float>((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void Renderer::DrawFrame(RenderFrame& frame)
+{
+	mGpuProfiler->BeginFrame(frame.mFrameNumber);
+	if (mFramebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+	}
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	mFrameStats = RenderStats();
+	mFrameStats.mMeshesCulled = frame.mMeshesCulled;
+	mFrameStats.mMeshBuildMs = frame.mMeshBuildMs;
+	mFrameStats.mPointLights = static_cast<unsigned int>(frame.mPointLights.size());
+	mFrameStats.mLightBinMs = frame.mLightBinMs;
+	mFrameStats.mFrame = static_cast<int>(frame.mFrameNumber);
+	mFrameStats.mGpuTimings = mGpuProfiler->GetTimings();
+	mFrameStats.mGpuFrame = mGpuProfiler->GetTimingsFrame();
+	mDynamicResolution->Update(frame.mResolutionSettings, frame.mFrameNumber, mFrameStats.mGpuTimings,
+		mFrameStats.mGpuFrame);
+	mFrameStats.mRenderScale = mDynamicResolution->GetScale();
+	//texture uploads and streaming
+	Game::GetResourceInstance()->Update();
+	mShaderLibrary->Update();
+	mFrameStats.mShadersPending = static_cast<unsigned int>(mShaderLibrary->GetNumPending());
+	for (auto& batch : frame.mNewStaticBatches)
+	{
+		batch->Build(this);
+		SDL_Log("Static batch : %zu meshes merged into one draw", batch->GetNumMeshes());
+		mStaticBatches.emplace_back(std::move(batch));
+	}
+	frame.mNewStaticBatches.clear();
+	for (const BatchRemoval& removal : frame.mBatchRemovals)
+	{
+		removal.mBatch->RemoveMesh(removal.mIndex);
+	}
+
+	//without point lights the mesh shaders skip the cluster lookup altogether
+	uint32_t lightFeatures = 0;
+	if (!frame.mPointLights.empty())
+	{
+		mLightClusters->Upload(frame);
+		lightFeatures = ShaderFeature::ClusteredLights;
+	}
+
+	//meshes whose program is still compiling sit the frame out
+	mMeshDraws.clear();
+	for (size_t i = 0; i < mMeshGeometry.size(); ++i)
+	{
+		VertexLayout layout = static_cast<VertexLayout>(i);
+		for (auto& batch : mStaticBatches)
+		{
+			if (batch->GetLayout() == layout)
+			{
+				if (Shader* shader = GetMeshShader(batch->GetShaderName(), layout, lightFeatures))
+				{
+					//batches wrap large areas like the arena's floor and walls, so they sort by
+					//their far side and whatever stands in front of them goes first
+					float depth = frame.mFrustum.GetViewDepth(batch->GetCenter()) + batch->GetRadius();
+					mMeshDraws.push_back({ shader, layout, depth, batch.get(), nullptr });
+				}
+			}
+		}
+		for (const MeshPacket& packet : frame.mMeshes)
+		{
+			if (packet.mMesh->GetLayout() == layout)
+			{
+				uint32_t materialFeatures = GetMaterialFeatures(packet.mMesh);
+				Shader* shader = GetMeshShader(packet.mMesh->GetShaderName(), layout, lightFeatures | materialFeatures);
+				//without its normal map until that permutation has compiled
+				if (!shader && materialFeatures != 0)
+				{
+					shader = GetMeshShader(packet.mMesh->GetShaderName(), layout, lightFeatures);
+				}
+				if (shader)
+				{
+					mMeshDraws.push_back({ shader, layout, packet.mViewDepth, nullptr, &packet });
+				}
+			}
+		}
+	}
+	//stable, so packets keep their sort key order among equals
+	if (frame.mFrontToBack)
+	{
+		std::stable_sort(mMeshDraws.begin(), mMeshDraws.end(), [](const MeshDraw& a, const MeshDraw& b)
+			{
+				return a.mLayout != b.mLayout ? a.mLayout < b.mLayout : a.mDepth < b.mDepth;
+			});
+	}
+	else
+	{
+		//grouped so each program is bound and given the frame uniforms once
+		std::stable_sort(mMeshDraws.begin(), mMeshDraws.end(), [](const MeshDraw& a, const MeshDraw& b)
+			{
+				return a.mLayout != b.mLayout ? a.mLayout < b.mLayout : a.mShader < b.mShader;
+			});
+	}
+
+	//every layout needs its depth program, or its meshes would fail GL_EQUAL
+	bool prepass = frame.mDepthPrepass;
+	for (size_t i = 0; i < mMeshGeometry.size() && prepass; ++i)
+	{
+		prepass = mShaderLibrary->Get("Depth", GetLayoutFeatures(static_cast<VertexLayout>(i))) != nullptr;
+	}
+
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_BLEND);
-	mMeshShader->SetActive();
-	mMeshShader->SetMatrixUniform("uViewProj", mView * mProjection);
-	SetLightUniforms(mMeshShader.get());
-
-	for (auto mc : mMeshComps)
+	mGpuProfiler->BeginScope("Meshes");
+	mDynamicResolution->BeginScene();
+	if (prepass)
+	{
+		mGpuProfiler->BeginScope("Depth prepass");
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		DrawMeshPass(frame, true);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		mGpuProfiler->EndScope();
+		//only the nearest fragment of each pixel is shaded
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	DrawMeshPass(frame, false);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	mGpuProfiler->EndScope();
+	if (mDynamicResolution->GetScale() < 1.0f)
 	{
-		mc->Draw(mMeshShader.get());
+		mGpuProfiler->BeginScope("Upscale");
+		mDynamicResolution->EndScene(mFramebuffer);
+		mGpuProfiler->EndScope();
 	}
 
 
 	glDisable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
-	glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 
-	mSpriteShader->SetActive();
-	mSpriteVerts->SetActive();
+	mGpuProfiler->BeginScope("Sprites");
+	mSpriteBatch->Begin();
+	for (const SpritePacket& sprite : frame.mSprites)
+	{
+		//size read here, a texture still streaming in changes size when it lands
+		mSpriteBatch->AddSprite(sprite.mTexture, sprite.mWorldTransform, static_cast<float>(sprite.mTexture->GetWidth()),
+			static_cast<float>(sprite.mTexture->GetHeight()), sprite.mBlend, sprite.mColor);
+	}
+	mSpriteBatch->End(mSpriteShader.get());
+	AddDrawStats(static_cast<unsigned>(mSpriteBatch->GetNumSprites() * 2),
+		static_cast<unsigned>(mSpriteBatch->GetNumDrawCalls()));
+	mGpuProfiler->EndScope();
 
-	for (auto sprite : mSprites)
+	//text goes on top in its own pass since the glyph pages hold distances, not colour
+	mGpuProfiler->BeginScope("Text");
+	mSpriteBatch->Begin();
+	for (const TextPacket& text : frame.mTexts)
+	{
+		text.mFont->AddText(mSpriteBatch.get(), text.mText, text.mPointSize, text.mWorldTransform, text.mColor);
+	}
+	mSpriteBatch->End(mTextShader.get());
+	AddDrawStats(static_cast<unsigned>(mSpriteBatch->GetNumSprites() * 2),
+		static_cast<unsigned>(mSpriteBatch->GetNumDrawCalls()));
+	mGpuProfiler->EndScope();
+
+	if (frame.mGpuOverlay)
+	{
+		mSpriteBatch->Begin();
+		mGpuProfiler->DrawOverlay(mSpriteBatch.get(), mGame->GetScreenSize());
+		mSpriteBatch->End(mSpriteShader.get());
+	}
+
+	//reads the back buffer (or mFramebuffer) before the swap
+	mFrameCapture->Update();
+	if (!frame.mCaptureDirectory.empty())
+	{
+		mGpuProfiler->BeginScope("Capture");
+		mFrameCapture->Capture(frame.mFrameNumber, static_cast<int>(mGame->GetScreenSize().x),
+			static_cast<int>(mGame->GetScreenSize().y), frame.mCaptureDirectory, frame.mCaptureFormat);
+		mGpuProfiler->EndScope();
+	}
+
+	mGpuProfiler->BeginScope("Swap");
+	PresentFrame();
+	mGpuProfiler->EndScope();
+	mGpuProfiler->EndFrame();
+	GpuDebug::CheckErrors("DrawFrame");
+	mBackStats = mFrameStats;
+}
+
+void Renderer::DrawMeshPass(const RenderFrame& frame, bool depthOnly)
+{
+	VertexLayout layout = VertexLayout::NumLayouts;
+	Shader* depthShader = nullptr;
+	Shader* shader = nullptr;
+	for (const MeshDraw& draw : mMeshDraws)
 	{
-		sprite->Draw(mSpriteShader.get());
+		if (draw.mLayout != layout)
+		{
+			layout = draw.mLayout;
+			GetMeshGeometry(layout)->SetActive();
+			depthShader = depthOnly ? mShaderLibrary->Get("Depth", GetLayoutFeatures(layout)) : nullptr;
+		}
+		Shader* drawShader = depthOnly ? depthShader : draw.mShader;
+		if (drawShader != shader)
+		{
+			shader = drawShader;
+			shader->SetActive();
+			shader->SetMatrixUniform("uViewProj", frame.mView * frame.mProjection);
+			if (!depthOnly)
+			{
+				SetLightUniforms(shader, frame);
+			}
+		}
+
+		if (draw.mBatch)
+		{
+			if (depthOnly)
+			{
+				draw.mBatch->DrawDepth(shader);
+			}
+			else
+			{
+				draw.mBatch->Draw(shader, frame);
+			}
+			AddDrawStats(draw.mBatch->GetNumTriangles());
+		}
+		else if (depthOnly)
+		{
+			DrawMeshDepth(*draw.mMesh, shader);
+		}
+		else
+		{
+			DrawMesh(*draw.mMesh, shader);
+		}
 	}
+}
 
-	SDL_GL_SwapWindow(mWindow);
+void Renderer::DrawMeshDepth(const MeshPacket& packet, Shader* shader)
+{
+	Mesh* mesh = packet.mMesh;
+	shader->SetMatrixUniform("uWorldTransform", packet.mWorldTransform);
+	if (mesh->GetLayout() == VertexLayout::PosNormTexCompact)
+	{
+		shader->SetVectorUniform("uPosOffset", mesh->GetQuantization().mOffset);
+		shader->SetVectorUniform("uPosScale", mesh->GetQuantization().mScale);
+	}
+	GetMeshGeometry(mesh->GetLayout())->Draw(packet.mRange);
+	AddDrawStats(packet.mRange.mNumIndices / 3);
+}
+
+void Renderer::DrawMesh(const MeshPacket& packet, Shader* shader)
+{
+	Mesh* mesh = packet.mMesh;
+	shader->SetMatrixUniform("uWorldTransform", packet.mWorldTransform);
+	shader->SetFloatUniform("uSpecPower", mesh->GetSpecPower());
+	if (mesh->GetLayout() == VertexLayout::PosNormTexCompact)
+	{
+		shader->SetVectorUniform("uPosOffset", mesh->GetQuantization().mOffset);
+		shader->SetVectorUniform("uPosScale", mesh->GetQuantization().mScale);
+	}
+	if (Texture* t = packet.mTexture)
+	{
+		t->SetActive();
+		shader->SetIntUniform("uTextureLayer", t->GetLayer());
+		if (TextureStreamer* streamer = Game::GetResourceInstance()->GetTextureStreamer())
+		{
+			streamer->ReportUsage(t, packet.mScreenSize);
+		}
+	}
+	else
+	{
+		SDL_Log("MeshComponent : Texture does not get");
+	}
+	if (Texture* t = mesh->GetNormalTexture())
+	{
+		//unit 0 stays the material's, so Texture::SetActive's bind tracking still holds
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, t->GetTextureID());
+		glActiveTexture(GL_TEXTURE0);
+		shader->SetIntUniform("uNormalLayer", t->GetLayer());
+		if (TextureStreamer* streamer = Game::GetResourceInstance()->GetTextureStreamer())
+		{
+			streamer->ReportUsage(t, packet.mScreenSize);
+		}
+	}
+	SDL_assert(packet.mRange.mNumIndices > 0);
+	GetMeshGeometry(mesh->GetLayout())->Draw(packet.mRange);
+	AddDrawStats(packet.mRange.mNumIndices / 3);
 }
 
 void Renderer::AddSprite(SpriteComponent* sc)
@@ -143,11 +906,53 @@ void Renderer::RemoveSprite(SpriteComponent* sc)
 	}
 }
 
+void Renderer::AddText(TextComponent* text)
+{
+	mTexts.emplace_back(text);
+}
+
+void Renderer::RemoveText(TextComponent* text)
+{
+	auto iter = std::ranges::find(mTexts, text);
+	if (iter != mTexts.end())
+	{
+		mTexts.erase(iter);
+	}
+}
+
 void Renderer::AddMeshComp(MeshComponent* mc)
 {
 	mMeshComps.emplace_back(mc);
 }
 
+void Renderer::AddOccluder(MeshComponent* mc)
+{
+	mOccluders.emplace_back(mc);
+}
+
+void Renderer::RemoveOccluder(MeshComponent* mc)
+{
+	auto iter = std::ranges::find(mOccluders, mc);
+	if (iter != mOccluders.end())
+	{
+		mOccluders.erase(iter);
+	}
+}
+
+void Renderer::AddPointLight(PointLightComponent* light)
+{
+	mPointLights.emplace_back(light);
+}
+
+void Renderer::RemovePointLight(PointLightComponent* light)
+{
+	auto iter = std::ranges::find(mPointLights, light);
+	if (iter != mPointLights.end())
+	{
+		mPointLights.erase(iter);
+	}
+}
+
 void Renderer::RemoveMeshComp(MeshComponent* mc)
 {
 	auto iter = std::ranges::find(mMeshComps, mc);
@@ -158,27 +963,57 @@ void Renderer::RemoveMeshComp(MeshComponent* mc)
 	}
 }
 
-void Renderer::CreateSpriteVerts()
-{ 
-	float vertexBuffer[] = {
-	-0.5f, 0.5f, 0.f,0.0f, 0.f, 0.f, 0.f, 0.f,
-	0.5f, 0.5f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f,
-	0.5f, -0.5f, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f,
-	-0.5f, -0.5f, 0.f, 0.f, 0.f, 0.f, 0.f, 1.f
-	};
+void Renderer::RemoveFromStaticBatch(MeshComponent* mc)
+{
+	mBatchRemovals.push_back({ mc->GetBatch(), mc->GetBatchIndex() });
+	mc->SetBatch(nullptr, 0);
+}
+
+void Renderer::BuildStaticBatches()
+{
+	if (!mStaticBatchesRequested || Game::GetResourceInstance()->GetNumPendingTextures() > 0)
+	{
+		return;
+	}
+	mStaticBatchesRequested = false;
+
+	auto iter = std::stable_partition(mMeshComps.begin(), mMeshComps.end(),
+		[](MeshComponent* mc)
+		{
+			//batches carry one layer per vertex for the diffuse texture only, so normal mapped meshes stay out
+			return !mc->GetOwner()->IsStatic() || mc->GetMesh() == nullptr || mc->GetMesh()->GetNormalTexture() != nullptr;
+		});
+
+	size_t firstNewBatch = mNewStaticBatches.size();
+	for (auto staticIter = iter; staticIter != mMeshComps.end(); ++staticIter)
+	{
+		MeshComponent* mc = *staticIter;
+		Mesh* mesh = mc->GetMesh();
+		Texture* texture = mesh->GetTexture(mc->GetTextureIndex());
 
-	unsigned int indexBuffer[] = {
-		0, 1, 2,
-		2, 3, 0
-	};
+		auto batchIter = std::find_if(mNewStaticBatches.begin() + firstNewBatch, mNewStaticBatches.end(),
+			[texture, mesh](const std::unique_ptr<StaticBatch>& batch)
+			{
+				return batch->CanMerge(mesh, texture, mesh->GetSpecPower());
+			});
+		if (batchIter == mNewStaticBatches.end())
+		{
+			mNewStaticBatches.emplace_back(std::make_unique<StaticBatch>(texture, mesh->GetSpecPower(), mesh->GetShaderName()));
+			batchIter = mNewStaticBatches.end() - 1;
+		}
 
-	mSpriteVerts = std::make_unique<VertexArray>(vertexBuffer, 4, indexBuffer, 6);
+		mc->GetOwner()->ComputeWorldTransform();
+		size_t index = (*batchIter)->AddMesh(mesh, mc->GetOwner()->GetWorldTransform(), texture);
+		mc->SetBatch(batchIter->get(), index);
+	}
+	//uploaded and drawn by the render thread from the next frame built on
+	mMeshComps.erase(iter, mMeshComps.end());
 }
 
 bool Renderer::LoadShaders()
 { 
 	mSpriteShader = std::make_unique<Shader>();
-	if (!mSpriteShader->Load("Shaders/Sprite.vert", "Shaders/Sprite.frag"))
+	if (!mSpriteShader->Load("Shaders/SpriteBatch.vert", "Shaders/SpriteBatch.frag"))
 	{
 		return false;
 	}
@@ -186,26 +1021,52 @@ bool Renderer::LoadShaders()
 	Matrix4 viewProj = Matrix4::CreateSimpleViewProj(1024.f, 768.f);
 	mSpriteShader->SetMatrixUniform("uViewProj", viewProj);
 
-	mMeshShader = std::make_unique<Shader>();
-	if (!mMeshShader->Load("Shaders/Phong.vert", "Shaders/Phong.frag"))
+	mTextShader = std::make_unique<Shader>();
+	if (!mTextShader->Load("Shaders/SpriteBatch.vert", "Shaders/SdfText.frag"))
 	{
 		return false;
 	}
-	mMeshShader->SetActive();
+	mTextShader->SetActive();
+	mTextShader->SetMatrixUniform("uViewProj", viewProj);
+
 	mView = Matrix4::CreateLookAt(Vector3::Zero, Vector3::UnitX, Vector3::UnitZ);
 	mProjection = Matrix4::CreatePerspectiveFOV(Math::ToRadians(70.0f),
 		mGame->GetScreenSize().x, mGame->GetScreenSize().y, 25.0f, 10000.0f);
-	mMeshShader->SetMatrixUniform("uViewProj", mView * mProjection);
+
+	mShaderLibrary = std::make_unique<ShaderLibrary>();
+	mShaderLibrary->Register("Phong", "Shaders/Phong.vert", "Shaders/Phong.frag",
+		ShaderFeature::Compact | ShaderFeature::NormalMap | ShaderFeature::ClusteredLights);
+	//the mesh files still name the unlit shader from before lighting, which cannot sample texture arrays
+	mShaderLibrary->AddAlias("BasicMesh", "Phong");
+	mShaderLibrary->SetFallback("Phong");
+	//positions only, for the depth prepass
+	mShaderLibrary->Register("Depth", "Shaders/Phong.vert", "Shaders/Depth.frag",
+		ShaderFeature::Compact);
+	//what the mesh layouts need goes to the driver now; other permutations on first use
+	for (size_t i = 0; i < static_cast<size_t>(VertexLayout::NumLayouts); ++i)
+	{
+		mShaderLibrary->Request("Depth", GetLayoutFeatures(static_cast<VertexLayout>(i)));
+		mShaderLibrary->Request("Phong", GetLayoutFeatures(static_cast<VertexLayout>(i)));
+		mShaderLibrary->Request("Phong", GetLayoutFeatures(static_cast<VertexLayout>(i)) | ShaderFeature::ClusteredLights);
+	}
 	return true;
 }
 
-void Renderer::SetLightUniforms(Shader* shader)
+Shader* Renderer::GetMeshShader(const std::string& shaderName, VertexLayout layout, uint32_t features)
 {
-	Matrix4 invView = mView;
-	invView.Invert();
-	shader->SetVectorUniform("uCameraPos", invView.GetTranslation());
-	shader->SetVectorUniform("uAmbientLight", mAmbientLight);
-	shader->SetVectorUniform("uDirLight.mDirection", mDirLight.mDirection);
-	shader->SetVectorUniform("uDirLight.mDiffuseColor", mDirLight.mDiffuseColor);
-	shader->SetVectorUniform("uDirLight.mSpecColor", mDirLight.mSpecColor);
+	return mShaderLibrary->Get(shaderName, GetLayoutFeatures(layout) | features);
+}
+
+void Renderer::SetLightUniforms(Shader* shader, const RenderFrame& frame)
+{
+	shader->SetVectorUniform("uCameraPos", frame.mCameraPos);
+	shader->SetVectorUniform("uAmbientLight", frame.mAmbientLight);
+	shader->SetVectorUniform("uDirLight.mDirection", frame.mDirLight.mDirection);
+	shader->SetVectorUniform("uDirLight.mDiffuseColor", frame.mDirLight.mDiffuseColor);
+	shader->SetVectorUniform("uDirLight.mSpecColor", frame.mDirLight.mSpecColor);
+	if (!frame.mPointLights.empty())
+	{
+		mLightClusters->Bind(shader, frame, static_cast<float>(mDynamicResolution->GetSceneWidth()),
+			static_cast<float>(mDynamicResolution->GetSceneHeight()));
+	}
 }
\ No newline at end of file
@@ -2,56 +2,247 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include "Math.h"
 #include <SDL.h>
+#include "VertexFormat.h"
+#include "RenderFrame.h"
+#include "GpuProfiler.h"
 
-struct DirectionalLight
+struct RenderStats
 {
-	Vector3 mDirection;
-	Vector3 mDiffuseColor;
-	Vector3 mSpecColor;
+	unsigned int mDrawCalls = 0;
+	unsigned int mTriangles = 0;
+	//mesh components outside the frustum or occluded, and the game thread's time to cull and sort the rest
+	unsigned int mMeshesCulled = 0;
+	float mMeshBuildMs = 0.0f;
+	//point and spot lights, and the game thread's time to bin them into clusters
+	unsigned int mPointLights = 0;
+	float mLightBinMs = 0.0f;
+	//GPU time of the frame and each pass, a few frames behind; empty until the first queries land
+	std::vector<GpuScopeTiming> mGpuTimings;
+	//the RenderFrame::mFrameNumber these counts and mGpuTimings belong to, -1 before the first
+	int mFrame = -1;
+	int mGpuFrame = -1;
+	//mesh programs still compiling
+	unsigned int mShadersPending = 0;
+	//fraction of the window's width and height the meshes were drawn at
+	float mRenderScale = 1.0f;
 };
 
+//the front end runs on the game thread: components register here and SubmitFrame
+//snapshots them into a RenderFrame. Once StartRenderThread is called, a render thread owns
+//the GL context and draws the previous frame (texture uploads and streaming included)
+//while the game simulates the next one. Before that, frames are drawn on the caller.
+//The members below are grouped by the thread that owns them; the ResourceManager goes
+//with the GL context, and the game thread reaches it through RunOnGLThread.
+//A headless Game (Game::SetHeadless) renders into an offscreen framebuffer, without a window
+//in RENDERER_EGL builds (CMakeLists.txt) and behind a hidden one otherwise
 class Renderer
 {
 public:
 	Renderer(class Game* game);
 	~Renderer();
 
+	//false when there is no context or the renderer's own resources fail to load
 	bool Initialize();
 	void Shutdown();
 	void UnloadData();
-	void Draw();
+	//game thread, once per frame after the update
+	void SubmitFrame();
+
+	//hands the GL context, and with it the ResourceManager, to a new render thread
+	void StartRenderThread();
+	//draws the frame still queued, then takes the context back to the calling thread
+	void StopRenderThread();
+	bool IsRenderThreadRunning() const { return mRenderThread.joinable(); }
+	//the render thread while it runs, otherwise whichever thread calls
+	bool IsGLThread() const;
+	//runs task on the GL thread and waits for it; the render thread takes it between frames
+	void RunOnGLThread(const std::function<void()>& task);
 
 	void AddSprite(class SpriteComponent* sprite);
 	void RemoveSprite(class SpriteComponent* sprite);
 
+	void AddText(class TextComponent* text);
+	void RemoveText(class TextComponent* text);
+
 	void AddMeshComp(class MeshComponent* meshcomp);
 	void RemoveMeshComp(class MeshComponent* mc);
+	//the batch stops drawing the component's mesh from the next frame on
+	void RemoveFromStaticBatch(class MeshComponent* mc);
+	//MeshComponent::SetOccluder calls these; static occluders stay occluders after batching
+	void AddOccluder(class MeshComponent* mc);
+	void RemoveOccluder(class MeshComponent* mc);
+	void AddPointLight(class PointLightComponent* light);
+	void RemovePointLight(class PointLightComponent* light);
+	//opaque meshes strictly front to back (on by default) instead of grouped by program
+	void SetFrontToBack(bool enabled) { mFrontToBack = enabled; }
+	bool GetFrontToBack() const { return mFrontToBack; }
+	//depth only pass before shading, so each pixel is shaded once (off by default)
+	void SetDepthPrepass(bool enabled) { mDepthPrepass = enabled; }
+	bool GetDepthPrepass() const { return mDepthPrepass; }
+	//bars for mGpuTimings on top of the frame
+	void SetGpuOverlay(bool enabled) { mGpuOverlay = enabled; }
+	bool GetGpuOverlay() const { return mGpuOverlay; }
+	//writes every frame from the next one on into directory, creating it if needed
+	bool StartCapture(const std::string& directory, CaptureFormat format = CaptureFormat::Png);
+	void StopCapture() { mCaptureDirectory.clear(); }
+	bool IsCapturing() const { return !mCaptureDirectory.empty(); }
+	//meshes drawn at a resolution that follows the GPU frame time (off by default)
+	void SetDynamicResolution(const DynamicResolutionSettings& settings) { mResolutionSettings = settings; }
+	const DynamicResolutionSettings& GetDynamicResolution() const { return mResolutionSettings; }
+	void SetOcclusionCulling(bool enabled) { mOcclusionCulling = enabled; }
+	bool GetOcclusionCulling() const { return mOcclusionCulling; }
+
+	//merges static meshes once every pending texture has landed in its array layer,
+	//since batches bake the layer into their vertices; until then they draw one by one
+	void RequestStaticBatches() { mStaticBatchesRequested = true; }
+	class GeometryBuffer* GetMeshGeometry(VertexLayout layout) const { return mMeshGeometry[static_cast<size_t>(layout)].get(); }
+	//the permutation of a mesh file's shader for a vertex layout and any other features,
+	//nullptr while it compiles
+	class Shader* GetMeshShader(const std::string& shaderName, VertexLayout layout, uint32_t features = 0);
+	class ShaderLibrary* GetShaderLibrary() const { return mShaderLibrary.get(); }
+
+	void AddDrawStats(unsigned int numTriangles, unsigned int numDrawCalls = 1)
+	{
+		mFrameStats.mDrawCalls += numDrawCalls;
+		mFrameStats.mTriangles += numTriangles;
+	}
+	//counts of the last frame the render thread finished
+	const RenderStats& GetStats() const { return mStats; }
+	//the number the next SubmitFrame gives its frame, counting from 0
+	unsigned int GetFrameNumber() const { return mFrameNumber; }
 
-	void SetLightUniforms(class Shader* shader);
+	void SetLightUniforms(class Shader* shader, const RenderFrame& frame);
 	void SetViewMatrix(const Matrix4& view) noexcept { mView = view; }
 	void SetAmbientLight(const Vector3& ambient) noexcept { mAmbientLight = ambient; }
 	DirectionalLight& GetDirectionalLight() noexcept { return mDirLight; }
 	Matrix4& GetView() noexcept { return mView; }
 private:
 	bool LoadShaders();
-	void CreateSpriteVerts();
+	//a window's context, or with a headless game a surfaceless EGL one (RENDERER_EGL builds)
+	//or a hidden window's
+	bool CreateContext();
+	bool CreateOffscreenTarget();
+	//on the calling thread, or released from it
+	void MakeContextCurrent(bool current);
+	//swaps the window, or waits for the GPU when headless
+	void PresentFrame();
+
+	//game thread
+	void BuildFrame(RenderFrame& frame);
+	//rasterizes the occluders for this frame's camera, false when there is nothing to test against
+	bool BuildOcclusion(const RenderFrame& frame);
+	//culls, picks LODs and sorts the mesh packets in chunks on the thread pool
+	void BuildMeshPackets(RenderFrame& frame);
+	//only while the render thread is idle, since it reads texture layers the uploads change
+	void BuildStaticBatches();
+
+	//render thread (or the caller while there is none)
+	void RenderThreadLoop();
+	void DrawFrame(RenderFrame& frame);
+	//every entry of mMeshDraws, with the depth program of each layout when depthOnly
+	void DrawMeshPass(const RenderFrame& frame, bool depthOnly);
+	void DrawMesh(const MeshPacket& packet, class Shader* shader);
+	void DrawMeshDepth(const MeshPacket& packet, class Shader* shader);
+
+	struct MeshSortEntry
+	{
+		uint64_t mKey;
+		uint32_t mChunk;
+		uint32_t mIndex;
+	};
+	//one chunk of mMeshComps; kept across frames to reuse the storage
+	struct MeshChunk
+	{
+		std::vector<MeshPacket> mPackets;
+		std::vector<MeshSortEntry> mEntries;
+		size_t mOffset = 0;
+	};
+	static const size_t MeshChunkSize = 1024;
+
+	struct MeshDraw
+	{
+		class Shader* mShader;
+		VertexLayout mLayout;
+		float mDepth;
+		class StaticBatch* mBatch;
+		const MeshPacket* mMesh;
+	};
 
 	SDL_Window* mWindow = nullptr;
-	SDL_GLContext mContext;
+	SDL_GLContext mContext = nullptr;
+#ifdef RENDERER_EGL
+	void* mEglDisplay = nullptr;
+	void* mEglContext = nullptr;
+#endif
+	//headless only: colour and depth renderbuffers
+	unsigned int mFramebuffer = 0;
+	unsigned int mRenderbuffers[2] = {};
 
+	//game thread
 	std::vector<class SpriteComponent*> mSprites;
+	std::vector<class TextComponent*> mTexts;
 	std::vector<class MeshComponent*> mMeshComps;
-
-	std::unique_ptr<class VertexArray> mSpriteVerts;
-	std::unique_ptr<class Shader> mSpriteShader;
-	std::unique_ptr<class Shader> mMeshShader;
-	
+	std::vector<std::unique_ptr<class StaticBatch>> mNewStaticBatches;
+	std::vector<BatchRemoval> mBatchRemovals;
+	std::vector<class MeshComponent*> mOccluders;
+	std::vector<class PointLightComponent*> mPointLights;
+	std::unique_ptr<class OcclusionBuffer> mOcclusionBuffer;
+	bool mOcclusionCulling = true;
+	bool mFrontToBack = true;
+	bool mDepthPrepass = false;
+	bool mGpuOverlay = false;
+	std::string mCaptureDirectory;
+	CaptureFormat mCaptureFormat = CaptureFormat::Png;
+	DynamicResolutionSettings mResolutionSettings;
+	std::vector<MeshChunk> mMeshChunks;
+	//merge sort buffers for the entries of every chunk
+	std::vector<MeshSortEntry> mMeshSortEntries;
+	std::vector<MeshSortEntry> mMeshSortScratch;
 	Matrix4 mView;
 	Matrix4 mProjection;
 	Vector3 mAmbientLight;
 	DirectionalLight mDirLight;
+	bool mStaticBatchesRequested = false;
+	RenderStats mStats;
+	unsigned int mFrameNumber = 0;
+
+	//render thread
+	std::vector<std::unique_ptr<class StaticBatch>> mStaticBatches;
+	std::unique_ptr<class SpriteBatch> mSpriteBatch;
+	std::array<std::unique_ptr<class GeometryBuffer>, static_cast<size_t>(VertexLayout::NumLayouts)> mMeshGeometry;
+	std::unique_ptr<class Shader> mSpriteShader;
+	std::unique_ptr<class Shader> mTextShader;
+	std::unique_ptr<class ShaderLibrary> mShaderLibrary;
+	//bins on the game thread, uploads on the render thread
+	std::unique_ptr<class LightClusters> mLightClusters;
+	std::unique_ptr<GpuProfiler> mGpuProfiler;
+	std::unique_ptr<FrameCapture> mFrameCapture;
+	std::unique_ptr<DynamicResolution> mDynamicResolution;
+	//rebuilt each frame in draw order, kept to reuse its storage
+	std::vector<MeshDraw> mMeshDraws;
+	RenderStats mFrameStats;
+	//copied to mStats while both threads meet in SubmitFrame
+	RenderStats mBackStats;
+
+	//the game thread fills mFrames[mFrontFrame] while the render thread draws the other
+	std::array<std::unique_ptr<RenderFrame>, 2> mFrames;
+	size_t mFrontFrame = 0;
+	std::thread mRenderThread;
+	std::mutex mFrameMutex;
+	std::condition_variable mFrameQueuedCondition;
+	std::condition_variable mFrameDoneCondition;
+	//guarded by mFrameMutex
+	bool mFrameQueued = false;
+	bool mStopRenderThread = false;
+	//from RunOnGLThread, nullptr once run
+	const std::function<void()>* mGLTask = nullptr;
 
 	class Game* mGame;
 };
\ No newline at end of file
@@ -1,11 +1,39 @@
 #include "ResourceManager.h"
+#include <SDL.h>
 #include "Texture.h"
 #include "Mesh.h"
 #include "Game.h"
 #include "Renderer.h"
+#include "TextureAtlas.h"
+#include "AsyncTextureLoader.h"
+#include "TextureArray.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
+#include "Font.h"
+#include "stb_image.h"
+
+namespace
+{
+	//true when the call was handed to the render thread and has run there
+	bool ForwardToGLThread(const std::function<void()>& task)
+	{
+		Renderer* renderer = Game::GetRendererInstance();
+		if (!renderer || renderer->IsGLThread())
+		{
+			return false;
+		}
+		renderer->RunOnGLThread(task);
+		return true;
+	}
+}
 
 ResourceManager::ResourceManager(Game* game)
 	:mGame(game)
+	, mOptimizeMeshesOnLoad(true)
+	, mGenerateMeshLodsOnLoad(true)
+	, mAtlasSpritesOnLoad(true)
+	, mAsyncTextureLoads(true)
+	, mTextureStreaming(true)
 {
 
 }
@@ -17,12 +45,33 @@ ResourceManager::~ResourceManager()
 
 Texture* ResourceManager::GetTexture(const std::string& fileName)
 {
+	Texture* forwarded = nullptr;
+	if (ForwardToGLThread([&] { forwarded = GetTexture(fileName); }))
+	{
+		return forwarded;
+	}
 	Texture* tex = nullptr;
 	auto iter = mTextures.find(fileName);
 	if (iter != mTextures.end())
 	{
 		tex = iter->second.get();
 	}
+	else if (mAsyncTextureLoads && fileName != DefaultTexture)
+	{
+		Texture* placeholder = GetTexture(DefaultTexture);
+		if (!TextureCooker::Exists(fileName))
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+		}
+		else if (placeholder)
+		{
+			std::unique_ptr<Texture> uniTex = std::make_unique<Texture>();
+			uniTex->InitAsRegion(placeholder->GetTextureID(), placeholder->GetWidth(), placeholder->GetHeight(), TextureRect());
+			GetTextureLoader()->Request(uniTex.get(), fileName);
+			tex = uniTex.get();
+			mTextures.emplace(fileName, std::move(uniTex));
+		}
+	}
 	else
 	{
 		std::unique_ptr<Texture> uniTex = std::make_unique<Texture>();
@@ -35,8 +84,170 @@ Texture* ResourceManager::GetTexture(const std::string& fileName)
 	return tex;
 }
 
+Texture* ResourceManager::GetMaterialTexture(const std::string& fileName)
+{
+	Texture* forwarded = nullptr;
+	if (ForwardToGLThread([&] { forwarded = GetMaterialTexture(fileName); }))
+	{
+		return forwarded;
+	}
+	auto iter = mMaterialTextures.find(fileName);
+	if (iter != mMaterialTextures.end())
+	{
+		return iter->second.get();
+	}
+
+	std::unique_ptr<Texture> uniTex = std::make_unique<Texture>();
+	if (mAsyncTextureLoads && fileName != DefaultTexture)
+	{
+		Texture* placeholder = GetMaterialTexture(DefaultTexture);
+		if (!placeholder || !TextureCooker::Exists(fileName))
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+			return nullptr;
+		}
+		uniTex->InitAsLayer(placeholder->GetArray(), placeholder->GetLayer(), placeholder->GetWidth(), placeholder->GetHeight());
+		GetTextureLoader()->RequestLayer(uniTex.get(), fileName);
+	}
+	else
+	{
+		TextureData data;
+		if (!TextureCooker::LoadPreferCooked(fileName, data, GLEW_EXT_texture_compression_s3tc))
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+			return nullptr;
+		}
+		if (data.mMips.size() == 1)
+		{
+			TextureCooker::GenerateMips(data);
+		}
+		TextureArray* array = GetTextureArray(data);
+		int layer = array->AllocateLayer(fileName);
+		array->UploadLayer(layer, data);
+		uniTex->InitAsLayer(array, layer, data.mMips[0].mWidth, data.mMips[0].mHeight);
+	}
+
+	Texture* tex = uniTex.get();
+	mMaterialTextures.emplace(fileName, std::move(uniTex));
+	return tex;
+}
+
+TextureArray* ResourceManager::GetTextureArray(const TextureData& data)
+{
+	for (auto& array : mTextureArrays)
+	{
+		if (!array->IsFull() && array->IsCompatible(data))
+		{
+			return array.get();
+		}
+	}
+	const TextureMip& base = data.mMips[0];
+	int numMips = static_cast<int>(data.mMips.size());
+	//streamed arrays start small and load finer levels once they are seen
+	TextureStreamer* streamer = GetTextureStreamer();
+	int baseLevel = streamer ? streamer->GetMinResidentLevel(base.mWidth, base.mHeight, numMips) : 0;
+	mTextureArrays.emplace_back(std::make_unique<TextureArray>(data.mFormat, base.mWidth, base.mHeight,
+		numMips, TextureArray::DefaultMaxLayers, baseLevel));
+	SDL_Log("Texture array %zu : %dx%d, %zu mips", mTextureArrays.size() - 1, base.mWidth, base.mHeight, data.mMips.size());
+	return mTextureArrays.back().get();
+}
+
+AsyncTextureLoader* ResourceManager::GetTextureLoader()
+{
+	if (!mTextureLoader)
+	{
+		mTextureLoader = std::make_unique<AsyncTextureLoader>(Game::GetThreadPoolInstance());
+		mTextureLoader->SetArraySelector([this](const TextureData& data) { return GetTextureArray(data); });
+		mTextureLoader->SetAtlasInserter([this](const std::string& fileName, const TextureMip& mip, Texture* texture)
+			{
+				if (!mSpriteAtlas->Insert(fileName, mip.mData.data(), mip.mWidth, mip.mHeight))
+				{
+					return false;
+				}
+				Texture* region = mSpriteAtlas->GetTexture(fileName);
+				texture->InitAsRegion(region->GetTextureID(), region->GetWidth(), region->GetHeight(), region->GetUVRect());
+				return true;
+			});
+	}
+	return mTextureLoader.get();
+}
+
+Texture* ResourceManager::GetSpriteTexture(const std::string& fileName)
+{
+	Texture* forwarded = nullptr;
+	if (ForwardToGLThread([&] { forwarded = GetSpriteTexture(fileName); }))
+	{
+		return forwarded;
+	}
+	if (!mSpriteAtlas)
+	{
+		mSpriteAtlas = std::make_unique<TextureAtlas>();
+	}
+	if (Texture* tex = mSpriteAtlas->GetTexture(fileName))
+	{
+		return tex;
+	}
+
+	if (mAtlasSpritesOnLoad && mAsyncTextureLoads && fileName != DefaultTexture && mTextures.find(fileName) == mTextures.end())
+	{
+		//shows DefaultTexture until the loader packs it, or gives it its own texture when too big
+		Texture* placeholder = GetTexture(DefaultTexture);
+		if (!TextureCooker::Exists(fileName))
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+			return nullptr;
+		}
+		if (placeholder)
+		{
+			std::unique_ptr<Texture> uniTex = std::make_unique<Texture>();
+			uniTex->InitAsRegion(placeholder->GetTextureID(), placeholder->GetWidth(), placeholder->GetHeight(), TextureRect());
+			GetTextureLoader()->RequestRegion(uniTex.get(), fileName);
+			Texture* tex = uniTex.get();
+			mTextures.emplace(fileName, std::move(uniTex));
+			return tex;
+		}
+	}
+	else if (mAtlasSpritesOnLoad && mTextures.find(fileName) == mTextures.end())
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		if (stbi_info(fileName.c_str(), &width, &height, &channels) &&
+			width <= TextureAtlas::MaxEntrySize && height <= TextureAtlas::MaxEntrySize)
+		{
+			unsigned char* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+			bool packed = pixels && mSpriteAtlas->Insert(fileName, pixels, width, height);
+			stbi_image_free(pixels);
+			if (packed)
+			{
+				return mSpriteAtlas->GetTexture(fileName);
+			}
+		}
+	}
+	return GetTexture(fileName);
+}
+
+bool ResourceManager::LoadSpriteAtlas(const std::string& fileName)
+{
+	bool forwarded = false;
+	if (ForwardToGLThread([&] { forwarded = LoadSpriteAtlas(fileName); }))
+	{
+		return forwarded;
+	}
+	if (!mSpriteAtlas)
+	{
+		mSpriteAtlas = std::make_unique<TextureAtlas>();
+	}
+	return mSpriteAtlas->Load(fileName);
+}
+
 Mesh* ResourceManager::GetMesh(const std::string& fileName)
 {
+	Mesh* forwarded = nullptr;
+	if (ForwardToGLThread([&] { forwarded = GetMesh(fileName); }))
+	{
+		return forwarded;
+	}
 	Mesh* m = nullptr;
 	auto iter = mMeshes.find(fileName);
 	if (iter != mMeshes.end())
@@ -56,7 +267,103 @@ Mesh* ResourceManager::GetMesh(const std::string& fileName)
 	return m;
 }
 
+Font* ResourceManager::GetFont(const std::string& fileName)
+{
+	Font* forwarded = nullptr;
+	if (ForwardToGLThread([&] { forwarded = GetFont(fileName); }))
+	{
+		return forwarded;
+	}
+	auto iter = mFonts.find(fileName);
+	if (iter != mFonts.end())
+	{
+		return iter->second.get();
+	}
+	std::unique_ptr<Font> font = std::make_unique<Font>();
+	if (!font->Load(fileName))
+	{
+		return nullptr;
+	}
+	Font* ptr = font.get();
+	mFonts.emplace(fileName, std::move(font));
+	return ptr;
+}
+
+void ResourceManager::Update()
+{
+	if (mTextureLoader)
+	{
+		mTextureLoader->Update();
+	}
+	if (TextureStreamer* streamer = GetTextureStreamer())
+	{
+		streamer->Update(mTextureArrays);
+	}
+}
+
+TextureStreamer* ResourceManager::GetTextureStreamer()
+{
+	if (!mTextureStreaming)
+	{
+		return nullptr;
+	}
+	if (!mTextureStreamer)
+	{
+		mTextureStreamer = std::make_unique<TextureStreamer>(Game::GetThreadPoolInstance());
+	}
+	return mTextureStreamer.get();
+}
+
+void ResourceManager::SetTextureBudget(size_t bytes)
+{
+	if (!mTextureStreamer)
+	{
+		mTextureStreamer = std::make_unique<TextureStreamer>(Game::GetThreadPoolInstance());
+	}
+	mTextureStreamer->SetBudget(bytes);
+}
+
+size_t ResourceManager::GetTextureBudget() const
+{
+	return mTextureStreamer ? mTextureStreamer->GetBudget() : TextureStreamer::DefaultBudget;
+}
+
+TextureStreamStats ResourceManager::GetTextureStreamStats() const
+{
+	return mTextureStreamer ? mTextureStreamer->GetStats() : TextureStreamStats();
+}
+
+size_t ResourceManager::GetNumPendingTextures() const
+{
+	return mTextureLoader ? mTextureLoader->GetNumPending() : 0;
+}
+
+bool ResourceManager::IsTexturePending(const Texture* texture) const
+{
+	return mTextureLoader && mTextureLoader->IsPending(texture);
+}
+
+void ResourceManager::SetTextureUploadBudget(size_t bytes)
+{
+	GetTextureLoader()->SetUploadBudget(bytes);
+}
+
+size_t ResourceManager::GetTextureUploadBudget() const
+{
+	return mTextureLoader ? mTextureLoader->GetUploadBudget() : AsyncTextureLoader::DefaultUploadBudget;
+}
+
 void ResourceManager::Unload()
 {
+	//pending uploads point at the textures about to go away
+	mTextureLoader.reset();
+	if (mTextureStreamer)
+	{
+		mTextureStreamer->Cancel();
+	}
 	mTextures.clear();
+	mMaterialTextures.clear();
+	mTextureArrays.clear();
+	mSpriteAtlas.reset();
+	mFonts.clear();
 }
\ No newline at end of file
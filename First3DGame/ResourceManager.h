@@ -1,20 +1,77 @@
 #pragma once
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <string>
 
 class Texture;
 
+//everything here, the maps as much as the GL objects behind them, belongs to the thread
+//holding the GL context: the render thread while it runs (Renderer::StartRenderThread).
+//The getters called from the game thread then hand the load over and wait for it, so
+//they cost up to a frame; the rest (Update, streaming, IsTexturePending) is render thread only
 class ResourceManager
 {
 public:
 	explicit ResourceManager(class Game* game);
 	~ResourceManager();
+	//with async loads on, new textures show DefaultTexture until decoded and uploaded
 	Texture* GetTexture(const std::string& fileName);
+	//small images come back as regions of a shared atlas page so sprites batch across them
+	Texture* GetSpriteTexture(const std::string& fileName);
+	//mesh textures live as layers of texture arrays grouped by size and format, so
+	//materials sharing an array draw (and batch) without rebinding
+	Texture* GetMaterialTexture(const std::string& fileName);
+	bool LoadSpriteAtlas(const std::string& fileName);
 	class Mesh* GetMesh(const std::string& fileName);
+	//fonts are opened once; glyphs are cached inside the Font as they are drawn
+	class Font* GetFont(const std::string& fileName);
 	void Unload();
+	//streams pending texture uploads; once per frame on the GL thread
+	void Update();
+
+	void SetOptimizeMeshesOnLoad(bool optimize) { mOptimizeMeshesOnLoad = optimize; }
+	bool GetOptimizeMeshesOnLoad() const { return mOptimizeMeshesOnLoad; }
+	void SetGenerateMeshLodsOnLoad(bool generate) { mGenerateMeshLodsOnLoad = generate; }
+	bool GetGenerateMeshLodsOnLoad() const { return mGenerateMeshLodsOnLoad; }
+	//packs sprite textures missing from the loaded atlas as they are requested
+	void SetAtlasSpritesOnLoad(bool atlas) { mAtlasSpritesOnLoad = atlas; }
+	bool GetAtlasSpritesOnLoad() const { return mAtlasSpritesOnLoad; }
+	void SetAsyncTextureLoads(bool async) { mAsyncTextureLoads = async; }
+	bool GetAsyncTextureLoads() const { return mAsyncTextureLoads; }
+	size_t GetNumPendingTextures() const;
+	//still showing its placeholder
+	bool IsTexturePending(const Texture* texture) const;
+	void SetTextureUploadBudget(size_t bytes);
+	size_t GetTextureUploadBudget() const;
+	size_t GetNumTextureArrays() const { return mTextureArrays.size(); }
+	//with streaming on, texture arrays keep only the mips their meshes are drawn at, under a VRAM budget
+	void SetTextureStreaming(bool stream) { mTextureStreaming = stream; }
+	bool GetTextureStreaming() const { return mTextureStreaming; }
+	//nullptr while streaming is off
+	class TextureStreamer* GetTextureStreamer();
+	void SetTextureBudget(size_t bytes);
+	size_t GetTextureBudget() const;
+	struct TextureStreamStats GetTextureStreamStats() const;
+
+	static constexpr const char* DefaultTexture = "Assets/Default.png";
 private:
+	//an array matching the data's size, format and mip count with a free layer, made if needed
+	class TextureArray* GetTextureArray(const struct TextureData& data);
+	class AsyncTextureLoader* GetTextureLoader();
+
 	class Game* mGame;
+	bool mOptimizeMeshesOnLoad;
+	bool mGenerateMeshLodsOnLoad;
+	bool mAtlasSpritesOnLoad;
+	bool mAsyncTextureLoads;
+	bool mTextureStreaming;
+	std::unique_ptr<class AsyncTextureLoader> mTextureLoader;
+	std::unique_ptr<class TextureStreamer> mTextureStreamer;
+	std::unique_ptr<class TextureAtlas> mSpriteAtlas;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+	std::unordered_map<std::string, std::unique_ptr<Texture>> mMaterialTextures;
+	std::vector<std::unique_ptr<class TextureArray>> mTextureArrays;
 	std::unordered_map<std::string, std::unique_ptr<Mesh>> mMeshes;
+	std::unordered_map<std::string, std::unique_ptr<class Font>> mFonts;
 };
\ No newline at end of file
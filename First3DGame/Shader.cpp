@@ -4,11 +4,19 @@
 #include <string>
 #include <glew.h>
 #include <SDL.h>
+#include <filesystem>
+#include "ShaderCache.h"
+#include "GpuDebug.h"
+
+bool Shader::sUseBinaryCache = true;
 
 Shader::Shader()
 	:mShaderProgram(0)
 	,mVertexShader(0)
 	,mFragShader(0)
+	,mStatus(ShaderStatus::Failed)
+	,mLoadedFromCache(false)
+	,mCacheKey(0)
 {
 
 }
@@ -18,34 +26,54 @@ Shader::~Shader()
 
 }
 
-bool Shader::CompileShader(const std::string& fileName,
-	GLenum  shaderType,
-	GLuint& outShader)
+bool Shader::ReadSource(const std::string& fileName, std::string& outSource)
 {
 	std::ifstream shaderFile(fileName);
-	if (shaderFile.is_open())
+	if (!shaderFile.is_open())
 	{
-		std::stringstream sstream;
-		sstream << shaderFile.rdbuf();
-		std::string contents = sstream.str();
-		const char* contentsChar = contents.c_str();
-
-		outShader = glCreateShader(shaderType);
-		glShaderSource(outShader, 1, &(contentsChar), nullptr);
-		glCompileShader(outShader);
+		SDL_Log("Shader file not found : %s", fileName.c_str());
+		return false;
+	}
+	std::stringstream sstream;
+	sstream << shaderFile.rdbuf();
+	outSource = sstream.str();
+	return true;
+}
 
-		if (!IsCompiled(outShader))
-		{
-			SDL_Log("Shader compilation failed : %s", fileName.c_str());
-			return false;
-		}
+std::string Shader::InsertDefines(const std::string& source, const std::vector<std::string>& defines)
+{
+	if (defines.empty())
+	{
+		return source;
+	}
+	//#version has to stay the first line
+	size_t lineEnd = source.find('\n');
+	if (lineEnd == std::string::npos || source.compare(0, 8, "#version") != 0)
+	{
+		lineEnd = 0;
 	}
 	else
 	{
-		SDL_Log("Shader file not found : %s", fileName.c_str());
-		return false;
+		++lineEnd;
 	}
-	return true;
+	std::string block;
+	for (const std::string& define : defines)
+	{
+		block += "#define " + define + "\n";
+	}
+	//keeps compiler messages on the file's own line numbers
+	block += "#line " + std::to_string(lineEnd > 0 ? 2 : 1) + "\n";
+	return source.substr(0, lineEnd) + block + source.substr(lineEnd);
+}
+
+GLuint Shader::SubmitShader(const std::string& source, GLenum shaderType)
+{
+	const char* contentsChar = source.c_str();
+
+	GLuint shader = glCreateShader(shaderType);
+	glShaderSource(shader, 1, &(contentsChar), nullptr);
+	glCompileShader(shader);
+	return shader;
 }
 
 bool Shader::IsCompiled(GLuint shader)
@@ -64,23 +92,99 @@ bool Shader::IsCompiled(GLuint shader)
 }
 
 bool Shader::Load(const std::string& vertName,
-	const std::string& fragName)
+	const std::string& fragName,
+	const std::vector<std::string>& defines)
 {
-	if (!CompileShader(vertName, GL_VERTEX_SHADER, mVertexShader) ||
-		!CompileShader(fragName, GL_FRAGMENT_SHADER, mFragShader))
+	return BeginLoad(vertName, fragName, defines) && Finish() == ShaderStatus::Ready;
+}
+
+bool Shader::BeginLoad(const std::string& vertName,
+	const std::string& fragName,
+	const std::vector<std::string>& defines)
+{
+	std::string vertSource;
+	std::string fragSource;
+	if (!ReadSource(vertName, vertSource) || !ReadSource(fragName, fragSource))
 	{
+		mStatus = ShaderStatus::Failed;
 		return false;
 	}
+	vertSource = InsertDefines(vertSource, defines);
+	fragSource = InsertDefines(fragSource, defines);
+	mVertName = vertName;
+	mFragName = fragName;
 
 	mShaderProgram = glCreateProgram();
+	mLoadedFromCache = false;
+	bool useCache = sUseBinaryCache && ShaderCache::IsAvailable();
+	mCacheName = std::filesystem::path(vertName).stem().string() + "_" +
+		std::filesystem::path(fragName).stem().string();
+	for (const std::string& define : defines)
+	{
+		mCacheName += "_" + define;
+	}
+	GpuDebug::SetLabel(GL_PROGRAM, mShaderProgram, mCacheName.c_str());
+	mCacheKey = useCache ? ShaderCache::ComputeKey(vertSource, fragSource) : 0;
+	if (useCache && ShaderCache::LoadProgram(mShaderProgram, mCacheName, mCacheKey))
+	{
+		mLoadedFromCache = true;
+		mStatus = ShaderStatus::Ready;
+		return true;
+	}
+
+	//no status queries here, they would wait for the compiler
+	mVertexShader = SubmitShader(vertSource, GL_VERTEX_SHADER);
+	mFragShader = SubmitShader(fragSource, GL_FRAGMENT_SHADER);
 	glAttachShader(mShaderProgram, mVertexShader);
 	glAttachShader(mShaderProgram, mFragShader);
+	if (useCache)
+	{
+		glProgramParameteri(mShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(mShaderProgram);
+	mStatus = ShaderStatus::Pending;
+	return true;
+}
+
+ShaderStatus Shader::Poll()
+{
+	if (mStatus == ShaderStatus::Pending && GLEW_KHR_parallel_shader_compile)
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv(mShaderProgram, GL_COMPLETION_STATUS_KHR, &done);
+		if (done != GL_TRUE)
+		{
+			return mStatus;
+		}
+	}
+	return Finish();
+}
+
+ShaderStatus Shader::Finish()
+{
+	if (mStatus != ShaderStatus::Pending)
+	{
+		return mStatus;
+	}
 	if (!IsValidProgram())
 	{
-		return false;
+		if (!IsCompiled(mVertexShader))
+		{
+			SDL_Log("Shader compilation failed : %s", mVertName.c_str());
+		}
+		if (!IsCompiled(mFragShader))
+		{
+			SDL_Log("Shader compilation failed : %s", mFragName.c_str());
+		}
+		mStatus = ShaderStatus::Failed;
+		return mStatus;
 	}
-	return true;
+	if (mCacheKey != 0)
+	{
+		ShaderCache::SaveProgram(mShaderProgram, mCacheName, mCacheKey);
+	}
+	mStatus = ShaderStatus::Ready;
+	return mStatus;
 }
 
 bool Shader::IsValidProgram()
@@ -138,4 +242,10 @@ void Shader::SetFloatUniform(const char* name, const float uni)
 		loc,
 		uni
 	);
+}
+
+void Shader::SetIntUniform(const char* name, const int uni)
+{
+	GLuint loc = glGetUniformLocation(mShaderProgram, name);
+	glUniform1i(loc, uni);
 }
\ No newline at end of file
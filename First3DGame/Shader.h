@@ -1,29 +1,64 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <glew.h>
 #include "Math.h"
 
+enum class ShaderStatus
+{
+	Pending,
+	Ready,
+	Failed
+};
+
 class Shader
 {
 public:
 	Shader();
 	~Shader();
 
+	//defines are macro names inserted as #define lines after #version in both stages
 	bool Load(const std::string& vertName,
-		const std::string& fragName);
+		const std::string& fragName,
+		const std::vector<std::string>& defines = {});
+	//submits compile and link without waiting for them; false only when a source is missing
+	bool BeginLoad(const std::string& vertName,
+		const std::string& fragName,
+		const std::vector<std::string>& defines = {});
+	//Pending while the driver still compiles, which it only reports with
+	//KHR_parallel_shader_compile; without it this waits for the result
+	ShaderStatus Poll();
+	//waits for the result
+	ShaderStatus Finish();
+	ShaderStatus GetStatus() const { return mStatus; }
 	void Unload();
 
 	void SetActive();
 	void SetMatrixUniform(const char* name, const Matrix4& matrix);
 	void SetVectorUniform(const char* name, const Vector3& vec);
 	void SetFloatUniform(const char* name, const float uni);
+	void SetIntUniform(const char* name, const int uni);
+
+	//true when the program came from ShaderCache instead of being compiled
+	bool WasLoadedFromCache() const { return mLoadedFromCache; }
+	static void SetUseBinaryCache(bool use) { sUseBinaryCache = use; }
 private:
-	bool CompileShader(const std::string& fileName,
-		GLenum shaderType, GLuint& outShader);
+	bool ReadSource(const std::string& fileName, std::string& outSource);
+	static std::string InsertDefines(const std::string& source, const std::vector<std::string>& defines);
+	GLuint SubmitShader(const std::string& source, GLenum shaderType);
 	bool IsCompiled(GLuint shader);
 	bool IsValidProgram();
 
 	GLuint mVertexShader;
 	GLuint mFragShader;
 	GLuint mShaderProgram;
+	ShaderStatus mStatus;
+	bool mLoadedFromCache;
+	//kept until the link finishes for logging and saving the binary
+	std::string mVertName;
+	std::string mFragName;
+	std::string mCacheName;
+	uint64_t mCacheKey;
+
+	static bool sUseBinaryCache;
 };
\ No newline at end of file
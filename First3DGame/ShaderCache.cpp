@@ -0,0 +1,150 @@
+#include "ShaderCache.h"
+#include <fstream>
+#include <vector>
+#include <filesystem>
+#include <cstdio>
+#include <glew.h>
+#include <SDL.h>
+
+namespace
+{
+	const uint32_t CacheMagic = 0x42535047; //"GPSB"
+	const uint32_t CacheVersion = 1;
+
+	struct CacheHeader
+	{
+		uint32_t mMagic;
+		uint32_t mVersion;
+		uint64_t mKey;
+		uint32_t mBinaryFormat;
+		uint32_t mLength;
+	};
+
+	std::filesystem::path GetPath(const std::string& name, uint64_t key)
+	{
+		char hex[17];
+		snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+		return std::filesystem::path(ShaderCache::Directory) / (name + "_" + hex + ".bin");
+	}
+
+	uint64_t HashString(const char* text, uint64_t seed)
+	{
+		return text ? ShaderCache::Hash(text, strlen(text), seed) : seed;
+	}
+}
+
+bool ShaderCache::IsAvailable()
+{
+	if (!GLEW_ARB_get_program_binary)
+	{
+		return false;
+	}
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
+}
+
+uint64_t ShaderCache::ComputeKey(const std::string& vertSource, const std::string& fragSource)
+{
+	uint64_t key = Hash(vertSource.data(), vertSource.size());
+	//a separator so moving text between the two stages changes the key
+	key = Hash("\0", 1, key);
+	key = Hash(fragSource.data(), fragSource.size(), key);
+	key = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), key);
+	key = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), key);
+	key = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), key);
+	return key;
+}
+
+bool ShaderCache::LoadProgram(unsigned int program, const std::string& name, uint64_t key)
+{
+	std::filesystem::path path = GetPath(name, key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	CacheHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	std::vector<char> binary;
+	bool valid = file.good() && header.mMagic == CacheMagic && header.mVersion == CacheVersion && header.mKey == key;
+	if (valid)
+	{
+		binary.resize(header.mLength);
+		file.read(binary.data(), binary.size());
+		valid = file.gcount() == static_cast<std::streamsize>(binary.size());
+	}
+	file.close();
+
+	if (valid)
+	{
+		glProgramBinary(program, header.mBinaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		valid = status == GL_TRUE;
+	}
+	if (!valid)
+	{
+		SDL_Log("Shader cache : discarding %s", path.string().c_str());
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+	return valid;
+}
+
+bool ShaderCache::SaveProgram(unsigned int program, const std::string& name, uint64_t key)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return false;
+	}
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+	std::error_code ec;
+	std::filesystem::create_directories(Directory, ec);
+	//binaries of older sources or drivers under this name are dead now
+	std::string prefix = name + "_";
+	for (const auto& entry : std::filesystem::directory_iterator(Directory, ec))
+	{
+		std::string fileName = entry.path().filename().string();
+		if (fileName.compare(0, prefix.size(), prefix) == 0 && fileName.size() == prefix.size() + 20)
+		{
+			std::filesystem::remove(entry.path(), ec);
+		}
+	}
+
+	std::filesystem::path path = GetPath(name, key);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		SDL_Log("Shader cache : cannot write %s", path.string().c_str());
+		return false;
+	}
+	CacheHeader header = { CacheMagic, CacheVersion, key, binaryFormat, static_cast<uint32_t>(length) };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), length);
+	return file.good();
+}
+
+void ShaderCache::Clear()
+{
+	std::error_code ec;
+	std::filesystem::remove_all(Directory, ec);
+}
+
+uint64_t ShaderCache::Hash(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//linked program binaries under ShaderCache/, one file per vertex/fragment pair and permutation.
+//The key hashes both sources with the GL vendor, renderer and version strings, so an
+//edited shader or a driver update simply misses and the program is compiled again.
+//Files are { magic, version, key, binaryFormat, length } followed by the driver's blob
+namespace ShaderCache
+{
+	bool IsAvailable();
+	uint64_t ComputeKey(const std::string& vertSource, const std::string& fragSource);
+
+	//false on a miss or when the driver rejects the blob; a rejected file is deleted
+	bool LoadProgram(unsigned int program, const std::string& name, uint64_t key);
+	//the program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+	//Replaces any older binary saved under the same name
+	bool SaveProgram(unsigned int program, const std::string& name, uint64_t key);
+	void Clear();
+
+	//64-bit FNV-1a
+	uint64_t Hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+	constexpr const char* Directory = "ShaderCache";
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "ShaderLibrary.h"
+#include "Shader.h"
+#include <glew.h>
+#include <SDL.h>
+#include <algorithm>
+
+ShaderLibrary::ShaderLibrary()
+	:mSubmitTicks(0)
+	, mNumSubmitted(0)
+{
+	if (IsParallelCompileAvailable())
+	{
+		//lets the driver pick how many threads it compiles on
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+
+}
+
+bool ShaderLibrary::IsParallelCompileAvailable()
+{
+	return GLEW_KHR_parallel_shader_compile;
+}
+
+std::vector<std::string> ShaderLibrary::GetDefines(uint32_t features)
+{
+	std::vector<std::string> defines;
+	for (size_t i = 0; i < ShaderFeature::NumFeatures; ++i)
+	{
+		if (features & (1u << i))
+		{
+			defines.emplace_back(ShaderFeature::Defines[i]);
+		}
+	}
+	return defines;
+}
+
+void ShaderLibrary::Register(const std::string& name, const std::string& vertName,
+	const std::string& fragName, uint32_t features)
+{
+	Source& source = mSources[name];
+	source.mVertName = vertName;
+	source.mFragName = fragName;
+	source.mFeatures = features;
+}
+
+void ShaderLibrary::AddAlias(const std::string& alias, const std::string& name)
+{
+	mAliases[alias] = name;
+}
+
+ShaderLibrary::Source* ShaderLibrary::Find(const std::string& name)
+{
+	auto iter = mSources.find(name);
+	if (iter != mSources.end())
+	{
+		return &iter->second;
+	}
+	auto aliasIter = mAliases.find(name);
+	if (aliasIter != mAliases.end())
+	{
+		iter = mSources.find(aliasIter->second);
+		return iter != mSources.end() ? &iter->second : nullptr;
+	}
+	if (mFallback.empty() || mSources.find(mFallback) == mSources.end())
+	{
+		return nullptr;
+	}
+	//remembered as an alias so the warning shows once
+	SDL_Log("ShaderLibrary : unknown shader %s, using %s", name.c_str(), mFallback.c_str());
+	mAliases[name] = mFallback;
+	return &mSources[mFallback];
+}
+
+ShaderLibrary::Program* ShaderLibrary::Submit(Source& source, uint32_t features)
+{
+	Program& program = source.mPrograms[features];
+	program.mShader = std::make_unique<Shader>();
+	program.mFeatures = features;
+	if (mPending.empty())
+	{
+		mSubmitTicks = SDL_GetPerformanceCounter();
+		mNumSubmitted = 0;
+	}
+	++mNumSubmitted;
+	//a missing file fails right away and Poll reports it like any other failure
+	program.mShader->BeginLoad(source.mVertName, source.mFragName, GetDefines(features));
+	mPending.emplace_back(&program);
+	return &program;
+}
+
+void ShaderLibrary::Request(const std::string& name, uint32_t features)
+{
+	Source* source = Find(name);
+	if (!source)
+	{
+		SDL_Log("ShaderLibrary : unknown shader %s", name.c_str());
+		return;
+	}
+	features &= source->mFeatures;
+	if (source->mPrograms.find(features) == source->mPrograms.end())
+	{
+		Submit(*source, features);
+	}
+}
+
+Shader* ShaderLibrary::Get(const std::string& name, uint32_t features)
+{
+	Source* source = Find(name);
+	if (!source)
+	{
+		return nullptr;
+	}
+	features &= source->mFeatures;
+	auto iter = source->mPrograms.find(features);
+	if (iter == source->mPrograms.end())
+	{
+		Submit(*source, features);
+		return nullptr;
+	}
+	return iter->second.mReady ? iter->second.mShader.get() : nullptr;
+}
+
+void ShaderLibrary::Poll(Program* program, bool wait)
+{
+	ShaderStatus status = wait ? program->mShader->Finish() : program->mShader->Poll();
+	if (status == ShaderStatus::Ready)
+	{
+		program->mReady = true;
+		//samplers keep their unit for the program's lifetime, so it is set once at link
+		if (program->mFeatures & ShaderFeature::NormalMap)
+		{
+			program->mShader->SetActive();
+			program->mShader->SetIntUniform("uNormalMap", 1);
+		}
+	}
+}
+
+void ShaderLibrary::Update()
+{
+	if (mPending.empty())
+	{
+		return;
+	}
+	if (IsParallelCompileAvailable())
+	{
+		for (Program* program : mPending)
+		{
+			Poll(program, false);
+		}
+	}
+	else
+	{
+		//without the extension the first status query waits for the compiler,
+		//so only one program finishes per frame to spread the stalls out
+		Poll(mPending.front(), true);
+	}
+	//failed programs leave the list too and keep returning nullptr
+	std::erase_if(mPending, [](Program* program)
+		{
+			return program->mShader->GetStatus() != ShaderStatus::Pending;
+		});
+	if (mPending.empty())
+	{
+		double ms = (SDL_GetPerformanceCounter() - mSubmitTicks) * 1000.0 / SDL_GetPerformanceFrequency();
+		SDL_Log("ShaderLibrary : %zu programs ready after %.2f ms", mNumSubmitted, ms);
+	}
+}
+
+void ShaderLibrary::Finish()
+{
+	while (!mPending.empty())
+	{
+		Poll(mPending.front(), true);
+		Update();
+	}
+}
+
+void ShaderLibrary::Unload()
+{
+	for (auto& [name, source] : mSources)
+	{
+		for (auto& [features, program] : source.mPrograms)
+		{
+			program.mShader->Unload();
+		}
+		source.mPrograms.clear();
+	}
+	mPending.clear();
+}
+
+size_t ShaderLibrary::GetNumPrograms() const
+{
+	size_t count = 0;
+	for (const auto& [name, source] : mSources)
+	{
+		count += source.mPrograms.size();
+	}
+	return count;
+}
+
+size_t ShaderLibrary::GetNumFromCache() const
+{
+	size_t count = 0;
+	for (const auto& [name, source] : mSources)
+	{
+		for (const auto& [features, program] : source.mPrograms)
+		{
+			count += program.mShader->WasLoadedFromCache() ? 1 : 0;
+		}
+	}
+	return count;
+}
\ No newline at end of file
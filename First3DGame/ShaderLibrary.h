@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+//permutation bits; each one is a #define of the name in Defines in both stages
+namespace ShaderFeature
+{
+	//quantized position, octahedral normal and per vertex layer (VertexLayout::PosNormTexCompact)
+	constexpr uint32_t Compact = 1 << 0;
+	//tangent space normals from layer uNormalLayer of the array on texture unit 1 (Mesh::GetNormalTexture),
+	//with the tangent frame rebuilt from screen space derivatives
+	constexpr uint32_t NormalMap = 1 << 1;
+	//point and spot lights from the LightClusters texture buffers on units 2-4
+	constexpr uint32_t ClusteredLights = 1 << 2;
+
+	constexpr size_t NumFeatures = 3;
+	constexpr const char* Defines[NumFeatures] = { "COMPACT", "NORMAL_MAP", "CLUSTERED_LIGHTS" };
+}
+
+//named shaders (the "shader" field of mesh files) compiled once per feature permutation.
+//Requests are all handed to the driver up front and polled once a frame, so with
+//KHR_parallel_shader_compile they compile on the driver's threads while frames go on.
+//Get never waits: it returns nullptr until the permutation is linked
+class ShaderLibrary
+{
+public:
+	ShaderLibrary();
+	~ShaderLibrary();
+
+	//features are the bits the sources understand; any other bit is dropped from requests
+	void Register(const std::string& name, const std::string& vertName,
+		const std::string& fragName, uint32_t features);
+	void AddAlias(const std::string& alias, const std::string& name);
+	//used for names nobody registered
+	void SetFallback(const std::string& name) { mFallback = name; }
+
+	//starts compiling the permutation unless it already was
+	void Request(const std::string& name, uint32_t features);
+	//the linked program, or nullptr while it compiles or when it failed; requests it if needed
+	class Shader* Get(const std::string& name, uint32_t features);
+	//call once per frame on the GL thread
+	void Update();
+	//waits for every pending program
+	void Finish();
+	void Unload();
+
+	size_t GetNumPending() const { return mPending.size(); }
+	size_t GetNumPrograms() const;
+	size_t GetNumFromCache() const;
+	static bool IsParallelCompileAvailable();
+	static std::vector<std::string> GetDefines(uint32_t features);
+private:
+	struct Program
+	{
+		std::unique_ptr<class Shader> mShader;
+		uint32_t mFeatures = 0;
+		bool mReady = false;
+	};
+
+	struct Source
+	{
+		std::string mVertName;
+		std::string mFragName;
+		uint32_t mFeatures = 0;
+		std::unordered_map<uint32_t, Program> mPrograms;
+	};
+
+	//nullptr for an unknown name without a fallback
+	Source* Find(const std::string& name);
+	Program* Submit(Source& source, uint32_t features);
+	void Poll(Program* program, bool wait);
+
+	std::unordered_map<std::string, Source> mSources;
+	std::unordered_map<std::string, std::string> mAliases;
+	std::vector<Program*> mPending;
+	std::string mFallback;
+	//start of the current wave of compiles, for the log once it drains
+	uint64_t mSubmitTicks;
+	size_t mNumSubmitted;
+};
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 330
+
+//the depth prepass: Phong.vert places the vertices and nothing is written but depth
+void main()
+{
+}
\ No newline at end of file
@@ -10,6 +10,7 @@ struct DirectionalLight
 in vec2 fragTexCoord;
 in vec3 fragNormal;
 in vec3 fragWorldPos;
+flat in int fragLayer;
 
 out vec4 outColor;
 
@@ -17,11 +18,85 @@ uniform vec3 uCameraPos;
 uniform vec3 uAmbientLight;
 uniform float uSpecPower;
 uniform DirectionalLight uDirLight;
-uniform sampler2D uTexture;
+uniform sampler2DArray uTexture;
+#ifdef NORMAL_MAP
+//texture unit 1; normal mapped meshes are never batched, so one layer per draw
+uniform sampler2DArray uNormalMap;
+uniform int uNormalLayer;
+
+//the tangent frame follows the texture coordinates across the triangle, so no tangent attribute is needed
+vec3 PerturbNormal(vec3 N)
+{
+	vec3 dpx = dFdx(fragWorldPos);
+	vec3 dpy = dFdy(fragWorldPos);
+	vec2 duvx = dFdx(fragTexCoord);
+	vec2 duvy = dFdy(fragTexCoord);
+	vec3 dpyPerp = cross(dpy, N);
+	vec3 dpxPerp = cross(N, dpx);
+	vec3 T = dpyPerp * duvx.x + dpxPerp * duvy.x;
+	vec3 B = dpyPerp * duvx.y + dpxPerp * duvy.y;
+	//scale invariant, and safe where the texture coordinates do not change
+	float invLength = inversesqrt(max(max(dot(T, T), dot(B, B)), 1e-20));
+	vec3 tangentNormal = texture(uNormalMap, vec3(fragTexCoord, uNormalLayer)).xyz * 2.0 - 1.0;
+	return normalize(mat3(T * invLength, B * invLength, N) * tangentNormal);
+}
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+//LightClusters::TilesX, TilesY and NumSlices
+const ivec3 ClusterDims = ivec3(16, 9, 24);
+//three texels per light: position and radius, color and outer cone cosine, direction and inner cone cosine
+uniform samplerBuffer uLightData;
+//offset into uLightIndices and count per cluster
+uniform usamplerBuffer uLightGrid;
+uniform usamplerBuffer uLightIndices;
+//tiles per pixel in x and y, then the slice scale; slice = log(view depth) * z + uClusterBias
+uniform vec3 uClusterScale;
+uniform float uClusterBias;
+
+vec3 ClusteredLights(vec3 N, vec3 V)
+{
+	//gl_FragCoord.w is 1 / view depth
+	ivec3 cluster = ivec3(gl_FragCoord.xy * uClusterScale.xy, log(1.0 / gl_FragCoord.w) * uClusterScale.z + uClusterBias);
+	cluster = clamp(cluster, ivec3(0), ClusterDims - 1);
+	uvec2 range = texelFetch(uLightGrid, (cluster.z * ClusterDims.y + cluster.y) * ClusterDims.x + cluster.x).xy;
+
+	vec3 light = vec3(0.0);
+	for (uint i = 0u; i < range.y; ++i)
+	{
+		int texel = int(texelFetch(uLightIndices, int(range.x + i)).x) * 3;
+		vec4 posRadius = texelFetch(uLightData, texel);
+		vec4 colorOuter = texelFetch(uLightData, texel + 1);
+		vec4 dirInner = texelFetch(uLightData, texel + 2);
+
+		vec3 toLight = posRadius.xyz - fragWorldPos;
+		float dist = length(toLight);
+		vec3 L = toLight / max(dist, 0.0001);
+		float NdotL = dot(N, L);
+		if (dist >= posRadius.w || NdotL <= 0.0)
+		{
+			continue;
+		}
+		//smooth falloff reaching zero at the radius
+		float falloff = 1.0 - (dist * dist) / (posRadius.w * posRadius.w);
+		falloff *= falloff;
+		if (colorOuter.w > -1.0)
+		{
+			falloff *= smoothstep(colorOuter.w, dirInner.w, dot(-L, dirInner.xyz));
+		}
+		float specular = pow(max(0.0, dot(reflect(-L, N), V)), uSpecPower);
+		light += colorOuter.rgb * falloff * (NdotL + specular);
+	}
+	return light;
+}
+#endif
 
 void main()
 {
 	vec3 N = normalize(fragNormal);
+#ifdef NORMAL_MAP
+	N = PerturbNormal(N);
+#endif
 	vec3 L = normalize(-uDirLight.mDirection);
 	vec3 V = normalize(uCameraPos - fragWorldPos);
 	vec3 R = normalize(reflect(-L, N));
@@ -34,6 +109,9 @@ void main()
 		vec3 Specular = uDirLight.mSpecColor * pow(max(0.0, dot(R, V)), uSpecPower);
 		Phong += Diffuse + Specular;
 	}
+#ifdef CLUSTERED_LIGHTS
+	Phong += ClusteredLights(N, V);
+#endif
 
-	outColor = texture(uTexture, fragTexCoord) * vec4(Phong, 1.0f);
+	outColor = texture(uTexture, vec3(fragTexCoord, fragLayer)) * vec4(Phong, 1.0f);
 }
\ No newline at end of file
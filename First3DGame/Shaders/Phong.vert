@@ -1,21 +1,60 @@
 #version 330
 
+//permutations are selected by #defines the ShaderLibrary inserts after #version:
+//COMPACT, plus NORMAL_MAP and CLUSTERED_LIGHTS in the fragment stage
+
 uniform mat4 uWorldTransform;
 uniform mat4 uViewProj;
 
+//the depth prepass links this with Depth.frag; GL_EQUAL needs both to agree exactly
+invariant gl_Position;
+
+#ifdef COMPACT
+uniform vec3 uPosOffset;
+uniform vec3 uPosScale;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+//static batches mixing array layers store one per vertex; zero otherwise
+layout(location = 3) in uint inLayer;
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
+#endif
 
 out vec2 fragTexCoord;
 out vec3 fragNormal;
 out vec3 fragWorldPos;
+flat out int fragLayer;
+
+uniform int uTextureLayer;
+
+vec3 OctDecode(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
+#ifdef COMPACT
+	vec4 pos = vec4(inPosition * uPosScale + uPosOffset, 1.0);
+	vec4 normal = vec4(OctDecode(inNormal), 0.0);
+	fragLayer = uTextureLayer + int(inLayer);
+#else
 	vec4 pos = vec4(inPosition, 1.0);
+	vec4 normal = vec4(inNormal, 0.0);
+	fragLayer = uTextureLayer;
+#endif
+
 	pos = pos * uWorldTransform;
 	fragWorldPos = pos.xyz;
 	gl_Position = pos * uViewProj;
-	fragNormal = (vec4(inNormal, 0.0f) * uWorldTransform).xyz;
+	fragNormal = (normal * uWorldTransform).xyz;
 	fragTexCoord = inTexCoord;
 }
\ No newline at end of file
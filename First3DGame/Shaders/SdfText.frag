@@ -0,0 +1,17 @@
+#version 330
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+out vec4 outColor;
+
+uniform sampler2D uTexture;
+
+void main()
+{
+	//0.5 is the outline; the ramp is one screen pixel wide at any scale
+	float distance = texture(uTexture, fragTexCoord).r;
+	float width = max(fwidth(distance), 0.0001);
+	float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+	outColor = vec4(fragColor.rgb, fragColor.a * alpha);
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #version 330
 
 in vec2 fragTexCoord;
+in vec4 fragColor;
 
 out vec4 outColor;
 
@@ -8,5 +9,5 @@ uniform sampler2D uTexture;
 
 void main()
 {
-	outColor = texture(uTexture, fragTexCoord);
+	outColor = texture(uTexture, fragTexCoord) * fragColor;
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330
+uniform mat4 uViewProj;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+void main()
+{
+	vec4 pos = vec4(inPosition, 0.0, 1.0);
+	gl_Position = pos * uViewProj;
+	fragTexCoord = inTexCoord;
+	fragColor = inColor;
+}
\ No newline at end of file
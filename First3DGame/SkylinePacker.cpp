@@ -0,0 +1,120 @@
+#include "SkylinePacker.h"
+#include <algorithm>
+
+SkylinePacker::SkylinePacker(int width, int height)
+	:mWidth(width)
+	, mHeight(height)
+	, mUsedArea(0)
+{
+	Reset();
+}
+
+void SkylinePacker::Reset()
+{
+	mSkyline.clear();
+	mSkyline.emplace_back(Node{ 0, 0, mWidth });
+	mUsedArea = 0;
+}
+
+bool SkylinePacker::Pack(int width, int height, int& outX, int& outY)
+{
+	if (width <= 0 || height <= 0)
+	{
+		return false;
+	}
+
+	//lowest top edge wins, ties go to the narrowest segment to keep wide gaps open
+	size_t bestIndex = mSkyline.size();
+	int bestTop = mHeight + 1;
+	int bestWidth = mWidth + 1;
+	int bestY = 0;
+	for (size_t i = 0; i < mSkyline.size(); ++i)
+	{
+		int y = 0;
+		if (Fit(i, width, height, y))
+		{
+			int top = y + height;
+			if (top < bestTop || (top == bestTop && mSkyline[i].mWidth < bestWidth))
+			{
+				bestIndex = i;
+				bestTop = top;
+				bestWidth = mSkyline[i].mWidth;
+				bestY = y;
+			}
+		}
+	}
+	if (bestIndex == mSkyline.size())
+	{
+		return false;
+	}
+
+	outX = mSkyline[bestIndex].mX;
+	outY = bestY;
+	mSkyline.insert(mSkyline.begin() + bestIndex, Node{ outX, bestY + height, width });
+
+	//cut away the segments now covered by the new one
+	for (size_t i = bestIndex + 1; i < mSkyline.size();)
+	{
+		const Node& prev = mSkyline[i - 1];
+		int prevRight = prev.mX + prev.mWidth;
+		if (mSkyline[i].mX >= prevRight)
+		{
+			break;
+		}
+		int shrink = prevRight - mSkyline[i].mX;
+		mSkyline[i].mX += shrink;
+		mSkyline[i].mWidth -= shrink;
+		if (mSkyline[i].mWidth <= 0)
+		{
+			mSkyline.erase(mSkyline.begin() + i);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	for (size_t i = 0; i + 1 < mSkyline.size();)
+	{
+		if (mSkyline[i].mY == mSkyline[i + 1].mY)
+		{
+			mSkyline[i].mWidth += mSkyline[i + 1].mWidth;
+			mSkyline.erase(mSkyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	mUsedArea += static_cast<long long>(width) * height;
+	return true;
+}
+
+bool SkylinePacker::Fit(size_t index, int width, int height, int& outY) const
+{
+	int x = mSkyline[index].mX;
+	if (x + width > mWidth)
+	{
+		return false;
+	}
+
+	int widthLeft = width;
+	int y = 0;
+	for (size_t i = index; widthLeft > 0 && i < mSkyline.size(); ++i)
+	{
+		y = std::max(y, mSkyline[i].mY);
+		if (y + height > mHeight)
+		{
+			return false;
+		}
+		widthLeft -= mSkyline[i].mWidth;
+	}
+	outY = y;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	return static_cast<float>(mUsedArea) / (static_cast<float>(mWidth) * mHeight);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+//bottom-left skyline rectangle packer. Only the top edge of the packed area is kept,
+//so inserts are cheap enough to run while the game is loading
+class SkylinePacker
+{
+public:
+	SkylinePacker(int width, int height);
+
+	//false when the rectangle no longer fits anywhere
+	bool Pack(int width, int height, int& outX, int& outY);
+	void Reset();
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	//packed area over page area
+	float GetOccupancy() const;
+private:
+	struct Node
+	{
+		int mX;
+		int mY;
+		int mWidth;
+	};
+
+	bool Fit(size_t index, int width, int height, int& outY) const;
+
+	std::vector<Node> mSkyline;
+	int mWidth;
+	int mHeight;
+	long long mUsedArea;
+};
\ No newline at end of file
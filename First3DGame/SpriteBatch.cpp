@@ -0,0 +1,213 @@
+#include "SpriteBatch.h"
+#include <glew.h>
+#include <cstddef>
+#include <cstring>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define SPRITEBATCH_SSE
+#endif
+#include "Shader.h"
+#include "Texture.h"
+#include "GpuDebug.h"
+
+SpriteBatch::SpriteBatch()
+	:mVertexCapacity(1024 * 4)
+	, mVertexBuffer(0)
+	, mIndexBuffer(0)
+	, mVertexArray(0)
+	, mNumDrawCalls(0)
+{
+	glGenVertexArrays(1, &mVertexArray);
+	glBindVertexArray(mVertexArray);
+
+	glGenBuffers(1, &mVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, mVertexCapacity * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+
+	//every quad uses the same 6 indices relative to its first vertex
+	std::vector<uint16_t> indices(MaxSpritesPerDraw * 6);
+	for (unsigned int i = 0; i < MaxSpritesPerDraw; ++i)
+	{
+		uint16_t base = static_cast<uint16_t>(i * 4);
+		uint16_t quad[] = { base, static_cast<uint16_t>(base + 1), static_cast<uint16_t>(base + 2),
+			static_cast<uint16_t>(base + 2), static_cast<uint16_t>(base + 3), base };
+		memcpy(indices.data() + i * 6, quad, sizeof(quad));
+	}
+	glGenBuffers(1, &mIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+	GpuDebug::SetLabel(GL_VERTEX_ARRAY, mVertexArray, "SpriteBatch");
+	GpuDebug::SetLabel(GL_BUFFER, mVertexBuffer, "SpriteBatch vertices");
+	GpuDebug::SetLabel(GL_BUFFER, mIndexBuffer, "SpriteBatch indices");
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+		reinterpret_cast<void*>(offsetof(SpriteVertex, mPos)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+		reinterpret_cast<void*>(offsetof(SpriteVertex, mTexCoord)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex),
+		reinterpret_cast<void*>(offsetof(SpriteVertex, mColor)));
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	glDeleteBuffers(1, &mVertexBuffer);
+	glDeleteBuffers(1, &mIndexBuffer);
+	glDeleteVertexArrays(1, &mVertexArray);
+}
+
+void SpriteBatch::Begin()
+{
+	mVertices.clear();
+	mBatches.clear();
+	mNumDrawCalls = 0;
+}
+
+void SpriteBatch::AddSprite(Texture* texture, const Matrix4& worldTransform, float width, float height,
+	SpriteBlend blend, uint32_t color)
+{
+	AddQuad(texture->GetTextureID(), texture->GetUVRect(), worldTransform,
+		-width * 0.5f, -height * 0.5f, width * 0.5f, height * 0.5f, blend, color);
+}
+
+void SpriteBatch::AddQuad(unsigned int textureID, const TextureRect& uv, const Matrix4& worldTransform,
+	float minX, float minY, float maxX, float maxY, SpriteBlend blend, uint32_t color)
+{
+	unsigned int sprite = static_cast<unsigned int>(mVertices.size() / 4);
+	if (mBatches.empty() || mBatches.back().mTextureID != textureID || mBatches.back().mBlend != blend ||
+		mBatches.back().mNumSprites == MaxSpritesPerDraw)
+	{
+		mBatches.emplace_back(Batch{ textureID, blend, sprite, 0 });
+	}
+	++mBatches.back().mNumSprites;
+
+	mVertices.resize(mVertices.size() + 4);
+	SpriteVertex* v = mVertices.data() + sprite * 4;
+
+	//corner = (cx ± w/2, cy ± h/2, 0, 1) * world; only x and y are kept
+	const float(*m)[4] = worldTransform.mat;
+	float hw = (maxX - minX) * 0.5f;
+	float hh = (maxY - minY) * 0.5f;
+	float cx = (minX + maxX) * 0.5f;
+	float cy = (minY + maxY) * 0.5f;
+	float originX = cx * m[0][0] + cy * m[1][0] + m[3][0];
+	float originY = cx * m[0][1] + cy * m[1][1] + m[3][1];
+#ifdef SPRITEBATCH_SSE
+	//two corners per register : (x0, y0, x1, y1)
+	__m128 xAxis = _mm_mul_ps(_mm_setr_ps(m[0][0], m[0][1], m[0][0], m[0][1]), _mm_set1_ps(hw));
+	__m128 yAxis = _mm_mul_ps(_mm_setr_ps(m[1][0], m[1][1], m[1][0], m[1][1]), _mm_set1_ps(hh));
+	__m128 origin = _mm_setr_ps(originX, originY, originX, originY);
+	__m128 top = _mm_add_ps(origin, yAxis);
+	__m128 bottom = _mm_sub_ps(origin, yAxis);
+	__m128 leftRight = _mm_mul_ps(xAxis, _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f));
+	__m128 topPair = _mm_add_ps(top, leftRight);
+	__m128 bottomPair = _mm_sub_ps(bottom, leftRight);
+	_mm_storel_pi(reinterpret_cast<__m64*>(v[0].mPos), topPair);
+	_mm_storeh_pi(reinterpret_cast<__m64*>(v[1].mPos), topPair);
+	_mm_storel_pi(reinterpret_cast<__m64*>(v[2].mPos), bottomPair);
+	_mm_storeh_pi(reinterpret_cast<__m64*>(v[3].mPos), bottomPair);
+#else
+	static const float corners[4][2] = { { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f }, { -1.0f, -1.0f } };
+	for (int i = 0; i < 4; ++i)
+	{
+		float x = corners[i][0] * hw;
+		float y = corners[i][1] * hh;
+		v[i].mPos[0] = x * m[0][0] + y * m[1][0] + originX;
+		v[i].mPos[1] = x * m[0][1] + y * m[1][1] + originY;
+	}
+#endif
+
+	v[0].mTexCoord[0] = uv.mU0;
+	v[0].mTexCoord[1] = uv.mV0;
+	v[1].mTexCoord[0] = uv.mU1;
+	v[1].mTexCoord[1] = uv.mV0;
+	v[2].mTexCoord[0] = uv.mU1;
+	v[2].mTexCoord[1] = uv.mV1;
+	v[3].mTexCoord[0] = uv.mU0;
+	v[3].mTexCoord[1] = uv.mV1;
+	for (int i = 0; i < 4; ++i)
+	{
+		v[i].mColor = color;
+	}
+}
+
+void SpriteBatch::End(Shader* shader)
+{
+	if (mVertices.empty())
+	{
+		return;
+	}
+	Upload();
+	shader->SetActive();
+
+	bool first = true;
+	SpriteBlend currentBlend = SpriteBlend::Alpha;
+	unsigned int currentTexture = 0;
+	for (const Batch& batch : mBatches)
+	{
+		if (first || batch.mBlend != currentBlend)
+		{
+			SetBlend(batch.mBlend);
+			currentBlend = batch.mBlend;
+		}
+		if (first || batch.mTextureID != currentTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, batch.mTextureID);
+			currentTexture = batch.mTextureID;
+		}
+		first = false;
+
+		glDrawElementsBaseVertex(GL_TRIANGLES, batch.mNumSprites * 6, GL_UNSIGNED_SHORT, nullptr,
+			batch.mFirstSprite * 4);
+		++mNumDrawCalls;
+	}
+}
+
+void SpriteBatch::Upload()
+{
+	glBindVertexArray(mVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+
+	unsigned int numVerts = static_cast<unsigned int>(mVertices.size());
+	while (mVertexCapacity < numVerts)
+	{
+		mVertexCapacity *= 2;
+	}
+	size_t bytes = numVerts * sizeof(SpriteVertex);
+
+	//orphan last frame's storage so the map never waits on draws still in flight
+	glBufferData(GL_ARRAY_BUFFER, mVertexCapacity * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+	void* dst = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst)
+	{
+		memcpy(dst, mVertices.data(), bytes);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	else
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, mVertices.data());
+	}
+}
+
+void SpriteBatch::SetBlend(SpriteBlend blend)
+{
+	glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+	if (blend == SpriteBlend::Additive)
+	{
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ZERO);
+	}
+	else
+	{
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+	}
+}
+
+uint32_t SpriteBatch::PackColor(const Vector3& color, float alpha)
+{
+	auto toByte = [](float c) { return static_cast<uint32_t>(Math::Clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+	//byte order in memory is r, g, b, a on little endian targets
+	return toByte(color.x) | (toByte(color.y) << 8) | (toByte(color.z) << 16) | (toByte(alpha) << 24);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Math.h"
+#include "Texture.h"
+
+enum class SpriteBlend
+{
+	Alpha,
+	Additive
+};
+
+struct SpriteVertex
+{
+	float mPos[2];
+	float mTexCoord[2];
+	//RGBA8, normalized in the shader
+	uint32_t mColor;
+};
+
+//collects every sprite of a frame, transforms the corners on the CPU and streams them
+//into one vertex buffer. Consecutive sprites sharing GL texture and blend mode become one draw
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+	~SpriteBatch();
+
+	void Begin();
+	//width and height are in pixels before the world transform
+	void AddSprite(class Texture* texture, const Matrix4& worldTransform, float width, float height,
+		SpriteBlend blend, uint32_t color = 0xffffffff);
+	//a quad spanning (minX, minY)-(maxX, maxY) in the same pixel space, y up, showing uv of textureID
+	void AddQuad(unsigned int textureID, const TextureRect& uv, const Matrix4& worldTransform,
+		float minX, float minY, float maxX, float maxY, SpriteBlend blend, uint32_t color = 0xffffffff);
+	void End(class Shader* shader);
+
+	size_t GetNumSprites() const { return mVertices.size() / 4; }
+	size_t GetNumDrawCalls() const { return mNumDrawCalls; }
+
+	static uint32_t PackColor(const Vector3& color, float alpha = 1.0f);
+	//one draw never indexes more than this, so the index buffer stays 16-bit
+	static const unsigned int MaxSpritesPerDraw = 16384;
+private:
+	struct Batch
+	{
+		//atlas regions share their page's GL texture, so batches compare ids
+		unsigned int mTextureID;
+		SpriteBlend mBlend;
+		unsigned int mFirstSprite;
+		unsigned int mNumSprites;
+	};
+
+	void Upload();
+	static void SetBlend(SpriteBlend blend);
+
+	std::vector<SpriteVertex> mVertices;
+	std::vector<Batch> mBatches;
+	unsigned int mVertexCapacity;
+	unsigned int mVertexBuffer;
+	unsigned int mIndexBuffer;
+	unsigned int mVertexArray;
+	size_t mNumDrawCalls;
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "Component.h"
 #include <SDL.h>
+#include <cstdint>
+#include "SpriteBatch.h"
 
 class Texture;
 
@@ -10,10 +12,12 @@ public:
 	SpriteComponent(class Actor* owner, int updateOrder = 20);
 	~SpriteComponent();
 
-	void Draw(class Shader* shader);
+	void Submit(struct RenderFrame& frame);
 	void SetTexture(Texture* texture);
+	void SetBlend(SpriteBlend blend) { mBlend = blend; }
+	void SetColor(const Vector3& color, float alpha = 1.0f) { mColor = SpriteBatch::PackColor(color, alpha); }
 private:
-	int mTexWidth;
-	int mTexHeight;
 	Texture* mTexture;
+	SpriteBlend mBlend;
+	uint32_t mColor;
 };
\ No newline at end of file
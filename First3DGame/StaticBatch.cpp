@@ -0,0 +1,188 @@
+#include "StaticBatch.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "Shader.h"
+#include "Renderer.h"
+#include "Game.h"
+#include "ResourceManager.h"
+#include "TextureStreamer.h"
+#include "RenderFrame.h"
+#include <SDL.h>
+
+StaticBatch::StaticBatch(Texture* texture, float specPower, const std::string& shaderName)
+	:mGeometry(nullptr)
+	, mLayout(VertexLayout::PosNormTex)
+	, mRadius(0.0f)
+	, mTexture(texture)
+	, mShaderName(shaderName)
+	, mSpecPower(specPower)
+	, mMixedLayers(false)
+	, mNumMeshes(0)
+	, mNumRemovedIndices(0)
+{
+
+}
+
+StaticBatch::~StaticBatch()
+{
+
+}
+
+size_t StaticBatch::AddMesh(const Mesh* mesh, const Matrix4& worldTransform, const Texture* texture)
+{
+	const std::vector<float>& verts = mesh->GetVertices();
+	const std::vector<unsigned int>& indices = mesh->GetIndices();
+	unsigned int baseVertex = static_cast<unsigned int>(mVertices.size() / Mesh::VertexSize);
+
+	mVertices.reserve(mVertices.size() + verts.size());
+	for (size_t i = 0; i < verts.size(); i += Mesh::VertexSize)
+	{
+		Vector3 pos = Vector3::Transform(Vector3(verts[i], verts[i + 1], verts[i + 2]), worldTransform);
+		Vector3 normal = Vector3::Transform(Vector3(verts[i + 3], verts[i + 4], verts[i + 5]), worldTransform, 0.0f);
+		normal.Normalize();
+
+		mVertices.insert(mVertices.end(), { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z,
+			verts[i + 6], verts[i + 7] });
+	}
+
+	Vector3 scale = worldTransform.GetScale();
+	mBounds.push_back({ worldTransform.GetTranslation(),
+		mesh->GetRadius() * Math::Max(scale.x, Math::Max(scale.y, scale.z)), texture,
+		static_cast<unsigned int>(mIndices.size()), static_cast<unsigned int>(indices.size()), false });
+
+	int layer = texture ? texture->GetLayer() : 0;
+	mMixedLayers = mMixedLayers || (mTexture && layer != mTexture->GetLayer());
+	mLayers.resize(mVertices.size() / Mesh::VertexSize, static_cast<uint16_t>(layer));
+
+	mIndices.reserve(mIndices.size() + indices.size());
+	for (unsigned int index : indices)
+	{
+		mIndices.emplace_back(baseVertex + index);
+	}
+	++mNumMeshes;
+	return mBounds.size() - 1;
+}
+
+void StaticBatch::Build(Renderer* renderer)
+{
+	size_t numVerts = mVertices.size() / Mesh::VertexSize;
+	mLayout = VertexFormat::ChooseLayout(mVertices.data(), numVerts);
+	mQuantization = VertexFormat::ComputeQuantization(mVertices.data(), numVerts);
+	//CanMerge only mixes layers when every mesh fits the compact layout
+	SDL_assert(!mMixedLayers || mLayout == VertexLayout::PosNormTexCompact);
+	std::vector<uint8_t> gpuVerts = VertexFormat::Encode(mLayout, mVertices.data(), numVerts, mQuantization,
+		mLayers.data());
+
+	Vector3 boxMin(Math::Infinity, Math::Infinity, Math::Infinity);
+	Vector3 boxMax(Math::NegInfinity, Math::NegInfinity, Math::NegInfinity);
+	for (const MeshBounds& bounds : mBounds)
+	{
+		boxMin.x = Math::Min(boxMin.x, bounds.mCenter.x - bounds.mRadius);
+		boxMin.y = Math::Min(boxMin.y, bounds.mCenter.y - bounds.mRadius);
+		boxMin.z = Math::Min(boxMin.z, bounds.mCenter.z - bounds.mRadius);
+		boxMax.x = Math::Max(boxMax.x, bounds.mCenter.x + bounds.mRadius);
+		boxMax.y = Math::Max(boxMax.y, bounds.mCenter.y + bounds.mRadius);
+		boxMax.z = Math::Max(boxMax.z, bounds.mCenter.z + bounds.mRadius);
+	}
+	mCenter = mBounds.empty() ? Vector3::Zero : (boxMin + boxMax) * 0.5f;
+	mRadius = mBounds.empty() ? 0.0f : (boxMax - boxMin).Length() * 0.5f;
+
+	mGeometry = renderer->GetMeshGeometry(mLayout);
+	mRange = mGeometry->Allocate(gpuVerts.data(), static_cast<unsigned>(numVerts),
+		mIndices.data(), static_cast<unsigned>(mIndices.size()));
+
+	mVertices.clear();
+	mVertices.shrink_to_fit();
+	mIndices.clear();
+	mIndices.shrink_to_fit();
+	mLayers.clear();
+	mLayers.shrink_to_fit();
+}
+
+void StaticBatch::RemoveMesh(size_t index)
+{
+	MeshBounds& bounds = mBounds[index];
+	if (!mGeometry || bounds.mRemoved)
+	{
+		return;
+	}
+	bounds.mRemoved = true;
+	mGeometry->ClearIndices(mRange, bounds.mFirstIndex, bounds.mNumIndices);
+	mNumRemovedIndices += bounds.mNumIndices;
+	--mNumMeshes;
+}
+
+void StaticBatch::Draw(Shader* shader, const RenderFrame& frame)
+{
+	if (!mGeometry)
+	{
+		return;
+	}
+	shader->SetMatrixUniform("uWorldTransform", Matrix4::Identity);
+	shader->SetFloatUniform("uSpecPower", mSpecPower);
+	if (mLayout == VertexLayout::PosNormTexCompact)
+	{
+		shader->SetVectorUniform("uPosOffset", mQuantization.mOffset);
+		shader->SetVectorUniform("uPosScale", mQuantization.mScale);
+	}
+	if (mTexture)
+	{
+		mTexture->SetActive();
+	}
+	//compact vertices add their own layer on top
+	int layer = (mTexture && mLayout != VertexLayout::PosNormTexCompact) ? mTexture->GetLayer() : 0;
+	shader->SetIntUniform("uTextureLayer", layer);
+	if (TextureStreamer* streamer = Game::GetResourceInstance()->GetTextureStreamer())
+	{
+		for (const MeshBounds& bounds : mBounds)
+		{
+			if (bounds.mTexture && !bounds.mRemoved)
+			{
+				streamer->ReportUsage(bounds.mTexture, frame.GetProjectedRadius(bounds.mCenter, bounds.mRadius) * 2.0f);
+			}
+		}
+	}
+	mGeometry->Draw(mRange);
+}
+
+void StaticBatch::DrawDepth(Shader* shader)
+{
+	if (!mGeometry)
+	{
+		return;
+	}
+	shader->SetMatrixUniform("uWorldTransform", Matrix4::Identity);
+	if (mLayout == VertexLayout::PosNormTexCompact)
+	{
+		shader->SetVectorUniform("uPosOffset", mQuantization.mOffset);
+		shader->SetVectorUniform("uPosScale", mQuantization.mScale);
+	}
+	mGeometry->Draw(mRange);
+}
+
+bool StaticBatch::CanMerge(const Mesh* mesh, const Texture* texture, float specPower) const
+{
+	if (mSpecPower != specPower || mesh->GetShaderName() != mShaderName)
+	{
+		return false;
+	}
+	if (mTexture == texture)
+	{
+		return !mMixedLayers || mesh->GetLayout() == VertexLayout::PosNormTexCompact;
+	}
+	if (!mTexture || !texture || !mTexture->GetArray() || mTexture->GetArray() != texture->GetArray())
+	{
+		return false;
+	}
+	//every mesh so far has to fit the compact layout as well; a mixed batch already does
+	if (mesh->GetLayout() != VertexLayout::PosNormTexCompact)
+	{
+		return false;
+	}
+	if (mMixedLayers)
+	{
+		return true;
+	}
+	size_t numVerts = mVertices.size() / Mesh::VertexSize;
+	return VertexFormat::ChooseLayout(mVertices.data(), numVerts) == VertexLayout::PosNormTexCompact;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include "Math.h"
+#include "GeometryBuffer.h"
+
+class StaticBatch
+{
+public:
+	StaticBatch(class Texture* texture, float specPower, const std::string& shaderName);
+	~StaticBatch();
+
+	//texture must share the batch's texture array (or be the batch texture when not in one).
+	//Returns the mesh's index for RemoveMesh
+	size_t AddMesh(const class Mesh* mesh, const Matrix4& worldTransform, const class Texture* texture);
+	void Build(class Renderer* renderer);
+	//after Build: the mesh's triangles collapse in place and the rest still draws in one call
+	void RemoveMesh(size_t index);
+	void Draw(class Shader* shader, const struct RenderFrame& frame);
+	//positions only, for the depth prepass
+	void DrawDepth(class Shader* shader);
+
+	//meshes on different layers of the same array merge as long as the batch stays in the
+	//compact layout, which carries the layer per vertex
+	bool CanMerge(const class Mesh* mesh, const class Texture* texture, float specPower) const;
+	size_t GetNumMeshes() const { return mNumMeshes; }
+	unsigned int GetNumTriangles() const { return (mRange.mNumIndices - mNumRemovedIndices) / 3; }
+	VertexLayout GetLayout() const { return mLayout; }
+	const std::string& GetShaderName() const { return mShaderName; }
+	//sphere around every merged mesh, set by Build
+	const Vector3& GetCenter() const { return mCenter; }
+	float GetRadius() const { return mRadius; }
+private:
+	//kept per merged mesh so texture streaming still sees each one's screen size,
+	//and so one can be removed again
+	struct MeshBounds
+	{
+		Vector3 mCenter;
+		float mRadius;
+		const class Texture* mTexture;
+		unsigned int mFirstIndex;
+		unsigned int mNumIndices;
+		bool mRemoved;
+	};
+
+	std::vector<float> mVertices;
+	std::vector<unsigned int> mIndices;
+	std::vector<uint16_t> mLayers;
+	std::vector<MeshBounds> mBounds;
+	class GeometryBuffer* mGeometry;
+	GeometryRange mRange;
+	VertexLayout mLayout;
+	VertexQuantization mQuantization;
+	Vector3 mCenter;
+	float mRadius;
+	class Texture* mTexture;
+	std::string mShaderName;
+	float mSpecPower;
+	bool mMixedLayers;
+	size_t mNumMeshes;
+	unsigned int mNumRemovedIndices;
+};
\ No newline at end of file
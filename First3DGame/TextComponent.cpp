@@ -0,0 +1,37 @@
+#include "TextComponent.h"
+#include "Actor.h"
+#include "Game.h"
+#include "Renderer.h"
+#include "SpriteBatch.h"
+#include "RenderFrame.h"
+
+TextComponent::TextComponent(Actor* owner, int updateOrder)
+	:Component(owner, updateOrder)
+	, mFont(nullptr)
+	, mPointSize(24)
+	, mColor(0xffffffff)
+{
+	Game::GetRendererInstance()->AddText(this);
+}
+
+TextComponent::~TextComponent()
+{
+	if (Renderer* renderer = Game::GetRendererInstance())
+	{
+		renderer->RemoveText(this);
+	}
+}
+
+void TextComponent::SetColor(const Vector3& color, float alpha)
+{
+	mColor = SpriteBatch::PackColor(color, alpha);
+}
+
+void TextComponent::Submit(RenderFrame& frame)
+{
+	if (!mFont || mText.empty())
+	{
+		return;
+	}
+	frame.mTexts.push_back({ mFont, mText, mOwner->GetWorldTransform(), mPointSize, mColor });
+}
\ No newline at end of file
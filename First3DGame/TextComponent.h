@@ -0,0 +1,28 @@
+#pragma once
+#include "Component.h"
+#include <string>
+#include <cstdint>
+#include "Math.h"
+
+//draws a string centred on its owner with the SDF text pass. The render thread lays out
+//glyph quads from the font's cache every frame, so changing the text never touches a texture
+class TextComponent : public Component
+{
+public:
+	TextComponent(class Actor* owner, int updateOrder = 100);
+	~TextComponent();
+
+	void Submit(struct RenderFrame& frame);
+	void SetFont(class Font* font) { mFont = font; }
+	void SetText(const std::string& text) { mText = text; }
+	void SetPointSize(int pointSize) { mPointSize = pointSize; }
+	void SetColor(const Vector3& color, float alpha = 1.0f);
+
+	const std::string& GetText() const { return mText; }
+	int GetPointSize() const { return mPointSize; }
+private:
+	class Font* mFont;
+	std::string mText;
+	int mPointSize;
+	uint32_t mColor;
+};
\ No newline at end of file
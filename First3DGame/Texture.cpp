@@ -1,12 +1,17 @@
 #include "Texture.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "TextureCooker.h"
+#include "TextureArray.h"
+#include "GpuDebug.h"
 #include <SDL.h>
 #include <glew.h>
-#include <SDL_ttf.h>
 
 Texture::Texture()
 	:mTextureID(0)
+	, mArray(nullptr)
+	, mLayer(0)
+	, mOwnsTexture(true)
 	, mWidth(0)
 	, mHeight(0)
 {
@@ -20,112 +25,110 @@ Texture::~Texture()
 
 bool Texture::Load(const std::string& fileName)
 {
-	int channels = 0;
-
-	unsigned char* image = stbi_load(fileName.c_str(), &mWidth, &mHeight, &channels, 0);
-
-	if (!image)
+	TextureData data;
+	if (!TextureCooker::LoadPreferCooked(fileName, data, GLEW_EXT_texture_compression_s3tc))
 	{
 		SDL_Log("Failed to load image : %s", fileName.c_str());
 		return false;
 	}
 
-	int format = GL_RGB;
-	if (channels == 4)
-	{
-		format = GL_RGBA;
-	}
+	mWidth = data.mMips[0].mWidth;
+	mHeight = data.mMips[0].mHeight;
 
 	glGenTextures(1, &mTextureID);
 	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	GpuDebug::SetLabel(GL_TEXTURE, mTextureID, fileName.c_str());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	glTexImage2D(
-		GL_TEXTURE_2D,
-		0,
-		format,
-		mWidth,
-		mHeight,
-		0,
-		format,
-		GL_UNSIGNED_BYTE,
-		image
-	);
-
-	stbi_image_free(image);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	unsigned int internalFormat = TextureCooker::GetGLInternalFormat(data.mFormat);
+	for (size_t level = 0; level < data.mMips.size(); ++level)
+	{
+		const TextureMip& mip = data.mMips[level];
+		if (TextureCooker::IsCompressed(data.mFormat))
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.mWidth, mip.mHeight, 0,
+				static_cast<GLsizei>(mip.mData.size()), mip.mData.data());
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.mWidth, mip.mHeight, 0,
+				internalFormat, GL_UNSIGNED_BYTE, mip.mData.data());
+		}
+	}
+	SetFiltering(static_cast<int>(data.mMips.size()));
 
 	return true;
 }
 
 void Texture::Unload()
 {
-	glDeleteTextures(1, &mTextureID);
+	if (mOwnsTexture)
+	{
+		glDeleteTextures(1, &mTextureID);
+	}
+	mTextureID = 0;
+	mArray = nullptr;
 }
 
-void Texture::SetActive()
+void Texture::InitAsRegion(unsigned int textureID, int width, int height, const TextureRect& uvRect)
 {
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+	mTextureID = textureID;
+	mWidth = width;
+	mHeight = height;
+	mUVRect = uvRect;
+	mArray = nullptr;
+	mOwnsTexture = false;
 }
 
-bool Texture::CreateFromText(const std::string& text, const std::string& fontName, int pointSize, const Vector3& color)
+void Texture::Adopt(unsigned int textureID, int width, int height)
 {
-	TTF_Font* font = TTF_OpenFont(fontName.c_str(), pointSize);
-	if (!font)
+	if (mOwnsTexture && mTextureID != 0)
 	{
-		SDL_Log("Failed to load font : %s", fontName.c_str());
-		return false;
+		glDeleteTextures(1, &mTextureID);
 	}
+	mTextureID = textureID;
+	mWidth = width;
+	mHeight = height;
+	mUVRect = TextureRect();
+	mArray = nullptr;
+	mOwnsTexture = true;
+}
 
-	SDL_Color sdlColor;
-	sdlColor.r = static_cast<Uint8>(color.x * 255);
-	sdlColor.g = static_cast<Uint8>(color.y * 255);
-	sdlColor.b = static_cast<Uint8>(color.z * 255);
-	sdlColor.a = 255;
-
-	SDL_Surface* surface = TTF_RenderUTF8_Blended(font, text.c_str(), sdlColor);
-
-	TTF_CloseFont(font);
-
-	if (!surface)
+void Texture::InitAsLayer(TextureArray* array, int layer, int width, int height)
+{
+	if (mOwnsTexture && mTextureID != 0)
 	{
-		return false;
+		glDeleteTextures(1, &mTextureID);
 	}
+	mTextureID = array->GetTextureID();
+	mArray = array;
+	mLayer = layer;
+	mWidth = width;
+	mHeight = height;
+	mUVRect = TextureRect();
+	mOwnsTexture = false;
+}
 
-	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
+unsigned int Texture::GetTextureID() const
+{
+	return mArray ? mArray->GetTextureID() : mTextureID;
+}
 
-	SDL_FreeSurface(surface);
+void Texture::SetFiltering(int numMips)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numMips - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, numMips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
 
-	if (!formattedSurface)
+void Texture::SetActive()
+{
+	if (mArray)
 	{
-		SDL_Log("Failed to convert surface format");
-		return false;
+		mArray->SetActive();
 	}
-
-	mWidth = formattedSurface->w;
-	mHeight = formattedSurface->h;
-
-	if (mTextureID != 0)
+	else
 	{
-		glDeleteTextures(1, &mTextureID);
+		glBindTexture(GL_TEXTURE_2D, mTextureID);
 	}
-
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
-
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	int bytesPerPixel = formattedSurface->format->BytesPerPixel;
-	int pitchPixels = formattedSurface->pitch;
-
-	int format = (bytesPerPixel == 4) ? GL_RGBA : GL_RGB;
-
-	glTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, formattedSurface->pixels);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	SDL_FreeSurface(formattedSurface);
-
-	return true;
 }
\ No newline at end of file
@@ -2,6 +2,15 @@
 #include <string>
 #include "Math.h"
 
+//(u0, v0) is the top left corner of the image inside its GL texture
+struct TextureRect
+{
+	float mU0 = 0.0f;
+	float mV0 = 0.0f;
+	float mU1 = 1.0f;
+	float mV1 = 1.0f;
+};
+
 class Texture
 {
 public:
@@ -11,14 +20,30 @@ public:
 	bool Load(const std::string& fileName);
 	void Unload();
 
-	bool CreateFromText(const std::string& text, const std::string& fontName, int pointSize, const Vector3& color);
+	//views a region of a GL texture owned elsewhere (an atlas page); Unload leaves it alone
+	void InitAsRegion(unsigned int textureID, int width, int height, const TextureRect& uvRect);
+	//takes ownership of a finished GL texture, replacing whatever was shown before
+	void Adopt(unsigned int textureID, int width, int height);
+	//views one layer of a texture array owned by the ResourceManager
+	void InitAsLayer(class TextureArray* array, int layer, int width, int height);
 
 	void SetActive();
+	//sampler state for the bound texture; trilinear when there is a mip chain
+	static void SetFiltering(int numMips);
 
 	int GetWidth() const { return mWidth; }
 	int GetHeight() const { return mHeight; }
+	//a layer reports its array's current storage, which moves as the array is streamed
+	unsigned int GetTextureID() const;
+	const TextureRect& GetUVRect() const { return mUVRect; }
+	class TextureArray* GetArray() const { return mArray; }
+	int GetLayer() const { return mLayer; }
 private:
 	unsigned int mTextureID;
+	class TextureArray* mArray;
+	int mLayer;
+	TextureRect mUVRect;
+	bool mOwnsTexture;
 	int mWidth;
 	int mHeight;
 };
\ No newline at end of file
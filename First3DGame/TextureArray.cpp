@@ -0,0 +1,196 @@
+#include "TextureArray.h"
+#include <glew.h>
+#include <algorithm>
+#include "GpuDebug.h"
+
+unsigned int TextureArray::sBoundID = 0;
+
+TextureArray::TextureArray(TextureFormat format, int width, int height, int numMips, int maxLayers, int baseLevel)
+	:mTextureID(0)
+	, mPendingID(0)
+	, mFormat(format)
+	, mWidth(width)
+	, mHeight(height)
+	, mNumMips(numMips)
+	, mNumLayers(0)
+	, mMaxLayers(maxLayers)
+	, mBaseLevel(std::clamp(baseLevel, 0, numMips - 1))
+	, mPendingBase(-1)
+{
+	mTextureID = CreateStorage(mBaseLevel);
+}
+
+TextureArray::~TextureArray()
+{
+	if (sBoundID == mTextureID || sBoundID == mPendingID)
+	{
+		sBoundID = 0;
+	}
+	glDeleteTextures(1, &mTextureID);
+	if (mPendingID != 0)
+	{
+		glDeleteTextures(1, &mPendingID);
+	}
+}
+
+unsigned int TextureArray::CreateStorage(int baseLevel)
+{
+	unsigned int textureID = 0;
+	glGenTextures(1, &textureID);
+	Bind(textureID);
+	GpuDebug::SetLabel(GL_TEXTURE, textureID, "TextureArray");
+
+	//storage for every layer up front; layers are filled in as textures arrive.
+	//Levels above the base are never specified, so they take no memory
+	unsigned int internalFormat = TextureCooker::GetGLInternalFormat(mFormat);
+	for (int level = baseLevel; level < mNumMips; ++level)
+	{
+		int w = std::max(1, mWidth >> level);
+		int h = std::max(1, mHeight >> level);
+		if (TextureCooker::IsCompressed(mFormat))
+		{
+			GLsizei size = static_cast<GLsizei>(TextureCooker::GetLevelSize(mFormat, w, h) * mMaxLayers);
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, w, h, mMaxLayers, 0, size, nullptr);
+		}
+		else
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, w, h, mMaxLayers, 0,
+				internalFormat, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mNumMips - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mNumMips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
+
+bool TextureArray::IsCompatible(const TextureData& data) const
+{
+	return data.mFormat == mFormat &&
+		static_cast<int>(data.mMips.size()) == mNumMips &&
+		data.mMips[0].mWidth == mWidth &&
+		data.mMips[0].mHeight == mHeight;
+}
+
+int TextureArray::AllocateLayer(const std::string& fileName)
+{
+	if (IsFull())
+	{
+		return -1;
+	}
+	mLayerFiles.emplace_back(fileName);
+	return mNumLayers++;
+}
+
+void TextureArray::UploadLevel(int layer, int level, const TextureMip& mip, const void* data)
+{
+	UploadRows(layer, level, mip, 0, mip.mHeight, data);
+}
+
+void TextureArray::UploadRows(int layer, int level, const TextureMip& mip, int firstRow, int numRows, const void* data)
+{
+	if (level >= mBaseLevel)
+	{
+		UploadTo(mTextureID, layer, level, mip, firstRow, numRows, data);
+	}
+	if (mPendingID != 0 && level >= mPendingBase)
+	{
+		UploadTo(mPendingID, layer, level, mip, firstRow, numRows, data);
+	}
+}
+
+bool TextureArray::UploadLayer(int layer, const TextureData& data)
+{
+	if (layer < 0 || layer >= mNumLayers || !IsCompatible(data))
+	{
+		return false;
+	}
+	for (int level = 0; level < mNumMips; ++level)
+	{
+		UploadLevel(layer, level, data.mMips[level], data.mMips[level].mData.data());
+	}
+	return true;
+}
+
+void TextureArray::BeginResidency(int baseLevel)
+{
+	if (mPendingID != 0)
+	{
+		glDeleteTextures(1, &mPendingID);
+	}
+	mPendingBase = std::clamp(baseLevel, 0, mNumMips - 1);
+	mPendingID = CreateStorage(mPendingBase);
+}
+
+void TextureArray::UploadPendingLevel(int layer, int level, const TextureMip& mip, const void* data)
+{
+	if (mPendingID != 0 && level >= mPendingBase)
+	{
+		UploadTo(mPendingID, layer, level, mip, 0, mip.mHeight, data);
+	}
+}
+
+void TextureArray::FinishResidency()
+{
+	if (mPendingID == 0)
+	{
+		return;
+	}
+	if (sBoundID == mTextureID)
+	{
+		sBoundID = 0;
+	}
+	glDeleteTextures(1, &mTextureID);
+	mTextureID = mPendingID;
+	mBaseLevel = mPendingBase;
+	mPendingID = 0;
+	mPendingBase = -1;
+}
+
+size_t TextureArray::GetStorageBytes(int baseLevel) const
+{
+	size_t bytes = 0;
+	for (int level = std::max(baseLevel, 0); level < mNumMips; ++level)
+	{
+		bytes += TextureCooker::GetLevelSize(mFormat, std::max(1, mWidth >> level), std::max(1, mHeight >> level));
+	}
+	return bytes * mMaxLayers;
+}
+
+size_t TextureArray::GetResidentBytes() const
+{
+	return GetStorageBytes(mBaseLevel) + (mPendingID != 0 ? GetStorageBytes(mPendingBase) : 0);
+}
+
+void TextureArray::UploadTo(unsigned int textureID, int layer, int level, const TextureMip& mip, int firstRow, int numRows, const void* data)
+{
+	Bind(textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	unsigned int internalFormat = TextureCooker::GetGLInternalFormat(mFormat);
+	if (TextureCooker::IsCompressed(mFormat))
+	{
+		GLsizei size = static_cast<GLsizei>(TextureCooker::GetLevelSize(mFormat, mip.mWidth, numRows));
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, firstRow, layer, mip.mWidth, numRows, 1,
+			internalFormat, size, data);
+	}
+	else
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, firstRow, layer, mip.mWidth, numRows, 1,
+			internalFormat, GL_UNSIGNED_BYTE, data);
+	}
+}
+
+void TextureArray::SetActive()
+{
+	Bind(mTextureID);
+}
+
+void TextureArray::Bind(unsigned int textureID)
+{
+	if (sBoundID != textureID)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+		sBoundID = textureID;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "TextureCooker.h"
+
+//one GL_TEXTURE_2D_ARRAY holding same-size, same-format textures as layers.
+//Meshes whose materials share an array draw without rebinding; only the layer uniform changes.
+//Only levels from the base level down are resident; the TextureStreamer moves the base
+//by filling a second storage in the background and swapping it in
+class TextureArray
+{
+public:
+	TextureArray(TextureFormat format, int width, int height, int numMips,
+		int maxLayers = DefaultMaxLayers, int baseLevel = 0);
+	~TextureArray();
+
+	bool IsCompatible(const TextureData& data) const;
+	bool IsFull() const { return mNumLayers >= mMaxLayers; }
+	//reserves the next free layer for the given image, -1 when full
+	int AllocateLayer(const std::string& fileName);
+	//data is a client pointer, or an offset when a pixel unpack buffer is bound.
+	//Levels that are not resident are skipped; a residency change in flight gets a copy too
+	void UploadLevel(int layer, int level, const TextureMip& mip, const void* data);
+	//data holds rows firstRow to firstRow + numRows; compressed rows start on a block row
+	void UploadRows(int layer, int level, const TextureMip& mip, int firstRow, int numRows, const void* data);
+	bool UploadLayer(int layer, const TextureData& data);
+
+	//allocates storage resident from baseLevel, shown once FinishResidency swaps it in
+	void BeginResidency(int baseLevel);
+	void UploadPendingLevel(int layer, int level, const TextureMip& mip, const void* data);
+	void FinishResidency();
+	bool IsResidencyPending() const { return mPendingID != 0; }
+
+	//skips the bind when this array is already bound
+	void SetActive();
+
+	unsigned int GetTextureID() const { return mTextureID; }
+	TextureFormat GetFormat() const { return mFormat; }
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	int GetNumMips() const { return mNumMips; }
+	int GetNumLayers() const { return mNumLayers; }
+	int GetMaxLayers() const { return mMaxLayers; }
+	int GetBaseLevel() const { return mBaseLevel; }
+	int GetPendingBaseLevel() const { return mPendingBase; }
+	const std::string& GetLayerFile(int layer) const { return mLayerFiles[layer]; }
+	//bytes of every layer for the levels from baseLevel down
+	size_t GetStorageBytes(int baseLevel) const;
+	//current storage plus any pending one
+	size_t GetResidentBytes() const;
+
+	static const int DefaultMaxLayers = 16;
+private:
+	unsigned int CreateStorage(int baseLevel);
+	void UploadTo(unsigned int textureID, int layer, int level, const TextureMip& mip, int firstRow, int numRows, const void* data);
+	void Bind(unsigned int textureID);
+
+	unsigned int mTextureID;
+	unsigned int mPendingID;
+	TextureFormat mFormat;
+	int mWidth;
+	int mHeight;
+	int mNumMips;
+	int mNumLayers;
+	int mMaxLayers;
+	int mBaseLevel;
+	int mPendingBase;
+	std::vector<std::string> mLayerFiles;
+
+	static unsigned int sBoundID;
+};
\ No newline at end of file
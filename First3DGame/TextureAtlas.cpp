@@ -0,0 +1,367 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <glew.h>
+#include <SDL.h>
+#include <rapidjson/document.h>
+#include "stb_image.h"
+#include "Texture.h"
+
+namespace
+{
+	//uncompressed 32-bit tga, top-left origin; stb_image reads it back
+	bool WriteTga(const std::string& fileName, const unsigned char* rgba, int width, int height)
+	{
+		std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			return false;
+		}
+		unsigned char header[18] = {};
+		header[2] = 2;
+		header[12] = static_cast<unsigned char>(width & 0xff);
+		header[13] = static_cast<unsigned char>(width >> 8);
+		header[14] = static_cast<unsigned char>(height & 0xff);
+		header[15] = static_cast<unsigned char>(height >> 8);
+		header[16] = 32;
+		header[17] = 0x28;
+		out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		std::vector<unsigned char> bgra(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < bgra.size(); i += 4)
+		{
+			bgra[i] = rgba[i + 2];
+			bgra[i + 1] = rgba[i + 1];
+			bgra[i + 2] = rgba[i];
+			bgra[i + 3] = rgba[i + 3];
+		}
+		out.write(reinterpret_cast<const char*>(bgra.data()), bgra.size());
+		return out.good();
+	}
+}
+
+TextureAtlas::TextureAtlas(int pageSize, bool createGLTextures)
+	:mPageSize(pageSize)
+	, mCreateGLTextures(createGLTextures)
+{
+
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	for (Page& page : mPages)
+	{
+		if (page.mTextureID != 0)
+		{
+			glDeleteTextures(1, &page.mTextureID);
+		}
+	}
+}
+
+bool TextureAtlas::Insert(const std::string& name, const unsigned char* rgba, int width, int height)
+{
+	if (mEntries.find(name) != mEntries.end())
+	{
+		return true;
+	}
+	if (width <= 0 || height <= 0 || width > MaxEntrySize || height > MaxEntrySize)
+	{
+		return false;
+	}
+
+	//the border repeats the edge texels so linear filtering never reads a neighbour
+	int paddedWidth = width + 2;
+	int paddedHeight = height + 2;
+	int x = 0;
+	int y = 0;
+	size_t pageIndex = mPages.size();
+	for (size_t i = 0; i < mPages.size(); ++i)
+	{
+		if (!mPages[i].mSealed && mPages[i].mPacker.Pack(paddedWidth, paddedHeight, x, y))
+		{
+			pageIndex = i;
+			break;
+		}
+	}
+	if (pageIndex == mPages.size())
+	{
+		pageIndex = AddPage(nullptr, false);
+		if (!mPages[pageIndex].mPacker.Pack(paddedWidth, paddedHeight, x, y))
+		{
+			return false;
+		}
+	}
+
+	std::vector<unsigned char> block(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+	for (int by = 0; by < paddedHeight; ++by)
+	{
+		int sy = std::clamp(by - 1, 0, height - 1);
+		for (int bx = 0; bx < paddedWidth; ++bx)
+		{
+			int sx = std::clamp(bx - 1, 0, width - 1);
+			memcpy(&block[(static_cast<size_t>(by) * paddedWidth + bx) * 4],
+				&rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+		}
+	}
+
+	Page& page = mPages[pageIndex];
+	if (mCreateGLTextures)
+	{
+		glBindTexture(GL_TEXTURE_2D, page.mTextureID);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, paddedWidth, paddedHeight, GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+	}
+	else
+	{
+		for (int by = 0; by < paddedHeight; ++by)
+		{
+			memcpy(&page.mPixels[(static_cast<size_t>(y + by) * mPageSize + x) * 4],
+				&block[static_cast<size_t>(by) * paddedWidth * 4], static_cast<size_t>(paddedWidth) * 4);
+		}
+	}
+
+	AddEntry(name, static_cast<int>(pageIndex), x + 1, y + 1, width, height);
+	return true;
+}
+
+Texture* TextureAtlas::GetTexture(const std::string& name) const
+{
+	auto iter = mEntries.find(name);
+	if (iter != mEntries.end())
+	{
+		return iter->second.mTexture.get();
+	}
+	return nullptr;
+}
+
+size_t TextureAtlas::AddPage(const unsigned char* pixels, bool sealed)
+{
+	Page page{ SkylinePacker(mPageSize, mPageSize), {}, 0, sealed };
+	std::vector<unsigned char> empty;
+	if (!pixels)
+	{
+		empty.resize(static_cast<size_t>(mPageSize) * mPageSize * 4, 0);
+		pixels = empty.data();
+	}
+
+	if (mCreateGLTextures)
+	{
+		glGenTextures(1, &page.mTextureID);
+		glBindTexture(GL_TEXTURE_2D, page.mTextureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mPageSize, mPageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		page.mPixels.assign(pixels, pixels + static_cast<size_t>(mPageSize) * mPageSize * 4);
+	}
+
+	mPages.emplace_back(std::move(page));
+	return mPages.size() - 1;
+}
+
+void TextureAtlas::AddEntry(const std::string& name, int page, int x, int y, int width, int height)
+{
+	float size = static_cast<float>(mPageSize);
+	TextureRect uvRect;
+	uvRect.mU0 = x / size;
+	uvRect.mV0 = y / size;
+	uvRect.mU1 = (x + width) / size;
+	uvRect.mV1 = (y + height) / size;
+
+	Entry entry;
+	entry.mTexture = std::make_unique<Texture>();
+	entry.mTexture->InitAsRegion(mPages[page].mTextureID, width, height, uvRect);
+	entry.mPage = page;
+	entry.mX = x;
+	entry.mY = y;
+	entry.mWidth = width;
+	entry.mHeight = height;
+	mEntries.emplace(name, std::move(entry));
+	mEntryOrder.emplace_back(name);
+}
+
+bool TextureAtlas::Load(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+	{
+		SDL_Log("File not found : Atlas %s", fileName.c_str());
+		return false;
+	}
+
+	std::stringstream fileStream;
+	fileStream << file.rdbuf();
+	std::string contents = fileStream.str();
+	rapidjson::StringStream jsonStr(contents.c_str());
+	rapidjson::Document doc;
+	doc.ParseStream(jsonStr);
+
+	if (!doc.IsObject() || !doc["version"].IsInt() || doc["version"].GetInt() != 1 ||
+		!doc["pageSize"].IsInt() || doc["pageSize"].GetInt() != mPageSize)
+	{
+		SDL_Log("Atlas %s is not a version 1 atlas with %d pixel pages", fileName.c_str(), mPageSize);
+		return false;
+	}
+
+	const rapidjson::Value& pages = doc["pages"];
+	const rapidjson::Value& entries = doc["entries"];
+	if (!pages.IsArray() || !entries.IsArray())
+	{
+		SDL_Log("Atlas %s has no page or entry list", fileName.c_str());
+		return false;
+	}
+
+	std::filesystem::path directory = std::filesystem::path(fileName).parent_path();
+	int firstPage = static_cast<int>(mPages.size());
+	for (rapidjson::SizeType i = 0; i < pages.Size(); ++i)
+	{
+		std::string pageName = (directory / pages[i].GetString()).generic_string();
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		unsigned char* pixels = stbi_load(pageName.c_str(), &width, &height, &channels, 4);
+		if (!pixels || width != mPageSize || height != mPageSize)
+		{
+			SDL_Log("Failed to load atlas page : %s", pageName.c_str());
+			stbi_image_free(pixels);
+			return false;
+		}
+		AddPage(pixels, true);
+		stbi_image_free(pixels);
+	}
+
+	for (rapidjson::SizeType i = 0; i < entries.Size(); ++i)
+	{
+		const rapidjson::Value& entry = entries[i];
+		int page = entry["page"].GetInt();
+		int x = entry["x"].GetInt();
+		int y = entry["y"].GetInt();
+		int width = entry["w"].GetInt();
+		int height = entry["h"].GetInt();
+		if (page < 0 || page >= static_cast<int>(pages.Size()) || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+			x + width > mPageSize || y + height > mPageSize)
+		{
+			SDL_Log("Atlas %s has an invalid entry %u", fileName.c_str(), i);
+			continue;
+		}
+		AddEntry(entry["name"].GetString(), firstPage + page, x, y, width, height);
+	}
+	return true;
+}
+
+bool TextureAtlas::Save(const std::string& fileName) const
+{
+	if (mCreateGLTextures)
+	{
+		SDL_Log("Atlas pages live on the GPU, only offline atlases can be saved");
+		return false;
+	}
+
+	std::filesystem::path atlasPath(fileName);
+	std::string stem = atlasPath.stem().generic_string();
+	std::vector<std::string> pageNames;
+	for (size_t i = 0; i < mPages.size(); ++i)
+	{
+		std::string pageName = stem + "_" + std::to_string(i) + ".tga";
+		std::string pagePath = (atlasPath.parent_path() / pageName).generic_string();
+		if (!WriteTga(pagePath, mPages[i].mPixels.data(), mPageSize, mPageSize))
+		{
+			SDL_Log("Failed to write atlas page : %s", pagePath.c_str());
+			return false;
+		}
+		pageNames.emplace_back(pageName);
+	}
+
+	std::ofstream out(fileName, std::ios::trunc);
+	if (!out.is_open())
+	{
+		SDL_Log("Failed to write atlas : %s", fileName.c_str());
+		return false;
+	}
+	out << "{\n\t\"version\": 1,\n\t\"pageSize\": " << mPageSize << ",\n\t\"pages\": [";
+	for (size_t i = 0; i < pageNames.size(); ++i)
+	{
+		out << (i ? ", " : "") << "\"" << pageNames[i] << "\"";
+	}
+	out << "],\n\t\"entries\": [\n";
+	for (size_t i = 0; i < mEntryOrder.size(); ++i)
+	{
+		const Entry& entry = mEntries.at(mEntryOrder[i]);
+		out << "\t\t{ \"name\": \"" << mEntryOrder[i] << "\", \"page\": " << entry.mPage
+			<< ", \"x\": " << entry.mX << ", \"y\": " << entry.mY
+			<< ", \"w\": " << entry.mWidth << ", \"h\": " << entry.mHeight << " }"
+			<< (i + 1 < mEntryOrder.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n}\n";
+	return out.good();
+}
+
+int TextureAtlas::Build(const std::string& atlasName, const std::vector<std::string>& fileNames)
+{
+	struct Image
+	{
+		std::string mName;
+		unsigned char* mPixels;
+		int mWidth;
+		int mHeight;
+	};
+	std::vector<Image> images;
+	int failures = 0;
+	for (const std::string& fileName : fileNames)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		if (!stbi_info(fileName.c_str(), &width, &height, &channels))
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+			++failures;
+			continue;
+		}
+		if (width > MaxEntrySize || height > MaxEntrySize)
+		{
+			SDL_Log("%s is %dx%d, larger than the %d pixel atlas limit", fileName.c_str(), width, height, MaxEntrySize);
+			++failures;
+			continue;
+		}
+		unsigned char* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+		if (!pixels)
+		{
+			SDL_Log("Failed to load image : %s", fileName.c_str());
+			++failures;
+			continue;
+		}
+		images.emplace_back(Image{ std::filesystem::path(fileName).generic_string(), pixels, width, height });
+	}
+
+	//tallest first packs tightest on a skyline
+	std::sort(images.begin(), images.end(), [](const Image& a, const Image& b) { return a.mHeight > b.mHeight; });
+
+	TextureAtlas atlas(DefaultPageSize, false);
+	for (const Image& image : images)
+	{
+		if (!atlas.Insert(image.mName, image.mPixels, image.mWidth, image.mHeight))
+		{
+			SDL_Log("Failed to pack %s", image.mName.c_str());
+			++failures;
+		}
+		stbi_image_free(image.mPixels);
+	}
+
+	if (!atlas.Save(atlasName))
+	{
+		return failures + 1;
+	}
+	for (size_t i = 0; i < atlas.mPages.size(); ++i)
+	{
+		SDL_Log("Atlas %s page %zu : %.1f%% used", atlasName.c_str(), i, atlas.mPages[i].mPacker.GetOccupancy() * 100.0f);
+	}
+	SDL_Log("Built %s : %zu images on %zu pages", atlasName.c_str(), atlas.GetNumEntries(), atlas.GetNumPages());
+	return failures;
+}
\ No newline at end of file
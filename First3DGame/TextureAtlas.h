@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "SkylinePacker.h"
+
+class Texture;
+
+//packs small RGBA images into shared pages and hands out Texture views of their
+//regions, so sprites using different images still share one GL texture.
+//.atlas files are json : { "version", "pageSize", "pages" : [tga names], "entries" :
+//[{ "name", "page", "x", "y", "w", "h" }] } with page paths relative to the .atlas
+class TextureAtlas
+{
+public:
+	//offline builds keep the page pixels on the CPU instead of creating GL textures
+	explicit TextureAtlas(int pageSize = DefaultPageSize, bool createGLTextures = true);
+	~TextureAtlas();
+
+	//copies the pixels into a page with a one pixel extruded border.
+	//false when the image is too large or no page can take it
+	bool Insert(const std::string& name, const unsigned char* rgba, int width, int height);
+	Texture* GetTexture(const std::string& name) const;
+
+	//loaded pages are sealed; later inserts open new pages
+	bool Load(const std::string& fileName);
+	bool Save(const std::string& fileName) const;
+
+	size_t GetNumPages() const { return mPages.size(); }
+	size_t GetNumEntries() const { return mEntries.size(); }
+
+	//packs the given images into atlasName and its pages; returns the number of failures
+	static int Build(const std::string& atlasName, const std::vector<std::string>& fileNames);
+
+	static const int DefaultPageSize = 1024;
+	static const int MaxEntrySize = DefaultPageSize / 2;
+private:
+	struct Page
+	{
+		SkylinePacker mPacker;
+		std::vector<unsigned char> mPixels;
+		unsigned int mTextureID;
+		bool mSealed;
+	};
+	struct Entry
+	{
+		std::unique_ptr<Texture> mTexture;
+		int mPage;
+		int mX;
+		int mY;
+		int mWidth;
+		int mHeight;
+	};
+
+	size_t AddPage(const unsigned char* pixels, bool sealed);
+	void AddEntry(const std::string& name, int page, int x, int y, int width, int height);
+
+	std::vector<Page> mPages;
+	std::unordered_map<std::string, Entry> mEntries;
+	//keeps Save output in insertion order
+	std::vector<std::string> mEntryOrder;
+	int mPageSize;
+	bool mCreateGLTextures;
+};
\ No newline at end of file
@@ -0,0 +1,545 @@
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <glew.h>
+#include <SDL.h>
+#include "stb_image.h"
+
+namespace
+{
+	const unsigned char KtxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const uint32_t KtxEndianness = 0x04030201;
+
+	struct KtxHeader
+	{
+		uint32_t mEndianness;
+		uint32_t mGLType;
+		uint32_t mGLTypeSize;
+		uint32_t mGLFormat;
+		uint32_t mGLInternalFormat;
+		uint32_t mGLBaseInternalFormat;
+		uint32_t mPixelWidth;
+		uint32_t mPixelHeight;
+		uint32_t mPixelDepth;
+		uint32_t mNumArrayElements;
+		uint32_t mNumFaces;
+		uint32_t mNumMipLevels;
+		uint32_t mKeyValueBytes;
+	};
+
+	struct Color
+	{
+		int r;
+		int g;
+		int b;
+	};
+
+	uint16_t PackRGB565(const Color& c)
+	{
+		int r = (c.r * 31 + 127) / 255;
+		int g = (c.g * 63 + 127) / 255;
+		int b = (c.b * 31 + 127) / 255;
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	Color UnpackRGB565(uint16_t c)
+	{
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		return Color{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+	}
+
+	void WriteLE16(unsigned char* out, uint16_t value)
+	{
+		out[0] = static_cast<unsigned char>(value & 0xff);
+		out[1] = static_cast<unsigned char>(value >> 8);
+	}
+
+	//endpoints are the texels furthest apart along the principal axis of the block colours
+	void EncodeColorBlock(const unsigned char block[16][4], unsigned char out[8])
+	{
+		float mean[3] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				mean[c] += block[i][c] / 16.0f;
+			}
+		}
+		float cov[6] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float r = block[i][0] - mean[0];
+			float g = block[i][1] - mean[1];
+			float b = block[i][2] - mean[2];
+			cov[0] += r * r;
+			cov[1] += r * g;
+			cov[2] += r * b;
+			cov[3] += g * g;
+			cov[4] += g * b;
+			cov[5] += b * b;
+		}
+
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iter = 0; iter < 4; ++iter)
+		{
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float length = std::max({ std::abs(x), std::abs(y), std::abs(z) });
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		int minIndex = 0;
+		int maxIndex = 0;
+		float minDot = 1e30f;
+		float maxDot = -1e30f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float dot = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+			if (dot < minDot)
+			{
+				minDot = dot;
+				minIndex = i;
+			}
+			if (dot > maxDot)
+			{
+				maxDot = dot;
+				maxIndex = i;
+			}
+		}
+
+		uint16_t c0 = PackRGB565(Color{ block[maxIndex][0], block[maxIndex][1], block[maxIndex][2] });
+		uint16_t c1 = PackRGB565(Color{ block[minIndex][0], block[minIndex][1], block[minIndex][2] });
+		//c0 > c1 selects the four colour mode
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+		uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			Color palette[4];
+			palette[0] = UnpackRGB565(c0);
+			palette[1] = UnpackRGB565(c1);
+			palette[2] = Color{ (2 * palette[0].r + palette[1].r) / 3, (2 * palette[0].g + palette[1].g) / 3,
+				(2 * palette[0].b + palette[1].b) / 3 };
+			palette[3] = Color{ (palette[0].r + 2 * palette[1].r) / 3, (palette[0].g + 2 * palette[1].g) / 3,
+				(palette[0].b + 2 * palette[1].b) / 3 };
+			for (int i = 0; i < 16; ++i)
+			{
+				int best = 0;
+				int bestDist = INT32_MAX;
+				for (int p = 0; p < 4; ++p)
+				{
+					int dr = block[i][0] - palette[p].r;
+					int dg = block[i][1] - palette[p].g;
+					int db = block[i][2] - palette[p].b;
+					int dist = dr * dr + dg * dg + db * db;
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		WriteLE16(out, c0);
+		WriteLE16(out + 2, c1);
+		WriteLE16(out + 4, static_cast<uint16_t>(indices & 0xffff));
+		WriteLE16(out + 6, static_cast<uint16_t>(indices >> 16));
+	}
+
+	void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char out[8])
+	{
+		int a0 = 0;
+		int a1 = 255;
+		for (int i = 0; i < 16; ++i)
+		{
+			a0 = std::max(a0, static_cast<int>(block[i][3]));
+			a1 = std::min(a1, static_cast<int>(block[i][3]));
+		}
+
+		uint64_t indices = 0;
+		if (a0 != a1)
+		{
+			//a0 > a1 selects the eight value mode
+			int palette[8] = { a0, a1 };
+			for (int p = 1; p < 7; ++p)
+			{
+				palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				int best = 0;
+				int bestDist = INT32_MAX;
+				for (int p = 0; p < 8; ++p)
+				{
+					int dist = std::abs(block[i][3] - palette[p]);
+					if (dist < bestDist)
+					{
+						bestDist = dist;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(a0);
+		out[1] = static_cast<unsigned char>(a1);
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xff);
+		}
+	}
+
+	int GetChannels(TextureFormat format)
+	{
+		return format == TextureFormat::RGB8 ? 3 : 4;
+	}
+}
+
+bool TextureCooker::LoadSource(const std::string& fileName, TextureData& outData)
+{
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	if (!stbi_info(fileName.c_str(), &width, &height, &channels))
+	{
+		return false;
+	}
+	//everything but plain RGB is expanded to RGBA
+	int wanted = channels == 3 ? 3 : 4;
+	unsigned char* image = stbi_load(fileName.c_str(), &width, &height, &channels, wanted);
+	if (!image)
+	{
+		return false;
+	}
+
+	outData.mFormat = wanted == 3 ? TextureFormat::RGB8 : TextureFormat::RGBA8;
+	outData.mMips.resize(1);
+	outData.mMips[0].mWidth = width;
+	outData.mMips[0].mHeight = height;
+	outData.mMips[0].mData.assign(image, image + static_cast<size_t>(width) * height * wanted);
+	stbi_image_free(image);
+	return true;
+}
+
+bool TextureCooker::LoadCooked(const std::string& fileName, TextureData& outData)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	KtxHeader header;
+	if (contents.size() < sizeof(KtxIdentifier) + sizeof(header) ||
+		memcmp(contents.data(), KtxIdentifier, sizeof(KtxIdentifier)) != 0)
+	{
+		SDL_Log("%s is not a KTX file", fileName.c_str());
+		return false;
+	}
+	memcpy(&header, contents.data() + sizeof(KtxIdentifier), sizeof(header));
+
+	if (header.mEndianness != KtxEndianness || header.mGLType != 0 || header.mNumFaces != 1 ||
+		header.mNumArrayElements != 0 || header.mPixelDepth != 0 || header.mNumMipLevels == 0 ||
+		(header.mGLInternalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT &&
+			header.mGLInternalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT))
+	{
+		SDL_Log("KTX %s is not a BC1/BC3 2D texture", fileName.c_str());
+		return false;
+	}
+
+	outData.mFormat = header.mGLInternalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? TextureFormat::BC1 : TextureFormat::BC3;
+	outData.mMips.clear();
+
+	size_t offset = sizeof(KtxIdentifier) + sizeof(header) + header.mKeyValueBytes;
+	int width = static_cast<int>(header.mPixelWidth);
+	int height = static_cast<int>(header.mPixelHeight);
+	for (uint32_t level = 0; level < header.mNumMipLevels; ++level)
+	{
+		uint32_t imageSize = 0;
+		if (offset + sizeof(imageSize) > contents.size())
+		{
+			break;
+		}
+		memcpy(&imageSize, contents.data() + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+		if (imageSize != GetLevelSize(outData.mFormat, width, height) || offset + imageSize > contents.size())
+		{
+			break;
+		}
+
+		TextureMip mip;
+		mip.mWidth = width;
+		mip.mHeight = height;
+		mip.mData.assign(contents.begin() + offset, contents.begin() + offset + imageSize);
+		outData.mMips.emplace_back(std::move(mip));
+
+		offset += (imageSize + 3) & ~3u;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	if (outData.mMips.size() != header.mNumMipLevels)
+	{
+		SDL_Log("KTX %s is truncated", fileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TextureCooker::LoadPreferCooked(const std::string& fileName, TextureData& outData, bool allowCompressed)
+{
+	if (allowCompressed && IsCookedUpToDate(fileName) && LoadCooked(GetCookedName(fileName), outData))
+	{
+		return true;
+	}
+	return LoadSource(fileName, outData);
+}
+
+bool TextureCooker::Exists(const std::string& fileName)
+{
+	std::error_code ec;
+	return std::filesystem::exists(fileName, ec) || std::filesystem::exists(GetCookedName(fileName), ec);
+}
+
+bool TextureCooker::Cook(const std::string& fileName)
+{
+	TextureData source;
+	if (!LoadSource(fileName, source))
+	{
+		SDL_Log("Failed to load image : %s", fileName.c_str());
+		return false;
+	}
+
+	//what Texture::Load keeps resident without cooking : level 0 at 3 or 4 bytes per texel
+	TextureMip& base = source.mMips[0];
+	size_t sourceBytes = base.mData.size();
+
+	//BC works on RGBA blocks; opaque images go to BC1
+	if (source.mFormat == TextureFormat::RGB8)
+	{
+		std::vector<unsigned char> rgba(static_cast<size_t>(base.mWidth) * base.mHeight * 4, 255);
+		for (size_t i = 0, count = static_cast<size_t>(base.mWidth) * base.mHeight; i < count; ++i)
+		{
+			memcpy(&rgba[i * 4], &base.mData[i * 3], 3);
+		}
+		base.mData = std::move(rgba);
+		source.mFormat = TextureFormat::RGBA8;
+	}
+	bool hasAlpha = false;
+	for (size_t i = 3; i < base.mData.size() && !hasAlpha; i += 4)
+	{
+		hasAlpha = base.mData[i] != 255;
+	}
+	TextureFormat format = hasAlpha ? TextureFormat::BC3 : TextureFormat::BC1;
+	int width = base.mWidth;
+	int height = base.mHeight;
+
+	//invalidates base
+	GenerateMips(source);
+
+	std::vector<unsigned char> file(KtxIdentifier, KtxIdentifier + sizeof(KtxIdentifier));
+	KtxHeader header = {};
+	header.mEndianness = KtxEndianness;
+	header.mGLTypeSize = 1;
+	header.mGLInternalFormat = GetGLInternalFormat(format);
+	header.mGLBaseInternalFormat = hasAlpha ? GL_RGBA : GL_RGB;
+	header.mPixelWidth = width;
+	header.mPixelHeight = height;
+	header.mNumFaces = 1;
+	header.mNumMipLevels = static_cast<uint32_t>(source.mMips.size());
+	const unsigned char* headerBytes = reinterpret_cast<const unsigned char*>(&header);
+	file.insert(file.end(), headerBytes, headerBytes + sizeof(header));
+
+	size_t cookedBytes = 0;
+	for (const TextureMip& mip : source.mMips)
+	{
+		std::vector<unsigned char> blocks = CompressBlocks(mip.mData.data(), mip.mWidth, mip.mHeight, format);
+		uint32_t imageSize = static_cast<uint32_t>(blocks.size());
+		const unsigned char* sizeBytes = reinterpret_cast<const unsigned char*>(&imageSize);
+		file.insert(file.end(), sizeBytes, sizeBytes + sizeof(imageSize));
+		file.insert(file.end(), blocks.begin(), blocks.end());
+		file.resize((file.size() + 3) & ~static_cast<size_t>(3), 0);
+		cookedBytes += blocks.size();
+	}
+
+	std::string cookedName = GetCookedName(fileName);
+	std::ofstream out(cookedName, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		SDL_Log("Failed to write cooked texture : %s", cookedName.c_str());
+		return false;
+	}
+	out.write(reinterpret_cast<const char*>(file.data()), file.size());
+
+	SDL_Log("Cooked %s : %dx%d %s, %zu mips, %zu KB -> %zu KB VRAM", fileName.c_str(), width, height,
+		hasAlpha ? "BC3" : "BC1", source.mMips.size(), sourceBytes / 1024, cookedBytes / 1024);
+	return true;
+}
+
+int TextureCooker::CookAll(std::vector<std::string> fileNames)
+{
+	if (fileNames.empty())
+	{
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator("Assets", ec))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".png")
+			{
+				fileNames.emplace_back(entry.path().generic_string());
+			}
+		}
+	}
+
+	int failures = 0;
+	for (const std::string& fileName : fileNames)
+	{
+		if (!Cook(fileName))
+		{
+			++failures;
+		}
+	}
+	return failures;
+}
+
+std::string TextureCooker::GetCookedName(const std::string& fileName)
+{
+	return std::filesystem::path(fileName).replace_extension(".ktx").generic_string();
+}
+
+bool TextureCooker::IsCookedUpToDate(const std::string& fileName)
+{
+	std::error_code ec;
+	std::filesystem::path cooked(GetCookedName(fileName));
+	if (!std::filesystem::exists(cooked, ec))
+	{
+		return false;
+	}
+	//a shipped build may carry only the cooked file
+	if (!std::filesystem::exists(fileName, ec))
+	{
+		return true;
+	}
+	auto cookedTime = std::filesystem::last_write_time(cooked, ec);
+	if (ec)
+	{
+		return false;
+	}
+	auto sourceTime = std::filesystem::last_write_time(fileName, ec);
+	return !ec && cookedTime >= sourceTime;
+}
+
+void TextureCooker::GenerateMips(TextureData& data)
+{
+	int channels = GetChannels(data.mFormat);
+	data.mMips.resize(1);
+	while (data.mMips.back().mWidth > 1 || data.mMips.back().mHeight > 1)
+	{
+		const TextureMip& src = data.mMips.back();
+		TextureMip dst;
+		dst.mWidth = std::max(1, src.mWidth / 2);
+		dst.mHeight = std::max(1, src.mHeight / 2);
+		dst.mData.resize(static_cast<size_t>(dst.mWidth) * dst.mHeight * channels);
+		for (int y = 0; y < dst.mHeight; ++y)
+		{
+			int y0 = std::min(y * 2, src.mHeight - 1);
+			int y1 = std::min(y * 2 + 1, src.mHeight - 1);
+			for (int x = 0; x < dst.mWidth; ++x)
+			{
+				int x0 = std::min(x * 2, src.mWidth - 1);
+				int x1 = std::min(x * 2 + 1, src.mWidth - 1);
+				for (int c = 0; c < channels; ++c)
+				{
+					int sum = src.mData[(static_cast<size_t>(y0) * src.mWidth + x0) * channels + c] +
+						src.mData[(static_cast<size_t>(y0) * src.mWidth + x1) * channels + c] +
+						src.mData[(static_cast<size_t>(y1) * src.mWidth + x0) * channels + c] +
+						src.mData[(static_cast<size_t>(y1) * src.mWidth + x1) * channels + c];
+					dst.mData[(static_cast<size_t>(y) * dst.mWidth + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		data.mMips.emplace_back(std::move(dst));
+	}
+}
+
+std::vector<unsigned char> TextureCooker::CompressBlocks(const unsigned char* rgba, int width, int height, TextureFormat format)
+{
+	std::vector<unsigned char> out(GetLevelSize(format, width, height));
+	size_t blockBytes = format == TextureFormat::BC1 ? 8 : 16;
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; ++by)
+	{
+		for (int bx = 0; bx < blocksX; ++bx)
+		{
+			//edge blocks repeat the last row/column
+			for (int i = 0; i < 16; ++i)
+			{
+				int x = std::min(bx * 4 + i % 4, width - 1);
+				int y = std::min(by * 4 + i / 4, height - 1);
+				memcpy(block[i], rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+			}
+			unsigned char* dst = out.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+			if (format == TextureFormat::BC3)
+			{
+				EncodeAlphaBlock(block, dst);
+				dst += 8;
+			}
+			EncodeColorBlock(block, dst);
+		}
+	}
+	return out;
+}
+
+bool TextureCooker::IsCompressed(TextureFormat format)
+{
+	return format == TextureFormat::BC1 || format == TextureFormat::BC3;
+}
+
+size_t TextureCooker::GetLevelSize(TextureFormat format, int width, int height)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+	case TextureFormat::BC3:
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 16;
+	default:
+		return static_cast<size_t>(width) * height * GetChannels(format);
+	}
+}
+
+unsigned int TextureCooker::GetGLInternalFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TextureFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TextureFormat::RGB8:
+		return GL_RGB;
+	default:
+		return GL_RGBA;
+	}
+}
\ No newline at end of file
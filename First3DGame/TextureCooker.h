@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+
+enum class TextureFormat
+{
+	RGB8,
+	RGBA8,
+	//4 bits per texel, opaque
+	BC1,
+	//8 bits per texel, interpolated alpha
+	BC3
+};
+
+struct TextureMip
+{
+	int mWidth = 0;
+	int mHeight = 0;
+	std::vector<unsigned char> mData;
+};
+
+struct TextureData
+{
+	TextureFormat mFormat = TextureFormat::RGBA8;
+	//level 0 first
+	std::vector<TextureMip> mMips;
+};
+
+//cooked textures are KTX 1.1 files next to the source image (Plane.png -> Plane.ktx)
+//holding the full mip chain in BC1, or BC3 when the image has alpha
+namespace TextureCooker
+{
+	//decodes a png/tga/... into a single uncompressed level
+	bool LoadSource(const std::string& fileName, TextureData& outData);
+	bool LoadCooked(const std::string& fileName, TextureData& outData);
+	//the cooked file when allowed and up to date, otherwise the source image
+	bool LoadPreferCooked(const std::string& fileName, TextureData& outData, bool allowCompressed);
+	bool Exists(const std::string& fileName);
+
+	bool Cook(const std::string& fileName);
+	//cooks every image given, or every .png under Assets when the list is empty
+	int CookAll(std::vector<std::string> fileNames);
+
+	std::string GetCookedName(const std::string& fileName);
+	bool IsCookedUpToDate(const std::string& fileName);
+
+	//box filtered chain down to 1x1 from a single RGB8/RGBA8 level
+	void GenerateMips(TextureData& data);
+	std::vector<unsigned char> CompressBlocks(const unsigned char* rgba, int width, int height, TextureFormat format);
+
+	bool IsCompressed(TextureFormat format);
+	size_t GetLevelSize(TextureFormat format, int width, int height);
+	unsigned int GetGLInternalFormat(TextureFormat format);
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <SDL.h>
+#include "ThreadPool.h"
+#include "Texture.h"
+#include "TextureArray.h"
+
+TextureStreamer::TextureStreamer(ThreadPool* pool)
+	:mPool(pool)
+	, mBudget(DefaultBudget)
+	, mUploadBudget(DefaultUploadBudget)
+{
+	mStats.mBudgetBytes = mBudget;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Cancel();
+}
+
+void TextureStreamer::ReportUsage(const Texture* texture, float screenSize)
+{
+	TextureArray* array = texture->GetArray();
+	if (!array)
+	{
+		return;
+	}
+
+	//about one texel per pixel across the texture's on-screen extent
+	float size = static_cast<float>(std::max(array->GetWidth(), array->GetHeight()));
+	int level = 0;
+	if (screenSize < size)
+	{
+		level = static_cast<int>(std::floor(std::log2(size / std::max(screenSize, 1.0f))));
+	}
+
+	ArrayUsage& usage = mUsage[array];
+	usage.mWantedLevel = usage.mSeen ? std::min(usage.mWantedLevel, level) : level;
+	usage.mSeen = true;
+}
+
+void TextureStreamer::Update(const std::vector<std::unique_ptr<TextureArray>>& arrays)
+{
+	//finish what is in flight first so the levels below start from the current state
+	size_t budget = mUploadBudget;
+	for (auto iter = mTransitions.begin(); iter != mTransitions.end();)
+	{
+		bool done = false;
+		size_t uploaded = UploadTransition(*iter, budget, done);
+		budget -= std::min(budget, uploaded);
+		if (done)
+		{
+			TextureArray* array = iter->mArray;
+			int from = array->GetBaseLevel();
+			array->FinishResidency();
+			if (iter->mBaseLevel < from)
+			{
+				mStats.mLevelsLoaded += from - iter->mBaseLevel;
+			}
+			else
+			{
+				mStats.mLevelsDropped += iter->mBaseLevel - from;
+			}
+			iter = mTransitions.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	struct Target
+	{
+		TextureArray* mArray;
+		int mLevel;
+		int mCoarsest;
+	};
+	std::vector<Target> targets;
+	targets.reserve(arrays.size());
+	size_t total = 0;
+	for (const auto& ptr : arrays)
+	{
+		TextureArray* array = ptr.get();
+		int coarsest = GetMinResidentLevel(array->GetWidth(), array->GetHeight(), array->GetNumMips());
+		ArrayUsage& usage = mUsage[array];
+		int wanted = usage.mSeen ? std::min(usage.mWantedLevel, coarsest) : coarsest;
+		usage.mSeen = false;
+
+		int level = array->IsResidencyPending() ? array->GetPendingBaseLevel() : array->GetBaseLevel();
+		if (wanted < level)
+		{
+			level = wanted;
+			usage.mFramesCoarser = 0;
+		}
+		else if (wanted > level)
+		{
+			if (++usage.mFramesCoarser >= DropDelayFrames)
+			{
+				level = wanted;
+				usage.mFramesCoarser = 0;
+			}
+		}
+		else
+		{
+			usage.mFramesCoarser = 0;
+		}
+		targets.push_back({ array, level, coarsest });
+		total += array->GetStorageBytes(level);
+	}
+
+	//over budget: give up the top level of whichever array frees the most
+	while (total > mBudget)
+	{
+		Target* best = nullptr;
+		size_t bestSaving = 0;
+		for (Target& target : targets)
+		{
+			if (target.mLevel >= target.mCoarsest)
+			{
+				continue;
+			}
+			size_t saving = target.mArray->GetStorageBytes(target.mLevel) - target.mArray->GetStorageBytes(target.mLevel + 1);
+			if (saving > bestSaving)
+			{
+				best = &target;
+				bestSaving = saving;
+			}
+		}
+		if (!best)
+		{
+			break;
+		}
+		++best->mLevel;
+		total -= bestSaving;
+	}
+
+	for (const Target& target : targets)
+	{
+		if (!target.mArray->IsResidencyPending() && target.mLevel != target.mArray->GetBaseLevel())
+		{
+			StartTransition(target.mArray, target.mLevel);
+		}
+	}
+
+	mStats.mResidentBytes = 0;
+	for (const auto& ptr : arrays)
+	{
+		mStats.mResidentBytes += ptr->GetResidentBytes();
+	}
+	mStats.mBudgetBytes = mBudget;
+	mStats.mPendingRequests = 0;
+	for (const Transition& transition : mTransitions)
+	{
+		for (const auto& load : transition.mLoads)
+		{
+			if (load->mState == Decoding || load->mNextLevel < transition.mArray->GetNumMips())
+			{
+				++mStats.mPendingRequests;
+			}
+		}
+	}
+}
+
+void TextureStreamer::Cancel()
+{
+	//workers only touch the loads they share; pending storage goes with its array
+	mTransitions.clear();
+	mUsage.clear();
+	mStats.mPendingRequests = 0;
+}
+
+int TextureStreamer::GetMinResidentLevel(int width, int height, int numMips) const
+{
+	int level = 0;
+	while (level < numMips - 1 && std::max(width >> level, height >> level) > MinResidentSize)
+	{
+		++level;
+	}
+	return level;
+}
+
+void TextureStreamer::StartTransition(TextureArray* array, int baseLevel)
+{
+	array->BeginResidency(baseLevel);
+
+	Transition transition;
+	transition.mArray = array;
+	transition.mBaseLevel = baseLevel;
+	bool compressed = TextureCooker::IsCompressed(array->GetFormat());
+	for (int layer = 0; layer < array->GetNumLayers(); ++layer)
+	{
+		auto load = std::make_shared<LayerLoad>();
+		load->mFileName = array->GetLayerFile(layer);
+		load->mLayer = layer;
+		load->mNextLevel = baseLevel;
+		transition.mLoads.emplace_back(load);
+
+		//the array's format says which file it was filled from
+		mPool->Submit([load, compressed]()
+			{
+				bool loaded = TextureCooker::LoadPreferCooked(load->mFileName, load->mData, compressed);
+				if (loaded && load->mData.mMips.size() == 1)
+				{
+					TextureCooker::GenerateMips(load->mData);
+				}
+				load->mState = loaded ? Decoded : Failed;
+			});
+	}
+	mTransitions.emplace_back(std::move(transition));
+}
+
+size_t TextureStreamer::UploadTransition(Transition& transition, size_t budget, bool& done)
+{
+	TextureArray* array = transition.mArray;
+	int numMips = array->GetNumMips();
+	size_t uploaded = 0;
+	done = true;
+	for (auto& load : transition.mLoads)
+	{
+		int state = load->mState;
+		if (state == Decoding)
+		{
+			done = false;
+			continue;
+		}
+		if (load->mNextLevel >= numMips)
+		{
+			continue;
+		}
+		if (state == Failed || !array->IsCompatible(load->mData))
+		{
+			//the layer keeps whatever the new storage holds; better than stalling the swap
+			SDL_Log("Texture streaming : cannot reload %s", load->mFileName.c_str());
+			load->mNextLevel = numMips;
+			continue;
+		}
+
+		while (load->mNextLevel < numMips && (uploaded == 0 || uploaded < budget))
+		{
+			const TextureMip& mip = load->mData.mMips[load->mNextLevel];
+			array->UploadPendingLevel(load->mLayer, load->mNextLevel, mip, mip.mData.data());
+			uploaded += mip.mData.size();
+			++load->mNextLevel;
+		}
+		if (load->mNextLevel < numMips)
+		{
+			done = false;
+		}
+		else
+		{
+			load->mData = TextureData();
+		}
+	}
+	return uploaded;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <unordered_map>
+#include "TextureCooker.h"
+
+struct TextureStreamStats
+{
+	//GL storage of every texture array, including residency changes in flight
+	size_t mResidentBytes = 0;
+	size_t mBudgetBytes = 0;
+	//layers waiting to be decoded or uploaded
+	size_t mPendingRequests = 0;
+	//running totals of base level moves
+	unsigned int mLevelsLoaded = 0;
+	unsigned int mLevelsDropped = 0;
+};
+
+//keeps each texture array resident only down to the finest mip its layers were drawn at.
+//Meshes report how large their texture appears on screen while drawing; Update turns that
+//into a base level per array, squeezes the total under the VRAM budget, and reloads the
+//arrays whose base moved on the thread pool. Finer levels stream in asynchronously; coarser
+//ones are dropped once an array has needed less for a while, or right away under pressure
+class TextureStreamer
+{
+public:
+	explicit TextureStreamer(class ThreadPool* pool);
+	~TextureStreamer();
+
+	//screenSize is the largest extent in pixels the texture covers this frame
+	void ReportUsage(const class Texture* texture, float screenSize);
+	//once per frame on the GL thread, after the previous frame's usage came in
+	void Update(const std::vector<std::unique_ptr<class TextureArray>>& arrays);
+	//drops every reload in flight; call before the arrays go away
+	void Cancel();
+
+	//arrays start at the coarsest streamed level and load finer ones as they are seen
+	int GetMinResidentLevel(int width, int height, int numMips) const;
+
+	void SetBudget(size_t bytes) { mBudget = bytes; }
+	size_t GetBudget() const { return mBudget; }
+	//bytes of texel data uploaded per Update; at least one level always goes up
+	void SetUploadBudget(size_t bytes) { mUploadBudget = bytes; }
+	size_t GetUploadBudget() const { return mUploadBudget; }
+	const TextureStreamStats& GetStats() const { return mStats; }
+
+	static const size_t DefaultBudget = 64 * 1024 * 1024;
+	static const size_t DefaultUploadBudget = 2 * 1024 * 1024;
+	//the coarsest resident level is at most this wide, so nothing ever shows the placeholder
+	static const int MinResidentSize = 64;
+	//frames an array must need less detail before its finer levels are dropped
+	static const int DropDelayFrames = 120;
+private:
+	enum LoadState
+	{
+		Decoding,
+		Decoded,
+		Failed
+	};
+
+	struct LayerLoad
+	{
+		std::string mFileName;
+		int mLayer = 0;
+		//written by the worker before mState becomes Decoded
+		TextureData mData;
+		std::atomic<int> mState = Decoding;
+		//main thread only
+		int mNextLevel = 0;
+	};
+
+	struct Transition
+	{
+		class TextureArray* mArray = nullptr;
+		int mBaseLevel = 0;
+		std::vector<std::shared_ptr<LayerLoad>> mLoads;
+	};
+
+	struct ArrayUsage
+	{
+		//finest level reported since the last Update
+		int mWantedLevel = 0;
+		bool mSeen = false;
+		int mFramesCoarser = 0;
+	};
+
+	void StartTransition(class TextureArray* array, int baseLevel);
+	//returns the bytes uploaded; true in done once every layer is in
+	size_t UploadTransition(Transition& transition, size_t budget, bool& done);
+
+	std::unordered_map<const class TextureArray*, ArrayUsage> mUsage;
+	std::vector<Transition> mTransitions;
+	class ThreadPool* mPool;
+	size_t mBudget;
+	size_t mUploadBudget;
+	TextureStreamStats mStats;
+};
\ No newline at end of file
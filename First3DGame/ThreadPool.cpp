@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t numThreads)
+	:mNumActive(0)
+	, mStopping(false)
+{
+	if (numThreads == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		numThreads = std::max(1u, cores > 1 ? cores - 1 : 1u);
+	}
+	for (size_t i = 0; i < numThreads; ++i)
+	{
+		mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.emplace_back(std::move(job));
+	}
+	mWake.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this] { return mJobs.empty() && mNumActive == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	grain = std::max<size_t>(grain, 1);
+	size_t numChunks = (count + grain - 1) / grain;
+	if (numChunks <= 1 || mThreads.empty())
+	{
+		if (count > 0)
+		{
+			body(0, count);
+		}
+		return;
+	}
+
+	//shared with helper jobs, which may only start once every chunk has been claimed
+	struct ForState
+	{
+		std::function<void(size_t, size_t)> mBody;
+		std::atomic<size_t> mNextChunk = 0;
+		std::atomic<size_t> mChunksLeft = 0;
+		std::mutex mMutex;
+		std::condition_variable mDone;
+	};
+	auto state = std::make_shared<ForState>();
+	state->mBody = body;
+	state->mChunksLeft = numChunks;
+	auto run = [state, count, grain, numChunks]()
+		{
+			size_t chunk;
+			while ((chunk = state->mNextChunk.fetch_add(1)) < numChunks)
+			{
+				size_t begin = chunk * grain;
+				state->mBody(begin, std::min(begin + grain, count));
+				if (state->mChunksLeft.fetch_sub(1) == 1)
+				{
+					std::lock_guard<std::mutex> lock(state->mMutex);
+					state->mDone.notify_all();
+				}
+			}
+		};
+
+	size_t numHelpers = std::min(mThreads.size(), numChunks - 1);
+	for (size_t i = 0; i < numHelpers; ++i)
+	{
+		Submit(run);
+	}
+	run();
+	std::unique_lock<std::mutex> lock(state->mMutex);
+	state->mDone.wait(lock, [&state] { return state->mChunksLeft == 0; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+			//queued jobs still run on shutdown so nobody waits on a dropped one
+			if (mJobs.empty())
+			{
+				return;
+			}
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+			++mNumActive;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mNumActive;
+			if (mJobs.empty() && mNumActive == 0)
+			{
+				mIdle.notify_all();
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool
+{
+public:
+	//0 uses one thread per core, leaving the main thread its own core
+	explicit ThreadPool(size_t numThreads = 0);
+	~ThreadPool();
+
+	void Submit(std::function<void()> job);
+	//blocks until the queue is empty and no job is running
+	void WaitIdle();
+	//calls body(begin, end) over [0, count) in chunks of grain items, on the workers and the
+	//calling thread, and returns once every chunk is done. Jobs queued earlier are not waited
+	//for; if they keep the workers busy the caller simply does more of the chunks itself
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+	size_t GetNumThreads() const { return mThreads.size(); }
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> mThreads;
+	std::deque<std::function<void()>> mJobs;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mIdle;
+	size_t mNumActive;
+	bool mStopping;
+};
\ No newline at end of file
@@ -1,10 +1,20 @@
 #include "VertexArray.h"
 #include "Game.h"
+#include <vector>
 
 VertexArray::VertexArray(const float* verts, unsigned int numVerts,
+	const unsigned int* indices, unsigned int numIndices)
+	:VertexArray(verts, numVerts, VertexLayout::PosNormTex, indices, numIndices)
+{
+	
+}
+
+VertexArray::VertexArray(const void* verts, unsigned int numVerts, VertexLayout layout,
 	const unsigned int* indices, unsigned int numIndices)
 	:mNumVerts(numVerts)
 	,mNumIndices(numIndices)
+	,mIndexType(GL_UNSIGNED_INT)
+	,mLayout(layout)
 {
 	glGenVertexArrays(1, &mVertexArray);
 	glBindVertexArray(mVertexArray);
@@ -13,50 +23,36 @@ VertexArray::VertexArray(const float* verts, unsigned int numVerts,
 	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
 	glBufferData(
 		GL_ARRAY_BUFFER,
-		numVerts * 8 * sizeof(float),
+		numVerts * VertexFormat::GetStride(layout),
 		verts,
 		GL_STATIC_DRAW
 	);
 
 	glGenBuffers(1, &mIndexBuffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-	glBufferData(
-		GL_ELEMENT_ARRAY_BUFFER,
-		numIndices * sizeof(unsigned int),
-		indices,
-		GL_STATIC_DRAW
-	);
-	//W(Position)
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(
-		0,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(float) * 8,
-		0
-	);
-	//@xNg
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(
-		1,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(float) * 8,
-		reinterpret_cast<void*>(sizeof(float) * 3)
-	);
-	//eNX`W(TexCoord)
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(
-		2,
-		2,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(float) * 8,
-		reinterpret_cast<void*>(sizeof(float) * 6)
-	);
-	
+	//PosNormTex keeps 32-bit indices for callers that draw with GL_UNSIGNED_INT
+	if (layout != VertexLayout::PosNormTex && numVerts <= 65536)
+	{
+		std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+		mIndexType = GL_UNSIGNED_SHORT;
+		glBufferData(
+			GL_ELEMENT_ARRAY_BUFFER,
+			numIndices * sizeof(uint16_t),
+			shortIndices.data(),
+			GL_STATIC_DRAW
+		);
+	}
+	else
+	{
+		glBufferData(
+			GL_ELEMENT_ARRAY_BUFFER,
+			numIndices * sizeof(unsigned int),
+			indices,
+			GL_STATIC_DRAW
+		);
+	}
+
+	VertexFormat::SetAttributes(layout);
 }
 
 VertexArray::~VertexArray()
@@ -70,4 +66,3 @@ void VertexArray::SetActive()
 {
 	glBindVertexArray(mVertexArray);
 }
-
@@ -1,21 +1,28 @@
 #pragma once
+#include "VertexFormat.h"
 
 class VertexArray
 {
 public:
 	VertexArray(const float* verts, unsigned int numVerts,
 		const unsigned int* indices, unsigned int numIndices);
+	VertexArray(const void* verts, unsigned int numVerts, VertexLayout layout,
+		const unsigned int* indices, unsigned int numIndices);
 	~VertexArray();
 
 	void SetActive();
 
 	unsigned int GetNumIndices() const { return mNumIndices; }
 	unsigned int GetNumVerts() const { return mNumVerts; }
+	unsigned int GetIndexType() const { return mIndexType; }
+	VertexLayout GetLayout() const { return mLayout; }
 
 private:
 	unsigned int mNumVerts;
 	unsigned int mNumIndices;
+	unsigned int mIndexType;
+	VertexLayout mLayout;
 	unsigned int mVertexBuffer;
 	unsigned int mIndexBuffer;
 	unsigned int mVertexArray;
-};
\ No newline at end of file
+};
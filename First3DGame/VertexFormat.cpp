@@ -0,0 +1,299 @@
+#include "VertexFormat.h"
+#include <glew.h>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	struct CompactVertex
+	{
+		uint16_t mPos[4];
+		int16_t mNormal[2];
+		uint16_t mTexCoord[2];
+	};
+	static_assert(sizeof(CompactVertex) == 16, "CompactVertex must be 16 bytes");
+
+	//half-floats keep 11 bits of mantissa, so texcoords beyond this lose texel precision
+	const float MaxCompactTexCoord = 2.0f;
+
+	int16_t ToSnorm16(float value)
+	{
+		value = Math::Clamp(value, -1.0f, 1.0f);
+		return static_cast<int16_t>(value >= 0.0f ? value * 32767.0f + 0.5f : value * 32767.0f - 0.5f);
+	}
+}
+
+unsigned int VertexFormat::GetStride(VertexLayout layout)
+{
+	switch (layout)
+	{
+	case VertexLayout::PosNormTexCompact:
+		return sizeof(CompactVertex);
+	case VertexLayout::PosNormTex:
+	default:
+		return static_cast<unsigned int>(SourceVertexSize * sizeof(float));
+	}
+}
+
+void VertexFormat::SetAttributes(VertexLayout layout)
+{
+	GLsizei stride = GetStride(layout);
+	switch (layout)
+	{
+	case VertexLayout::PosNormTexCompact:
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+			reinterpret_cast<void*>(offsetof(CompactVertex, mPos)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+			reinterpret_cast<void*>(offsetof(CompactVertex, mNormal)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+			reinterpret_cast<void*>(offsetof(CompactVertex, mTexCoord)));
+		glEnableVertexAttribArray(3);
+		glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, stride,
+			reinterpret_cast<void*>(offsetof(CompactVertex, mPos) + sizeof(uint16_t) * 3));
+		break;
+	case VertexLayout::PosNormTex:
+	default:
+		//W(Position)
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+		//@xNg
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride,
+			reinterpret_cast<void*>(sizeof(float) * 3));
+		//eNX`W(TexCoord)
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride,
+			reinterpret_cast<void*>(sizeof(float) * 6));
+		break;
+	}
+}
+
+bool VertexFormat::FromName(const std::string& name, VertexLayout& outLayout)
+{
+	if (name == "PosNormTex")
+	{
+		outLayout = VertexLayout::PosNormTex;
+		return true;
+	}
+	if (name == "PosNormTexCompact")
+	{
+		outLayout = VertexLayout::PosNormTexCompact;
+		return true;
+	}
+	return false;
+}
+
+const char* VertexFormat::GetName(VertexLayout layout)
+{
+	return layout == VertexLayout::PosNormTexCompact ? "PosNormTexCompact" : "PosNormTex";
+}
+
+VertexLayout VertexFormat::ChooseLayout(const float* verts, size_t numVerts)
+{
+	for (size_t i = 0; i < numVerts; ++i)
+	{
+		const float* v = verts + i * SourceVertexSize;
+		if (Math::Abs(v[6]) > MaxCompactTexCoord || Math::Abs(v[7]) > MaxCompactTexCoord)
+		{
+			return VertexLayout::PosNormTex;
+		}
+	}
+	return VertexLayout::PosNormTexCompact;
+}
+
+VertexQuantization VertexFormat::ComputeQuantization(const float* verts, size_t numVerts)
+{
+	Vector3 minPos(Math::Infinity, Math::Infinity, Math::Infinity);
+	Vector3 maxPos(Math::NegInfinity, Math::NegInfinity, Math::NegInfinity);
+	for (size_t i = 0; i < numVerts; ++i)
+	{
+		const float* v = verts + i * SourceVertexSize;
+		minPos.Set(Math::Min(minPos.x, v[0]), Math::Min(minPos.y, v[1]), Math::Min(minPos.z, v[2]));
+		maxPos.Set(Math::Max(maxPos.x, v[0]), Math::Max(maxPos.y, v[1]), Math::Max(maxPos.z, v[2]));
+	}
+
+	VertexQuantization quant;
+	if (numVerts == 0)
+	{
+		return quant;
+	}
+	quant.mOffset = minPos;
+	quant.mScale = maxPos - minPos;
+	//flat axes still need a non-zero scale so decoding stays finite
+	quant.mScale.Set(Math::Max(quant.mScale.x, 1e-6f), Math::Max(quant.mScale.y, 1e-6f),
+		Math::Max(quant.mScale.z, 1e-6f));
+	return quant;
+}
+
+std::vector<uint8_t> VertexFormat::Encode(VertexLayout layout, const float* verts, size_t numVerts,
+	const VertexQuantization& quant, const uint16_t* layers)
+{
+	std::vector<uint8_t> out(numVerts * GetStride(layout));
+	if (layout == VertexLayout::PosNormTex)
+	{
+		memcpy(out.data(), verts, out.size());
+		return out;
+	}
+
+	CompactVertex* dst = reinterpret_cast<CompactVertex*>(out.data());
+	for (size_t i = 0; i < numVerts; ++i)
+	{
+		const float* v = verts + i * SourceVertexSize;
+		CompactVertex& cv = dst[i];
+		const float pos[3] = {
+			(v[0] - quant.mOffset.x) / quant.mScale.x,
+			(v[1] - quant.mOffset.y) / quant.mScale.y,
+			(v[2] - quant.mOffset.z) / quant.mScale.z
+		};
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cv.mPos[axis] = static_cast<uint16_t>(Math::Clamp(pos[axis], 0.0f, 1.0f) * 65535.0f + 0.5f);
+		}
+		cv.mPos[3] = layers ? layers[i] : 0;
+		OctEncode(Vector3(v[3], v[4], v[5]), cv.mNormal[0], cv.mNormal[1]);
+		cv.mTexCoord[0] = FloatToHalf(v[6]);
+		cv.mTexCoord[1] = FloatToHalf(v[7]);
+	}
+	return out;
+}
+
+std::vector<float> VertexFormat::Decode(VertexLayout layout, const void* data, size_t numVerts,
+	const VertexQuantization& quant)
+{
+	std::vector<float> out(numVerts * SourceVertexSize);
+	if (layout == VertexLayout::PosNormTex)
+	{
+		memcpy(out.data(), data, out.size() * sizeof(float));
+		return out;
+	}
+
+	const CompactVertex* src = static_cast<const CompactVertex*>(data);
+	for (size_t i = 0; i < numVerts; ++i)
+	{
+		const CompactVertex& cv = src[i];
+		float* v = out.data() + i * SourceVertexSize;
+		v[0] = quant.mOffset.x + cv.mPos[0] / 65535.0f * quant.mScale.x;
+		v[1] = quant.mOffset.y + cv.mPos[1] / 65535.0f * quant.mScale.y;
+		v[2] = quant.mOffset.z + cv.mPos[2] / 65535.0f * quant.mScale.z;
+		Vector3 normal = OctDecode(cv.mNormal[0], cv.mNormal[1]);
+		v[3] = normal.x;
+		v[4] = normal.y;
+		v[5] = normal.z;
+		v[6] = HalfToFloat(cv.mTexCoord[0]);
+		v[7] = HalfToFloat(cv.mTexCoord[1]);
+	}
+	return out;
+}
+
+uint16_t VertexFormat::FloatToHalf(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffffu;
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000u;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1u)
+		{
+			++half;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+	if (exponent >= 31)
+	{
+		//overflow and NaN both clamp to infinity; texcoords never get here
+		return static_cast<uint16_t>(sign | 0x7c00u);
+	}
+
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000u)
+	{
+		++half;
+	}
+	return static_cast<uint16_t>(half);
+}
+
+float VertexFormat::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1fu;
+	uint32_t mantissa = value & 0x3ffu;
+	uint32_t bits = 0;
+
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400u) == 0)
+			{
+				mantissa <<= 1;
+				--exponent;
+			}
+			mantissa &= 0x3ffu;
+			bits = sign | (exponent << 23) | (mantissa << 13);
+		}
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7f800000u | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float result = 0.0f;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void VertexFormat::OctEncode(const Vector3& normal, int16_t& outX, int16_t& outY)
+{
+	float l1 = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+	if (l1 <= 0.0f)
+	{
+		outX = 0;
+		outY = 0;
+		return;
+	}
+	float x = normal.x / l1;
+	float y = normal.y / l1;
+	if (normal.z < 0.0f)
+	{
+		float foldX = (1.0f - Math::Abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldY = (1.0f - Math::Abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldX;
+		y = foldY;
+	}
+	outX = ToSnorm16(x);
+	outY = ToSnorm16(y);
+}
+
+Vector3 VertexFormat::OctDecode(int16_t x, int16_t y)
+{
+	Vector3 n(Math::Max(x / 32767.0f, -1.0f), Math::Max(y / 32767.0f, -1.0f), 0.0f);
+	n.z = 1.0f - Math::Abs(n.x) - Math::Abs(n.y);
+	float t = Math::Max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	n.Normalize();
+	return n;
+}
\ No newline at end of file
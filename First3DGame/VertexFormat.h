@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include "Math.h"
+
+enum class VertexLayout
+{
+	//float3 position, float3 normal, float2 texcoord (32 bytes)
+	PosNormTex,
+	//unorm16x3 position, octahedral snorm16x2 normal, half2 texcoord (16 bytes)
+	PosNormTexCompact,
+	NumLayouts
+};
+
+struct VertexQuantization
+{
+	Vector3 mOffset;
+	Vector3 mScale = Vector3(1.0f, 1.0f, 1.0f);
+};
+
+namespace VertexFormat
+{
+	const size_t SourceVertexSize = 8;
+
+	unsigned int GetStride(VertexLayout layout);
+	void SetAttributes(VertexLayout layout);
+	bool FromName(const std::string& name, VertexLayout& outLayout);
+	const char* GetName(VertexLayout layout);
+
+	VertexLayout ChooseLayout(const float* verts, size_t numVerts);
+	VertexQuantization ComputeQuantization(const float* verts, size_t numVerts);
+
+	//the compact layout can carry a per-vertex texture array layer in its spare position slot
+	std::vector<uint8_t> Encode(VertexLayout layout, const float* verts, size_t numVerts,
+		const VertexQuantization& quant, const uint16_t* layers = nullptr);
+	std::vector<float> Decode(VertexLayout layout, const void* data, size_t numVerts,
+		const VertexQuantization& quant);
+
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+	void OctEncode(const Vector3& normal, int16_t& outX, int16_t& outY);
+	Vector3 OctDecode(int16_t x, int16_t y);
+}
\ No newline at end of file